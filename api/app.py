@@ -26,13 +26,38 @@ model = SentenceTransformer("all-MiniLM-L6-v2")
 
 CLASS_NAME = "Sentence"
 
+# meta's fields as typed properties, so queries can filter on them; meta itself stays the
+# str(meta) text it always was. Dates are stored as YYYYMMDD integers for range filters.
+FILTER_PROPERTIES = [
+    {"name": "user_id", "dataType": ["text"], "tokenization": "field"},
+    {"name": "date", "dataType": ["int"]},
+    {"name": "type", "dataType": ["text"], "tokenization": "field"},
+]
+
+def date_key(value):
+    """YYYY-MM-DD (or an int already in that form) as the integer YYYYMMDD, else None"""
+    if isinstance(value, bool):
+        return None
+    if isinstance(value, int):
+        return value
+    if isinstance(value, str) and len(value) >= 10 and value[4] == "-" and value[7] == "-":
+        digits = value[0:4] + value[5:7] + value[8:10]
+        if digits.isdigit():
+            return int(digits)
+    return None
+
 def ensure_schema(retries=10, delay=2):
     """Ensure that the class exists in Weaviate, retrying if Weaviate is not ready."""
     for _ in range(retries):
         try:
             schema = client.schema.get()
-            class_names = [c["class"] for c in schema.get("classes", [])]
-            if CLASS_NAME in class_names:
+            classes = {c["class"]: c for c in schema.get("classes", [])}
+            if CLASS_NAME in classes:
+                # Classes created before the typed fields existed get them added
+                existing = {p["name"] for p in classes[CLASS_NAME].get("properties", [])}
+                for prop in FILTER_PROPERTIES:
+                    if prop["name"] not in existing:
+                        client.schema.property.create(CLASS_NAME, prop)
                 return
             # Class doesn't exist -> create it
             new_class = {
@@ -41,7 +66,7 @@ def ensure_schema(retries=10, delay=2):
                 "properties": [
                     {"name": "text", "dataType": ["text"]},
                     {"name": "meta", "dataType": ["text"]},
-                ],
+                ] + FILTER_PROPERTIES,
             }
             client.schema.create_class(new_class)
             return
@@ -62,35 +87,76 @@ def ingest():
     text = payload.get("text", "")
     meta = payload.get("meta", {})
 
-    if embedding is None:
+    computed = embedding is None
+    if computed:
         if not text:
             return jsonify({"error": "text required if no embedding provided"}), 400
         embedding = model.encode([text])[0].tolist()
 
     obj = {"text": text, "meta": str(meta)}
+    # Typed fields come from the payload (the C++ ingester sends them) or else from meta
+    fields = meta if isinstance(meta, dict) else {}
+    for name in ("user_id", "type"):
+        value = payload.get(name, fields.get(name))
+        if isinstance(value, str):
+            obj[name] = value
+    date = date_key(payload.get("date", fields.get("date")))
+    if date is not None:
+        obj["date"] = date
     try:
         client.data_object.create(obj, CLASS_NAME, vector=embedding)
     except Exception as e:
         return jsonify({"error": str(e)}), 500
 
+    # Vectors computed here are returned on request so clients can cache them (--embed-cache)
+    if computed and payload.get("return_embedding"):
+        return jsonify({"status": "ok", "embedding": embedding}), 201
     return jsonify({"status": "ok"}), 201
 
+@app.route("/embed", methods=["POST"])
+def embed():
+    """Vectors for a batch of texts, for clients that write to Weaviate directly"""
+    payload = request.json or {}
+    texts = payload.get("texts")
+    if not isinstance(texts, list) or not all(isinstance(t, str) for t in texts):
+        return jsonify({"error": "texts list required"}), 400
+    embeddings = model.encode(texts, batch_size=64).tolist() if texts else []
+    return jsonify({"embeddings": embeddings})
+
 @app.route("/query", methods=["POST"])
 def query():
     payload = request.json or {}
     embedding = payload.get("embedding")
     text = payload.get("text", "")
 
+    # Optional filters on the typed fields: a user and an inclusive date range
+    operands = []
+    user_id = payload.get("user_id")
+    if user_id is not None:
+        if not isinstance(user_id, str):
+            return jsonify({"error": "user_id must be a string"}), 400
+        operands.append({"path": ["user_id"], "operator": "Equal", "valueText": user_id})
+    for name, operator in (("date_from", "GreaterThanEqual"), ("date_to", "LessThanEqual")):
+        if payload.get(name) is None:
+            continue
+        date = date_key(payload[name])
+        if date is None:
+            return jsonify({"error": f"{name} must be YYYY-MM-DD or YYYYMMDD"}), 400
+        operands.append({"path": ["date"], "operator": operator, "valueInt": date})
+
     if embedding is None:
         if not text:
             return jsonify({"error": "text or embedding required"}), 400
         embedding = model.encode([text])[0].tolist()
 
     try:
-        res = client.query.get(CLASS_NAME, ["text", "meta"]) \
+        builder = client.query.get(CLASS_NAME, ["text", "meta"]) \
             .with_near_vector({"vector": embedding}) \
-            .with_limit(10) \
-            .do()
+            .with_limit(10)
+        if operands:
+            builder = builder.with_where(
+                operands[0] if len(operands) == 1 else {"operator": "And", "operands": operands})
+        res = builder.do()
     except Exception as e:
         return jsonify({"error": str(e)}), 500
 
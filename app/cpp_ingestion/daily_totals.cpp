@@ -0,0 +1,146 @@
+#include "daily_totals.hpp"
+#include <algorithm>
+#include <cmath>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace health_ingestion {
+
+namespace {
+
+// Sums of decimal inputs pick up binary noise (0.1 + 0.2); two places is what the
+// inputs carry
+double rounded(double value) {
+    return std::round(value * 100.0) / 100.0;
+}
+
+json meanOrNull(double sum, uint32_t count) {
+    return count ? json(rounded(sum / count)) : json();
+}
+
+json valueOrNull(double value) {
+    return std::isnan(value) ? json() : json(value);
+}
+
+// `later` wins where it has a value
+void latest(double& value, double later) {
+    if (!std::isnan(later)) value = later;
+}
+
+} // namespace
+
+void DailyTotals::add(const ActivityRecord& record) {
+    using F = ActivityRecord;
+    calories_burned += record.fields.number(F::CaloriesBurned);
+    steps += record.fields.number(F::Steps);
+    distance += record.fields.number(F::Distance);
+    active_minutes += record.fields.number(F::Duration);
+    activities++;
+}
+
+void DailyTotals::add(const WorkoutRecord& record) {
+    using F = WorkoutRecord;
+    calories_burned += record.fields.number(F::CaloriesBurned);
+    active_minutes += record.fields.number(F::Duration);
+    workouts++;
+}
+
+void DailyTotals::add(const NutritionRecord& record) {
+    using F = NutritionRecord;
+    calories_consumed += record.fields.number(F::Calories);
+    protein += record.fields.number(F::Protein);
+    carbs += record.fields.number(F::Carbs);
+    fat += record.fields.number(F::Fat);
+    meals++;
+}
+
+void DailyTotals::add(const SleepRecord& record) {
+    using F = SleepRecord;
+    sleep_hours += record.fields.number(F::TotalSleep);
+    deep_sleep_hours += record.fields.number(F::DeepSleep);
+    rem_sleep_hours += record.fields.number(F::RemSleep);
+    resting_heart_rate_sum += record.fields.number(F::RestingHeartRate);
+    sleep_records++;
+}
+
+void DailyTotals::add(const MeasurementRecord& record) {
+    using F = MeasurementRecord;
+    const auto& f = record.fields;
+    if (f.numeric(F::Weight)) weight = f.number(F::Weight);
+    if (f.numeric(F::BodyFat)) body_fat = f.number(F::BodyFat);
+    if (f.numeric(F::MuscleMass)) muscle_mass = f.number(F::MuscleMass);
+    if (f.numeric(F::BloodPressureSystolic)) blood_pressure_systolic = f.number(F::BloodPressureSystolic);
+    if (f.numeric(F::BloodPressureDiastolic)) blood_pressure_diastolic = f.number(F::BloodPressureDiastolic);
+}
+
+void DailyTotals::add(const HeartRateRecord& record) {
+    if (!record.fields.numeric(HeartRateRecord::Value)) return;
+    double bpm = record.fields.number(HeartRateRecord::Value);
+    heart_rate_min = std::min(heart_rate_min, bpm);
+    heart_rate_max = std::max(heart_rate_max, bpm);
+    heart_rate_sum += bpm;
+    heart_rate_readings++;
+}
+
+void DailyTotals::merge(const DailyTotals& other) {
+    calories_burned += other.calories_burned;
+    calories_consumed += other.calories_consumed;
+    protein += other.protein;
+    carbs += other.carbs;
+    fat += other.fat;
+    steps += other.steps;
+    distance += other.distance;
+    active_minutes += other.active_minutes;
+    sleep_hours += other.sleep_hours;
+    deep_sleep_hours += other.deep_sleep_hours;
+    rem_sleep_hours += other.rem_sleep_hours;
+    resting_heart_rate_sum += other.resting_heart_rate_sum;
+    heart_rate_min = std::min(heart_rate_min, other.heart_rate_min);
+    heart_rate_max = std::max(heart_rate_max, other.heart_rate_max);
+    heart_rate_sum += other.heart_rate_sum;
+    heart_rate_readings += other.heart_rate_readings;
+    activities += other.activities;
+    workouts += other.workouts;
+    meals += other.meals;
+    sleep_records += other.sleep_records;
+    latest(weight, other.weight);
+    latest(body_fat, other.body_fat);
+    latest(muscle_mass, other.muscle_mass);
+    latest(blood_pressure_systolic, other.blood_pressure_systolic);
+    latest(blood_pressure_diastolic, other.blood_pressure_diastolic);
+}
+
+json DailyTotals::toJson() const {
+    bool has_heart_rate = heart_rate_readings > 0;
+    return {
+        {"calories_burned", rounded(calories_burned)},
+        {"calories_consumed", rounded(calories_consumed)},
+        {"calorie_balance", rounded(calories_consumed - calories_burned)},
+        {"protein_g", rounded(protein)},
+        {"carbs_g", rounded(carbs)},
+        {"fat_g", rounded(fat)},
+        {"steps", std::llround(steps)},
+        {"distance_km", rounded(distance)},
+        {"active_minutes", rounded(active_minutes)},
+        {"sleep_hours", rounded(sleep_hours)},
+        {"deep_sleep_hours", rounded(deep_sleep_hours)},
+        {"rem_sleep_hours", rounded(rem_sleep_hours)},
+        {"resting_heart_rate", meanOrNull(resting_heart_rate_sum, sleep_records)},
+        {"heart_rate_min", has_heart_rate ? json(heart_rate_min) : json()},
+        {"heart_rate_max", has_heart_rate ? json(heart_rate_max) : json()},
+        {"heart_rate_mean", meanOrNull(heart_rate_sum, heart_rate_readings)},
+        {"heart_rate_readings", heart_rate_readings},
+        {"activities", activities},
+        {"workouts", workouts},
+        {"meals", meals},
+        {"sleep_records", sleep_records},
+        {"weight_kg", valueOrNull(weight)},
+        {"body_fat_pct", valueOrNull(body_fat)},
+        {"muscle_mass_kg", valueOrNull(muscle_mass)},
+        {"blood_pressure_systolic", valueOrNull(blood_pressure_systolic)},
+        {"blood_pressure_diastolic", valueOrNull(blood_pressure_diastolic)}
+    };
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "record_format.hpp"
+#include <cstdint>
+#include <limits>
+#include <nlohmann/json_fwd.hpp>
+
+namespace health_ingestion {
+
+// Numeric totals of one user-day, accumulated record by record as the day is
+// aggregated, so analytics get structured figures without re-parsing summary text.
+// Fixed layout and trivially copyable; partials of the same day combine with merge().
+struct DailyTotals {
+    double calories_burned = 0;     // Activities and workouts
+    double calories_consumed = 0;   // Meals
+    double protein = 0;             // Grams
+    double carbs = 0;
+    double fat = 0;
+    double steps = 0;
+    double distance = 0;            // km
+    double active_minutes = 0;      // Activity and workout durations
+    double sleep_hours = 0;
+    double deep_sleep_hours = 0;
+    double rem_sleep_hours = 0;
+    double resting_heart_rate_sum = 0;
+    double heart_rate_min = std::numeric_limits<double>::infinity();
+    double heart_rate_max = -std::numeric_limits<double>::infinity();
+    double heart_rate_sum = 0;
+    uint32_t heart_rate_readings = 0;
+    uint32_t activities = 0;
+    uint32_t workouts = 0;
+    uint32_t meals = 0;
+    uint32_t sleep_records = 0;
+    // Latest measurement of the day, NaN when none was reported
+    double weight = std::numeric_limits<double>::quiet_NaN();
+    double body_fat = std::numeric_limits<double>::quiet_NaN();
+    double muscle_mass = std::numeric_limits<double>::quiet_NaN();
+    double blood_pressure_systolic = std::numeric_limits<double>::quiet_NaN();
+    double blood_pressure_diastolic = std::numeric_limits<double>::quiet_NaN();
+
+    void add(const ActivityRecord& record);
+    void add(const WorkoutRecord& record);
+    void add(const NutritionRecord& record);
+    void add(const SleepRecord& record);
+    // Later measurements replace earlier ones field by field; non-numeric values are ignored
+    void add(const MeasurementRecord& record);
+    // Non-numeric readings are ignored
+    void add(const HeartRateRecord& record);
+    void merge(const DailyTotals& other);
+
+    // The "totals" object sent in each summary's meta. Sums are rounded to 0.01;
+    // heart-rate and measurement figures are null on days without them
+    nlohmann::json toJson() const;
+};
+
+} // namespace health_ingestion
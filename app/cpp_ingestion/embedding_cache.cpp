@@ -0,0 +1,391 @@
+#include "embedding_cache.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr char kMagic[8] = {'H', 'E', 'M', 'B', 'C', '0', '0', '1'};
+constexpr size_t kHeaderBytes = 64;
+constexpr size_t kMinCapacity = 1024;
+
+// Slot layout: key lo, key hi, state, padding, then the vector
+constexpr size_t kSlotKeyLo = 0;
+constexpr size_t kSlotKeyHi = 8;
+constexpr size_t kSlotState = 16;
+constexpr size_t kSlotVector = 24;
+
+// Slot states: never claimed, published, or being written by the process whose pid is
+// state - 1. A writer that dies leaves its pid behind, so the slot can be taken over.
+constexpr uint32_t kSlotEmpty = 0;
+constexpr uint32_t kSlotReady = 1;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && sizeof(std::atomic<uint64_t>) == 8,
+              "cache slots need address-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free && sizeof(std::atomic<uint32_t>) == 4,
+              "cache slots need address-free 32-bit atomics");
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+template <typename T>
+std::atomic<T>& atomicAt(unsigned char* p) {
+    return *reinterpret_cast<std::atomic<T>*>(p);
+}
+
+size_t slotBytes(size_t dimension) {
+    return (kSlotVector + dimension * sizeof(float) + 7) & ~size_t(7);
+}
+
+// Smallest power of two that holds `entries` at half load
+size_t capacityFor(size_t entries) {
+    size_t capacity = kMinCapacity;
+    while (capacity < entries * 2) capacity <<= 1;
+    return capacity;
+}
+
+std::string errnoText() { return std::strerror(errno); }
+
+uint32_t writerState() { return static_cast<uint32_t>(::getpid()) + 1; }
+
+// True once the process that claimed a slot in `state` has exited
+bool writerGone(uint32_t state) {
+    return ::kill(static_cast<pid_t>(state - 1), 0) != 0 && errno == ESRCH;
+}
+
+} // namespace
+
+struct EmbeddingCache::Header {
+    char magic[8];
+    uint32_t dimension;
+    uint32_t reserved;
+    uint64_t capacity;
+    std::atomic<uint64_t> count;
+};
+
+TextHash hashText(const std::string& text) {
+    // MurmurHash3_x64_128 with seed 0
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t len = text.size();
+    uint64_t h1 = 0, h2 = 0;
+
+    const size_t blocks = len / 16;
+    for (size_t i = 0; i < blocks; ++i) {
+        uint64_t k1, k2;
+        std::memcpy(&k1, data + i * 16, 8);
+        std::memcpy(&k2, data + i * 16 + 8, 8);
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const unsigned char* tail = data + blocks * 16;
+    uint64_t k1 = 0, k2 = 0;
+    switch (len & 15) {
+        case 15: k2 ^= uint64_t(tail[14]) << 48; [[fallthrough]];
+        case 14: k2 ^= uint64_t(tail[13]) << 40; [[fallthrough]];
+        case 13: k2 ^= uint64_t(tail[12]) << 32; [[fallthrough]];
+        case 12: k2 ^= uint64_t(tail[11]) << 24; [[fallthrough]];
+        case 11: k2 ^= uint64_t(tail[10]) << 16; [[fallthrough]];
+        case 10: k2 ^= uint64_t(tail[9]) << 8; [[fallthrough]];
+        case 9:
+            k2 ^= uint64_t(tail[8]);
+            k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+            [[fallthrough]];
+        case 8: k1 ^= uint64_t(tail[7]) << 56; [[fallthrough]];
+        case 7: k1 ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+        case 6: k1 ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+        case 5: k1 ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+        case 4: k1 ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+        case 3: k1 ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+        case 2: k1 ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+        case 1:
+            k1 ^= uint64_t(tail[0]);
+            k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+    return {h1, h2};
+}
+
+// Creates an empty table of `capacity` slots in fd, which must be empty
+static bool initialise(int fd, const std::string& path, size_t dimension, size_t capacity) {
+    size_t bytes = kHeaderBytes + capacity * slotBytes(dimension);
+    // Sparse file: slots cost disk space only once written
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        std::cerr << "Failed to size embedding cache " << path << ": " << errnoText() << std::endl;
+        return false;
+    }
+    unsigned char header[kHeaderBytes] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    uint32_t dim32 = static_cast<uint32_t>(dimension);
+    uint64_t cap64 = capacity;
+    std::memcpy(header + 8, &dim32, 4);
+    std::memcpy(header + 16, &cap64, 8);
+    if (::pwrite(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        std::cerr << "Failed to write embedding cache " << path << ": " << errnoText() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<EmbeddingCache> EmbeddingCache::open(const std::string& path, size_t dimension,
+                                                     size_t min_entries) {
+    if (dimension == 0) {
+        std::cerr << "Embedding cache " << path << " needs a vector dimension" << std::endl;
+        return nullptr;
+    }
+    const size_t slot_bytes = slotBytes(dimension);
+
+    // Retried if another process replaced the file (after growing it) while we waited
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "Failed to open embedding cache " << path << ": " << errnoText() << std::endl;
+            return nullptr;
+        }
+        auto fail = [&]() -> std::unique_ptr<EmbeddingCache> {
+            ::close(fd);
+            return nullptr;
+        };
+
+        // Exclusive only if nobody else has the cache open
+        bool exclusive = ::flock(fd, LOCK_EX | LOCK_NB) == 0;
+        if (!exclusive) {
+            while (::flock(fd, LOCK_SH) != 0) {
+                if (errno != EINTR) {
+                    std::cerr << "Failed to lock embedding cache " << path << ": " << errnoText() << std::endl;
+                    return fail();
+                }
+            }
+        }
+        struct stat fd_stat, path_stat;
+        if (::fstat(fd, &fd_stat) != 0 || ::stat(path.c_str(), &path_stat) != 0 ||
+            fd_stat.st_ino != path_stat.st_ino || fd_stat.st_dev != path_stat.st_dev) {
+            ::close(fd);
+            continue;
+        }
+
+        if (fd_stat.st_size == 0) {
+            if (!exclusive) {
+                std::cerr << "Embedding cache " << path << " is empty but in use by another process" << std::endl;
+                return fail();
+            }
+            if (!initialise(fd, path, dimension, capacityFor(min_entries))) {
+                return fail();
+            }
+        } else {
+            unsigned char header[kHeaderBytes];
+            if (::pread(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+                std::memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+                std::cerr << path << " is not an embedding cache" << std::endl;
+                return fail();
+            }
+            uint32_t file_dimension;
+            uint64_t capacity, count;
+            std::memcpy(&file_dimension, header + 8, 4);
+            std::memcpy(&capacity, header + 16, 8);
+            std::memcpy(&count, header + 24, 8);
+            if (file_dimension != dimension) {
+                std::cerr << "Embedding cache " << path << " holds " << file_dimension << "-d vectors, not "
+                          << dimension << "-d" << std::endl;
+                return fail();
+            }
+            if (capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+                static_cast<uint64_t>(fd_stat.st_size) != kHeaderBytes + capacity * slot_bytes) {
+                std::cerr << "Embedding cache " << path << " is truncated or corrupt" << std::endl;
+                return fail();
+            }
+
+            // A table that filled up last run has room for as many new entries again
+            size_t wanted = capacity;
+            if (count * 2 > capacity) wanted = capacityFor(count * 2);
+            wanted = std::max(wanted, capacityFor(min_entries));
+            if (exclusive && wanted > capacity) {
+                // Rehash into a fresh file, locked before it becomes visible at path
+                std::string tmp_path = path + ".tmp";
+                ::unlink(tmp_path.c_str());
+                int new_fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+                if (new_fd < 0 || ::flock(new_fd, LOCK_EX) != 0 ||
+                    !initialise(new_fd, tmp_path, dimension, wanted)) {
+                    if (new_fd >= 0) ::close(new_fd);
+                    ::unlink(tmp_path.c_str());
+                    return fail();
+                }
+                size_t old_bytes = static_cast<size_t>(fd_stat.st_size);
+                void* old_map = ::mmap(nullptr, old_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                size_t new_bytes = kHeaderBytes + wanted * slot_bytes;
+                void* new_map = ::mmap(nullptr, new_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, new_fd, 0);
+                if (old_map == MAP_FAILED || new_map == MAP_FAILED) {
+                    std::cerr << "Failed to map embedding cache " << path << ": " << errnoText() << std::endl;
+                    if (old_map != MAP_FAILED) ::munmap(old_map, old_bytes);
+                    if (new_map != MAP_FAILED) ::munmap(new_map, new_bytes);
+                    ::close(new_fd);
+                    ::unlink(tmp_path.c_str());
+                    return fail();
+                }
+                {
+                    EmbeddingCache from(path, -1, old_map, old_bytes);
+                    EmbeddingCache to(tmp_path, -1, new_map, new_bytes);
+                    std::vector<float> vector(dimension);
+                    for (size_t i = 0; i < from.capacity_; ++i) {
+                        unsigned char* s = from.slot(i);
+                        if (atomicAt<uint32_t>(s + kSlotState).load() != kSlotReady) {
+                            continue;  // Empty, or abandoned by a crashed writer
+                        }
+                        TextHash key;
+                        std::memcpy(&key.lo, s + kSlotKeyLo, 8);
+                        std::memcpy(&key.hi, s + kSlotKeyHi, 8);
+                        std::memcpy(vector.data(), s + kSlotVector, dimension * sizeof(float));
+                        to.insert(key, vector);
+                    }
+                }
+                if (::fsync(new_fd) != 0 || ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+                    std::cerr << "Failed to replace embedding cache " << path << ": " << errnoText() << std::endl;
+                    ::close(new_fd);
+                    ::unlink(tmp_path.c_str());
+                    return fail();
+                }
+                std::cout << "Embedding cache " << path << " grown from " << capacity << " to " << wanted
+                          << " slots (" << count << " entries)" << std::endl;
+                ::close(fd);
+                fd = new_fd;
+                fd_stat.st_size = static_cast<off_t>(new_bytes);
+            }
+        }
+
+        // Downgrade so other processes can share the table
+        if (exclusive && ::flock(fd, LOCK_SH) != 0) {
+            std::cerr << "Failed to lock embedding cache " << path << ": " << errnoText() << std::endl;
+            return fail();
+        }
+        struct stat final_stat;
+        if (::fstat(fd, &final_stat) != 0) return fail();
+        size_t bytes = static_cast<size_t>(final_stat.st_size);
+        void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            std::cerr << "Failed to map embedding cache " << path << ": " << errnoText() << std::endl;
+            return fail();
+        }
+        return std::unique_ptr<EmbeddingCache>(new EmbeddingCache(path, fd, map, bytes));
+    }
+    std::cerr << "Embedding cache " << path << " keeps being replaced; giving up" << std::endl;
+    return nullptr;
+}
+
+EmbeddingCache::EmbeddingCache(const std::string& path, int fd, void* map, size_t map_bytes)
+    : path_(path)
+    , fd_(fd)
+    , map_(map)
+    , map_bytes_(map_bytes) {
+    static_assert(sizeof(Header) <= kHeaderBytes, "header must fit its reserved bytes");
+    dimension_ = header().dimension;
+    capacity_ = header().capacity;
+    slot_bytes_ = slotBytes(dimension_);
+}
+
+EmbeddingCache::~EmbeddingCache() {
+    if (map_) ::munmap(map_, map_bytes_);
+    if (fd_ >= 0) ::close(fd_);  // Releases the flock once no forked copy holds it
+}
+
+EmbeddingCache::Header& EmbeddingCache::header() const {
+    return *reinterpret_cast<Header*>(map_);
+}
+
+unsigned char* EmbeddingCache::slot(size_t index) const {
+    return static_cast<unsigned char*>(map_) + kHeaderBytes + index * slot_bytes_;
+}
+
+size_t EmbeddingCache::size() const {
+    return header().count.load(std::memory_order_relaxed);
+}
+
+// Probes start at the high word; an empty slot ends the probe. Slots are only read once
+// published, and a published slot is never written again.
+bool EmbeddingCache::lookup(const TextHash& key, std::vector<float>& embedding) const {
+    const size_t mask = capacity_ - 1;
+    for (size_t i = 0, index = key.hi & mask; i < capacity_; ++i, index = (index + 1) & mask) {
+        unsigned char* s = slot(index);
+        uint32_t state = atomicAt<uint32_t>(s + kSlotState).load(std::memory_order_acquire);
+        if (state == kSlotEmpty) break;
+        if (state != kSlotReady) continue;
+        uint64_t lo, hi;
+        std::memcpy(&lo, s + kSlotKeyLo, 8);
+        std::memcpy(&hi, s + kSlotKeyHi, 8);
+        if (lo != key.lo || hi != key.hi) continue;
+        embedding.resize(dimension_);
+        std::memcpy(embedding.data(), s + kSlotVector, dimension_ * sizeof(float));
+        return true;
+    }
+    return false;
+}
+
+bool EmbeddingCache::insert(const TextHash& key, const std::vector<float>& embedding) {
+    if (embedding.size() != dimension_) return false;
+    if (header().count.load(std::memory_order_relaxed) >= static_cast<uint64_t>(capacity_ * kMaxLoad)) {
+        if (!full_warned_.exchange(true)) {
+            std::cerr << "Warning: embedding cache " << path_ << " is full (" << capacity_
+                      << " slots); new vectors are not cached until it is reopened and grown" << std::endl;
+        }
+        return false;
+    }
+    const uint32_t writer = writerState();
+    const size_t mask = capacity_ - 1;
+    for (size_t i = 0, index = key.hi & mask; i < capacity_; ++i, index = (index + 1) & mask) {
+        unsigned char* s = slot(index);
+        auto& state = atomicAt<uint32_t>(s + kSlotState);
+        uint32_t current = state.load(std::memory_order_acquire);
+        // Claim an empty slot, or one whose writer died before publishing it
+        bool claimed = false;
+        if (current == kSlotEmpty || (current != kSlotReady && writerGone(current))) {
+            claimed = state.compare_exchange_strong(current, writer, std::memory_order_acq_rel);
+        }
+        if (claimed) {
+            std::memcpy(s + kSlotKeyLo, &key.lo, 8);
+            std::memcpy(s + kSlotKeyHi, &key.hi, 8);
+            std::memcpy(s + kSlotVector, embedding.data(), dimension_ * sizeof(float));
+            state.store(kSlotReady, std::memory_order_release);
+            header().count.fetch_add(1, std::memory_order_relaxed);
+            inserts_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        // `current` now holds the slot's state; one being written may be this key, but
+        // its key is not readable until published, so probe on (a duplicate is harmless)
+        if (current != kSlotReady) continue;
+        uint64_t lo, hi;
+        std::memcpy(&lo, s + kSlotKeyLo, 8);
+        std::memcpy(&hi, s + kSlotKeyHi, 8);
+        if (lo == key.lo && hi == key.hi) return true;  // Already cached
+    }
+    return false;
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace health_ingestion {
+
+// 128-bit MurmurHash3 (x64) of a summary text; the cache key
+struct TextHash {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+};
+
+TextHash hashText(const std::string& text);
+
+// Persistent map from summary text hash to embedding, so re-runs only embed novel
+// summaries.
+//
+// The file is an open-addressing hash table mapped with MAP_SHARED: a 64-byte header
+// (magic, dimension, capacity, entry count) followed by fixed-size slots holding the
+// key and the vector. Inserts claim a slot with a compare-and-swap on its state word,
+// which holds the writer's pid until the key and vector are published, so threads and
+// forked worker processes can look up and insert concurrently without locks. A slot
+// whose writer died before publishing is taken over by the next insert that probes
+// it. Published entries are never removed.
+//
+// Every process holds a shared flock() on the file while it is mapped. The table is
+// only created or grown (rehashed into a new file that replaces the old one) under an
+// exclusive lock, i.e. when no other process is using it; a full table stops taking
+// new entries until the next open can grow it.
+class EmbeddingCache {
+public:
+    // Opens or creates the cache at path for vectors of `dimension` floats, growing it
+    // so at least min_entries fit. Returns nullptr (after logging why) on failure.
+    static std::unique_ptr<EmbeddingCache> open(const std::string& path, size_t dimension, size_t min_entries);
+    ~EmbeddingCache();
+
+    EmbeddingCache(const EmbeddingCache&) = delete;
+    EmbeddingCache& operator=(const EmbeddingCache&) = delete;
+
+    // Copies the cached vector for key into embedding; false on a miss
+    bool lookup(const TextHash& key, std::vector<float>& embedding) const;
+
+    // Stores a vector of dimension() floats; false if the table is full
+    bool insert(const TextHash& key, const std::vector<float>& embedding);
+
+    size_t dimension() const { return dimension_; }
+    size_t capacity() const { return capacity_; }
+    size_t size() const;
+    const std::string& path() const { return path_; }
+
+    // Entries added by this process
+    uint64_t inserts() const { return inserts_.load(std::memory_order_relaxed); }
+
+    // Entries beyond this fraction of capacity are refused; opens grow the table
+    // once it is half full
+    static constexpr double kMaxLoad = 0.75;
+
+private:
+    struct Header;
+
+    EmbeddingCache(const std::string& path, int fd, void* map, size_t map_bytes);
+
+    Header& header() const;
+    unsigned char* slot(size_t index) const;
+
+    std::string path_;
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_bytes_ = 0;
+    size_t dimension_ = 0;
+    size_t capacity_ = 0;      // Power of two
+    size_t slot_bytes_ = 0;
+    std::atomic<uint64_t> inserts_{0};
+    std::atomic<bool> full_warned_{false};
+};
+
+} // namespace health_ingestion
@@ -0,0 +1,300 @@
+#include "embedding_model.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace health_ingestion {
+
+namespace {
+
+// model.bin starts with this magic, then the EncoderConfig fields as little-endian
+// u32s (eps as f32), then float32 tensors in Hugging Face BertModel order
+constexpr char kModelMagic[8] = {'H', 'B', 'E', 'R', 'T', '0', '0', '1'};
+
+// Register tile of the linear layers: token rows x output columns
+constexpr size_t kRows = 6;
+constexpr size_t kCols = 32;
+
+// Accumulates a Rows x kCols block of outputs over the whole input dimension, so
+// each weight load feeds Rows multiply-adds and the partial sums stay in registers.
+// `weight` and `out` point at the block's first column; rows are `stride` apart.
+template <size_t Rows>
+void linearTile(const float* in, size_t n_in, const float* weight, size_t stride, const float* bias, float* out) {
+    float acc[Rows][kCols];
+    for (size_t k = 0; k < Rows; ++k) {
+        for (size_t j = 0; j < kCols; ++j) acc[k][j] = bias[j];
+    }
+    for (size_t i = 0; i < n_in; ++i) {
+        const float* w = weight + i * stride;
+        for (size_t k = 0; k < Rows; ++k) {
+            const float x = in[k * n_in + i];
+            for (size_t j = 0; j < kCols; ++j) acc[k][j] += x * w[j];
+        }
+    }
+    for (size_t k = 0; k < Rows; ++k) {
+        std::copy(acc[k], acc[k] + kCols, out + k * stride);
+    }
+}
+
+// exp() without libm calls, so the softmax and GELU loops vectorise: Cephes expf
+// polynomial after reducing by powers of two, within 2 ulp over the range we use
+inline float fastExp(float x) {
+    x = x < -87.0f ? -87.0f : x;
+    x = x > 88.0f ? 88.0f : x;
+    // Round to nearest by truncation; std::floor would block vectorisation
+    const float scaled = x * 1.44269504088896341f;
+    const float n = static_cast<float>(static_cast<int32_t>(scaled + std::copysign(0.5f, scaled)));
+    const float r = x - n * 0.693359375f + n * 2.12194440e-4f;
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+    const int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+    return p * __builtin_bit_cast(float, bits);  // 2^n
+}
+
+// BERT's exact (erf) GELU, not the tanh approximation. erf comes from the Numerical
+// Recipes erfc fit (relative error below 1.2e-7), which needs only fastExp().
+inline float gelu(float x) {
+    const float z = std::fabs(x) * 0.70710678118654752f;
+    const float t = 1.0f / (1.0f + 0.5f * z);
+    const float erfc = t * fastExp(-z * z - 1.26551223f +
+        t * (1.00002368f + t * (0.37409196f + t * (0.09678418f + t * (-0.18628806f +
+        t * (0.27886807f + t * (-1.13520398f + t * (1.48851587f + t * (-0.82215223f + t * 0.17087277f)))))))));
+    const float erf = std::copysign(1.0f - erfc, x);
+    return 0.5f * x * (1.0f + erf);
+}
+
+} // namespace
+
+std::unique_ptr<SentenceEncoder> SentenceEncoder::load(const std::string& model_dir) {
+    std::unique_ptr<SentenceEncoder> encoder(new SentenceEncoder());
+    if (!encoder->tokenizer_.load(model_dir + "/vocab.txt") || !encoder->readWeights(model_dir + "/model.bin")) {
+        return nullptr;
+    }
+    if (encoder->config_.vocab_size != encoder->tokenizer_.vocabSize()) {
+        std::cerr << "Model " << model_dir << " expects " << encoder->config_.vocab_size
+                  << " tokens but vocab.txt has " << encoder->tokenizer_.vocabSize() << std::endl;
+        return nullptr;
+    }
+    return encoder;
+}
+
+bool SentenceEncoder::readWeights(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open model weights " << path << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(kModelMagic)];
+    uint32_t shape[7];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(shape), sizeof(shape));
+    file.read(reinterpret_cast<char*>(&config_.layer_norm_eps), sizeof(float));
+    if (!file || std::memcmp(magic, kModelMagic, sizeof(magic)) != 0) {
+        std::cerr << path << " is not a model.bin written by export_minilm.py" << std::endl;
+        return false;
+    }
+    config_.vocab_size = shape[0];
+    config_.hidden = shape[1];
+    config_.layers = shape[2];
+    config_.heads = shape[3];
+    config_.intermediate = shape[4];
+    config_.max_positions = shape[5];
+    config_.type_vocab = shape[6];
+    if (config_.hidden == 0 || config_.heads == 0 || config_.hidden % config_.heads != 0 ||
+        config_.type_vocab == 0 || config_.max_positions == 0) {
+        std::cerr << "Invalid model shape in " << path << std::endl;
+        return false;
+    }
+
+    auto tensor = [&](std::vector<float>& values, size_t count) {
+        values.resize(count);
+        file.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(float)));
+    };
+    auto linear = [&](Linear& layer, size_t in, size_t out) {
+        // PyTorch stores [out][in]; transpose once so the forward pass streams rows
+        std::vector<float> raw;
+        tensor(raw, in * out);
+        layer.in = in;
+        layer.out = out;
+        layer.weight.resize(in * out);
+        for (size_t o = 0; o < out; ++o) {
+            for (size_t i = 0; i < in; ++i) {
+                layer.weight[i * out + o] = raw[o * in + i];
+            }
+        }
+        tensor(layer.bias, out);
+    };
+    auto norm = [&](LayerNorm& layer) {
+        tensor(layer.gamma, config_.hidden);
+        tensor(layer.beta, config_.hidden);
+    };
+
+    const size_t hidden = config_.hidden;
+    tensor(word_embeddings_, static_cast<size_t>(config_.vocab_size) * hidden);
+    tensor(position_embeddings_, static_cast<size_t>(config_.max_positions) * hidden);
+    tensor(type_embeddings_, static_cast<size_t>(config_.type_vocab) * hidden);
+    norm(embedding_norm_);
+    layers_.resize(config_.layers);
+    for (Layer& layer : layers_) {
+        linear(layer.query, hidden, hidden);
+        linear(layer.key, hidden, hidden);
+        linear(layer.value, hidden, hidden);
+        linear(layer.attention_out, hidden, hidden);
+        norm(layer.attention_norm);
+        linear(layer.intermediate, hidden, config_.intermediate);
+        linear(layer.output, config_.intermediate, hidden);
+        norm(layer.output_norm);
+    }
+
+    if (!file || file.peek() != std::char_traits<char>::eof()) {
+        std::cerr << "Model weights " << path << " do not match the header shape" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void SentenceEncoder::linear(const Linear& layer, const float* in, size_t rows, float* out) const {
+    const size_t n_in = layer.in;
+    const size_t n_out = layer.out;
+    const float* weight = layer.weight.data();
+    const float* bias = layer.bias.data();
+
+    // Column panels outermost: one panel of weights (n_in x kCols, at most ~200 KB)
+    // stays cache-resident while every token row is multiplied against it
+    size_t j0 = 0;
+    for (; j0 + kCols <= n_out; j0 += kCols) {
+        size_t r = 0;
+        for (; r + kRows <= rows; r += kRows) {
+            linearTile<kRows>(in + r * n_in, n_in, weight + j0, n_out, bias + j0, out + r * n_out + j0);
+        }
+        for (; r < rows; ++r) {
+            linearTile<1>(in + r * n_in, n_in, weight + j0, n_out, bias + j0, out + r * n_out + j0);
+        }
+    }
+    for (size_t r = 0; r < rows && j0 < n_out; ++r) {
+        for (size_t j = j0; j < n_out; ++j) {
+            float sum = bias[j];
+            for (size_t i = 0; i < n_in; ++i) sum += in[r * n_in + i] * weight[i * n_out + j];
+            out[r * n_out + j] = sum;
+        }
+    }
+}
+
+void SentenceEncoder::layerNorm(const LayerNorm& norm, float* rows, size_t count) const {
+    const size_t hidden = config_.hidden;
+    for (size_t r = 0; r < count; ++r) {
+        float* row = rows + r * hidden;
+        float mean = 0;
+        for (size_t j = 0; j < hidden; ++j) mean += row[j];
+        mean /= static_cast<float>(hidden);
+        float variance = 0;
+        for (size_t j = 0; j < hidden; ++j) variance += (row[j] - mean) * (row[j] - mean);
+        variance /= static_cast<float>(hidden);
+        const float scale = 1.0f / std::sqrt(variance + config_.layer_norm_eps);
+        for (size_t j = 0; j < hidden; ++j) {
+            row[j] = (row[j] - mean) * scale * norm.gamma[j] + norm.beta[j];
+        }
+    }
+}
+
+std::vector<float> SentenceEncoder::embed(const std::string& text) const {
+    return embedTokens(tokenizer_.encode(text, std::min<size_t>(max_tokens, config_.max_positions)));
+}
+
+std::vector<float> SentenceEncoder::embedTokens(const std::vector<int32_t>& ids) const {
+    const size_t tokens = std::min<size_t>(ids.size(), config_.max_positions);
+    const size_t hidden = config_.hidden;
+    const size_t heads = config_.heads;
+    const size_t head_dim = hidden / heads;
+    const float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
+    if (tokens == 0) return std::vector<float>(hidden, 0.0f);
+
+    // Embeddings: word + position + token type 0
+    std::vector<float> x(tokens * hidden);
+    for (size_t t = 0; t < tokens; ++t) {
+        size_t id = ids[t] >= 0 && static_cast<uint32_t>(ids[t]) < config_.vocab_size
+                        ? static_cast<size_t>(ids[t]) : static_cast<size_t>(tokenizer_.unkId());
+        const float* word = &word_embeddings_[id * hidden];
+        const float* position = &position_embeddings_[t * hidden];
+        for (size_t j = 0; j < hidden; ++j) {
+            x[t * hidden + j] = word[j] + position[j] + type_embeddings_[j];
+        }
+    }
+    layerNorm(embedding_norm_, x.data(), tokens);
+
+    std::vector<float> q(tokens * hidden), k(tokens * hidden), v(tokens * hidden);
+    std::vector<float> context(tokens * hidden), projected(tokens * hidden);
+    std::vector<float> inner(tokens * config_.intermediate);
+    std::vector<float> scores(tokens), keys(tokens * head_dim);
+
+    for (const Layer& layer : layers_) {
+        linear(layer.query, x.data(), tokens, q.data());
+        linear(layer.key, x.data(), tokens, k.data());
+        linear(layer.value, x.data(), tokens, v.data());
+
+        // Scaled dot-product attention per head; every token attends to every token
+        std::fill(context.begin(), context.end(), 0.0f);
+        for (size_t h = 0; h < heads; ++h) {
+            const size_t offset = h * head_dim;
+            // Keys transposed to [dim][token] so scores accumulate across tokens in
+            // vector lanes instead of as one serial dot product per pair
+            for (size_t s = 0; s < tokens; ++s) {
+                for (size_t d = 0; d < head_dim; ++d) keys[d * tokens + s] = k[s * hidden + offset + d];
+            }
+            for (size_t t = 0; t < tokens; ++t) {
+                const float* query = &q[t * hidden + offset];
+                std::fill(scores.begin(), scores.end(), 0.0f);
+                for (size_t d = 0; d < head_dim; ++d) {
+                    const float qd = query[d] * scale;
+                    const float* key = &keys[d * tokens];
+                    for (size_t s = 0; s < tokens; ++s) scores[s] += qd * key[s];
+                }
+                float max_score = *std::max_element(scores.begin(), scores.end());
+                for (size_t s = 0; s < tokens; ++s) scores[s] = fastExp(scores[s] - max_score);
+                float total = 0;
+                for (size_t s = 0; s < tokens; ++s) total += scores[s];
+                float* out = &context[t * hidden + offset];
+                for (size_t s = 0; s < tokens; ++s) {
+                    const float weight = scores[s] / total;
+                    const float* value = &v[s * hidden + offset];
+                    for (size_t d = 0; d < head_dim; ++d) out[d] += weight * value[d];
+                }
+            }
+        }
+
+        // Post-norm residual blocks, as in BERT
+        linear(layer.attention_out, context.data(), tokens, projected.data());
+        for (size_t i = 0; i < x.size(); ++i) x[i] += projected[i];
+        layerNorm(layer.attention_norm, x.data(), tokens);
+
+        linear(layer.intermediate, x.data(), tokens, inner.data());
+        for (float& value : inner) value = gelu(value);
+        linear(layer.output, inner.data(), tokens, projected.data());
+        for (size_t i = 0; i < x.size(); ++i) x[i] += projected[i];
+        layerNorm(layer.output_norm, x.data(), tokens);
+    }
+
+    // Mean pooling over all tokens (no padding in a single sequence), then unit length
+    std::vector<float> embedding(hidden, 0.0f);
+    for (size_t t = 0; t < tokens; ++t) {
+        for (size_t j = 0; j < hidden; ++j) embedding[j] += x[t * hidden + j];
+    }
+    float norm = 0;
+    for (float& value : embedding) {
+        value /= static_cast<float>(tokens);
+        norm += value * value;
+    }
+    norm = std::max(std::sqrt(norm), 1e-12f);
+    for (float& value : embedding) value /= norm;
+    return embedding;
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "tokenizer.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace health_ingestion {
+
+// Shape of a BERT encoder, from the model.bin header
+struct EncoderConfig {
+    uint32_t vocab_size = 0;
+    uint32_t hidden = 0;          // 384 for all-MiniLM-L6-v2
+    uint32_t layers = 0;
+    uint32_t heads = 0;
+    uint32_t intermediate = 0;
+    uint32_t max_positions = 0;
+    uint32_t type_vocab = 0;
+    float layer_norm_eps = 1e-12f;
+};
+
+// CPU forward pass of a sentence-transformers BERT model (all-MiniLM-L6-v2):
+// WordPiece ids -> encoder -> mean pooling -> L2 normalisation, matching
+// SentenceTransformer.encode() so vectors are interchangeable with the API's.
+//
+// A model directory holds vocab.txt and model.bin as written by export_minilm.py.
+// The encoder is immutable once loaded, so one instance is shared by every thread.
+class SentenceEncoder {
+public:
+    // Returns nullptr (after logging why) if the directory is not a usable model
+    static std::unique_ptr<SentenceEncoder> load(const std::string& model_dir);
+
+    // Sentence embedding of `text`, truncated to max_tokens word pieces
+    std::vector<float> embed(const std::string& text) const;
+    std::vector<float> embedTokens(const std::vector<int32_t>& ids) const;
+
+    size_t dimension() const { return config_.hidden; }
+    const EncoderConfig& config() const { return config_; }
+    const WordPieceTokenizer& tokenizer() const { return tokenizer_; }
+
+    // all-MiniLM-L6-v2 is trained with max_seq_length 256
+    static constexpr size_t max_tokens = 256;
+
+private:
+    // Linear layer with its weight stored [in][out], so each output row is built from
+    // contiguous, vectorisable multiply-adds
+    struct Linear {
+        size_t in = 0, out = 0;
+        std::vector<float> weight;
+        std::vector<float> bias;
+    };
+    struct LayerNorm {
+        std::vector<float> gamma;
+        std::vector<float> beta;
+    };
+    struct Layer {
+        Linear query, key, value, attention_out;
+        LayerNorm attention_norm;
+        Linear intermediate, output;
+        LayerNorm output_norm;
+    };
+
+    SentenceEncoder() = default;
+    bool readWeights(const std::string& path);
+
+    void linear(const Linear& layer, const float* in, size_t rows, float* out) const;
+    void layerNorm(const LayerNorm& norm, float* rows, size_t count) const;
+
+    EncoderConfig config_;
+    WordPieceTokenizer tokenizer_;
+    std::vector<float> word_embeddings_;      // [vocab][hidden]
+    std::vector<float> position_embeddings_;  // [max_positions][hidden]
+    std::vector<float> type_embeddings_;      // [type_vocab][hidden]
+    LayerNorm embedding_norm_;
+    std::vector<Layer> layers_;
+};
+
+} // namespace health_ingestion
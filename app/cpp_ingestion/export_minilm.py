@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Export a sentence-transformers BERT model for health_ingestion --embed-model.
+
+Writes <out_dir>/vocab.txt and <out_dir>/model.bin (the layout read by
+embedding_model.cpp). Needs torch and transformers, i.e. the API's environment:
+
+    python export_minilm.py models/minilm
+    python export_minilm.py models/minilm --model sentence-transformers/all-MiniLM-L6-v2
+"""
+import argparse
+import os
+import shutil
+import struct
+
+import torch
+from transformers import AutoModel, AutoTokenizer
+
+MAGIC = b"HBERT001"
+
+
+def tensors(model):
+    """Yields the weights in the order SentenceEncoder::readWeights() expects."""
+    emb = model.embeddings
+    yield emb.word_embeddings.weight
+    yield emb.position_embeddings.weight
+    yield emb.token_type_embeddings.weight
+    yield emb.LayerNorm.weight
+    yield emb.LayerNorm.bias
+    for layer in model.encoder.layer:
+        attention = layer.attention
+        for linear in (attention.self.query, attention.self.key, attention.self.value, attention.output.dense):
+            yield linear.weight
+            yield linear.bias
+        yield attention.output.LayerNorm.weight
+        yield attention.output.LayerNorm.bias
+        yield layer.intermediate.dense.weight
+        yield layer.intermediate.dense.bias
+        yield layer.output.dense.weight
+        yield layer.output.dense.bias
+        yield layer.output.LayerNorm.weight
+        yield layer.output.LayerNorm.bias
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("out_dir")
+    parser.add_argument("--model", default="sentence-transformers/all-MiniLM-L6-v2")
+    args = parser.parse_args()
+
+    model = AutoModel.from_pretrained(args.model).eval()
+    tokenizer = AutoTokenizer.from_pretrained(args.model)
+    config = model.config
+    if config.hidden_act != "gelu" or config.position_embedding_type != "absolute":
+        raise SystemExit(f"{args.model}: only BERT models with GELU and absolute positions are supported")
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    tokenizer.save_vocabulary(args.out_dir)
+
+    path = os.path.join(args.out_dir, "model.bin")
+    with open(path + ".tmp", "wb") as out:
+        out.write(MAGIC)
+        out.write(struct.pack(
+            "<7If",
+            config.vocab_size, config.hidden_size, config.num_hidden_layers, config.num_attention_heads,
+            config.intermediate_size, config.max_position_embeddings, config.type_vocab_size,
+            config.layer_norm_eps))
+        with torch.no_grad():
+            for tensor in tensors(model):
+                out.write(tensor.detach().to(torch.float32).contiguous().numpy().tobytes())
+    shutil.move(path + ".tmp", path)
+    print(f"Wrote {path} ({config.num_hidden_layers} layers, {config.hidden_size}-d) and vocab.txt")
+
+
+if __name__ == "__main__":
+    main()
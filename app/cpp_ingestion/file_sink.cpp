@@ -0,0 +1,285 @@
+#include "file_sink.hpp"
+#include "health_processor.hpp"
+#include "task_scheduler.hpp"
+#include "metrics.hpp"
+#include <iostream>
+#include <filesystem>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr size_t kBlockBytes = 1 << 20;        // Lines handed to a writer at a time
+constexpr size_t kMaxQueuedBlocks = 16;        // Per shard, before producers wait
+constexpr size_t kWriteBytes = 4 << 20;        // Compressed bytes per write(2)
+constexpr size_t kDeflateChunk = 256 << 10;
+
+struct FileSinkMetrics {
+    Counter& bytes_written = metrics().counter(
+        "health_ingest_file_bytes_written_total", "Bytes written by the sharded file sink");
+    Counter& files_completed = metrics().counter(
+        "health_ingest_files_completed_total", "Output files closed and renamed into place");
+};
+
+FileSinkMetrics& fileMetrics() {
+    static FileSinkMetrics instance;
+    return instance;
+}
+
+// One output file being written by a shard's writer thread
+class RollingFile {
+public:
+    RollingFile(const std::string& dir, size_t shard, int level) : dir_(dir), shard_(shard), level_(level) {}
+    ~RollingFile() { close(); }
+
+    uint64_t rawBytes() const { return raw_bytes_; }
+    bool isOpen() const { return fd_ >= 0; }
+
+    bool append(const std::string& data) {
+        if (!isOpen() && !open()) return false;
+        raw_bytes_ += data.size();
+        if (level_ == 0) {
+            out_ += data;
+        } else {
+            zs_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+            zs_.avail_in = static_cast<uInt>(data.size());
+            while (zs_.avail_in > 0) {
+                deflateChunk(Z_NO_FLUSH);
+            }
+        }
+        return out_.size() < kWriteBytes || writeOut();
+    }
+
+    // Completes the stream, syncs it and renames it into place
+    bool close() {
+        if (!isOpen()) return true;
+        bool ok = true;
+        if (level_ > 0) {
+            zs_.avail_in = 0;
+            while (deflateChunk(Z_FINISH) != Z_STREAM_END) {
+            }
+            deflateEnd(&zs_);
+        }
+        ok = writeOut() && ::fdatasync(fd_) == 0;
+        ::close(fd_);
+        fd_ = -1;
+        if (ok && std::rename(tmp_path_.c_str(), final_path_.c_str()) != 0) {
+            ok = false;
+        }
+        if (ok) {
+            fileMetrics().files_completed.inc();
+        } else {
+            std::cerr << "Failed to complete " << final_path_ << ": " << std::strerror(errno) << std::endl;
+        }
+        return ok;
+    }
+
+private:
+    bool open() {
+        char name[96];
+        std::snprintf(name, sizeof(name), "part-%d-%03zu-%05zu.ndjson%s", static_cast<int>(getpid()), shard_,
+                      seq_++, level_ > 0 ? ".gz" : "");
+        final_path_ = dir_ + "/" + name;
+        tmp_path_ = dir_ + "/." + name + ".tmp";
+        fd_ = ::open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            std::cerr << "Cannot create " << tmp_path_ << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        raw_bytes_ = 0;
+        out_.clear();
+        if (level_ > 0) {
+            zs_ = z_stream();
+            // windowBits 15 + 16 selects a gzip header, so files work with zcat and gzip readers
+            if (deflateInit2(&zs_, level_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                ::close(fd_);
+                fd_ = -1;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int deflateChunk(int flush) {
+        size_t used = out_.size();
+        out_.resize(used + kDeflateChunk);
+        zs_.next_out = reinterpret_cast<Bytef*>(&out_[used]);
+        zs_.avail_out = static_cast<uInt>(kDeflateChunk);
+        int result = deflate(&zs_, flush);
+        out_.resize(used + kDeflateChunk - zs_.avail_out);
+        return result;
+    }
+
+    bool writeOut() {
+        size_t written = 0;
+        while (written < out_.size()) {
+            ssize_t n = ::write(fd_, out_.data() + written, out_.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Failed to write " << tmp_path_ << ": " << std::strerror(errno) << std::endl;
+                out_.clear();
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        fileMetrics().bytes_written.inc(out_.size());
+        out_.clear();
+        return true;
+    }
+
+    std::string dir_;
+    size_t shard_;
+    int level_;
+    size_t seq_ = 0;
+    int fd_ = -1;
+    z_stream zs_{};
+    uint64_t raw_bytes_ = 0;
+    std::string out_;
+    std::string tmp_path_;
+    std::string final_path_;
+};
+
+} // namespace
+
+struct ShardedFileSink::Shard {
+    explicit Shard(const FileSinkOptions& options, size_t index)
+        : file(options.dir, index, options.compression_level) {}
+
+    std::string pending;              // Producer-side lines not yet handed off
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> queue;    // Blocks awaiting the writer
+    bool close_requested = false;     // finish(): close the file once the queue drains
+    bool stopping = false;
+    bool failed = false;
+
+    RollingFile file;                 // Writer thread only
+    std::thread writer;
+};
+
+ShardedFileSink::ShardedFileSink(const FileSinkOptions& options, TaskScheduler& scheduler)
+    : options_(options), scheduler_(scheduler) {
+    std::error_code ec;
+    std::filesystem::create_directories(options_.dir, ec);
+    if (ec) {
+        throw std::runtime_error("cannot create " + options_.dir + ": " + ec.message());
+    }
+    for (size_t i = 0; i < options_.shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>(options_, i));
+        shards_.back()->pending.reserve(kBlockBytes + (64 << 10));
+    }
+    for (auto& shard : shards_) {
+        shard->writer = std::thread(&ShardedFileSink::writerLoop, this, std::ref(*shard));
+    }
+}
+
+ShardedFileSink::~ShardedFileSink() {
+    finish();
+    for (auto& shard : shards_) {
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->stopping = true;
+        }
+        shard->changed.notify_all();
+        shard->writer.join();
+    }
+}
+
+size_t ShardedFileSink::write(const SummaryBatch& batch, StageTimes& times) {
+    // Serialise in parallel into per-item slots, then route lines in batch order
+    std::vector<std::string> payloads(batch.size());
+    std::vector<StageTimes> task_times(batch.size());
+    scheduler_.parallelFor(batch.size(), [&](size_t i) {
+        ScopedStageTimer timer(task_times[i], Stage::Serialise);
+        const Summary& summary = batch[i];
+        payloads[i] = HealthDataProcessor::buildPayload(summary);
+    });
+    for (const auto& item_times : task_times) {
+        times.merge(item_times);
+    }
+
+    ScopedStageTimer timer(times, Stage::Send);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Shard& shard = *shards_[shardHash(batch[i].user_id) % shards_.size()];
+        shard.pending += payloads[i];
+        shard.pending += '\n';
+        if (shard.pending.size() >= kBlockBytes) {
+            enqueue(shard, std::move(shard.pending));
+            shard.pending = std::string();
+            shard.pending.reserve(kBlockBytes + (64 << 10));
+        }
+    }
+    return batch.size();
+}
+
+bool ShardedFileSink::finish() {
+    for (auto& shard : shards_) {
+        if (!shard->pending.empty()) {
+            enqueue(*shard, std::move(shard->pending));
+            shard->pending = std::string();
+        }
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->close_requested = true;
+        }
+        shard->changed.notify_all();
+    }
+
+    bool ok = true;
+    for (auto& shard : shards_) {
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        shard->changed.wait(lock, [&] { return !shard->close_requested; });
+        ok = ok && !shard->failed;
+    }
+    return ok;
+}
+
+void ShardedFileSink::enqueue(Shard& shard, std::string&& block) {
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.changed.wait(lock, [&] { return shard.queue.size() < kMaxQueuedBlocks; });
+        shard.queue.push_back(std::move(block));
+    }
+    shard.changed.notify_all();
+}
+
+void ShardedFileSink::writerLoop(Shard& shard) {
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    while (true) {
+        shard.changed.wait(lock, [&] { return !shard.queue.empty() || shard.close_requested || shard.stopping; });
+
+        if (!shard.queue.empty()) {
+            std::string block = std::move(shard.queue.front());
+            shard.queue.pop_front();
+            lock.unlock();
+            shard.changed.notify_all();  // Queue space for a waiting producer
+
+            bool ok = shard.file.append(block);
+            if (ok && shard.file.rawBytes() >= options_.roll_bytes) {
+                ok = shard.file.close();
+            }
+            lock.lock();
+            if (!ok) shard.failed = true;
+            continue;
+        }
+        if (shard.close_requested) {
+            lock.unlock();
+            bool ok = shard.file.close();
+            lock.lock();
+            if (!ok) shard.failed = true;
+            shard.close_requested = false;
+            shard.changed.notify_all();
+            continue;
+        }
+        break;  // Stopping with nothing left to write
+    }
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "output_sink.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace health_ingestion {
+
+struct FileSinkOptions {
+    std::string dir;
+    size_t shards = 4;
+    uint64_t roll_bytes = 256ull << 20;  // Uncompressed bytes per file before rolling over
+    int compression_level = 6;           // gzip level; 0 writes plain .ndjson
+};
+
+// Writes /ingest payloads as NDJSON into `shards` independent streams of rolling,
+// gzip-compressed files for offline bulk import. Summaries are routed by user, so
+// each user's days land in one stream. Serialisation runs on the caller's scheduler;
+// compression and file I/O run on one dedicated writer thread per shard, fed
+// through a bounded queue of large blocks, so the pipeline only waits when the
+// writers fall behind.
+//
+// Files are written as .<name>.tmp and renamed to
+// part-<pid>-<shard>-<seq>.ndjson[.gz] once complete, so importers never see
+// partial files and coordinated workers can share one directory.
+class ShardedFileSink : public OutputSink {
+public:
+    ShardedFileSink(const FileSinkOptions& options, TaskScheduler& scheduler);
+    ~ShardedFileSink() override;
+
+    size_t write(const SummaryBatch& batch, StageTimes& times) override;
+
+    // Hands off buffered lines and waits until every shard has closed its current file
+    bool finish() override;
+
+private:
+    struct Shard;
+
+    void writerLoop(Shard& shard);
+    void enqueue(Shard& shard, std::string&& block);
+
+    FileSinkOptions options_;
+    TaskScheduler& scheduler_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace health_ingestion
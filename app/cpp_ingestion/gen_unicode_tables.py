@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Regenerate unicode_tables.cpp from Python's unicodedata.
+
+The tables give the tokenizer the character classes BertNormalizer and
+BertPreTokenizer use: punctuation (category P*), control/format characters
+removed by clean_text (Cc, Cf, Co), non-spacing marks removed with accents (Mn),
+and the accent-stripped, lower-cased form of every character that has one, as
+BertNormalizer's strip_accents and lowercase produce it.
+
+    python gen_unicode_tables.py > unicode_tables.cpp
+"""
+import unicodedata
+
+def ranges(predicate):
+    result, start = [], None
+    for cp in range(0x110000):
+        if predicate(cp):
+            if start is None:
+                start = cp
+        elif start is not None:
+            result.append((start, cp - 1))
+            start = None
+    return result
+
+
+def category(cp):
+    return unicodedata.category(chr(cp))
+
+
+def fold(cp):
+    stripped = "".join(c for c in unicodedata.normalize("NFD", chr(cp)) if unicodedata.category(c) != "Mn")
+    return stripped.lower()
+
+
+def emit_ranges(name, items):
+    print(f"const CodeRange {name}[] = {{")
+    for i in range(0, len(items), 4):
+        row = ", ".join(f"{{0x{a:04X}, 0x{b:04X}}}" for a, b in items[i:i + 4])
+        print(f"    {row},")
+    print("};\n")
+
+
+def main():
+    punctuation = ranges(lambda cp: category(cp).startswith("P"))
+    control = ranges(lambda cp: category(cp) in ("Cc", "Cf", "Co") and chr(cp) not in "\t\n\r")
+    marks = ranges(lambda cp: category(cp) == "Mn")
+    # Every script is lower-cased, as the reference does: Cherokee, Georgian, Roman
+    # numerals and circled letters as well as Latin, Greek and Cyrillic
+    folds = []
+    for cp in range(0x80, 0x110000):
+        if category(cp) in ("Mn", "Cs") or 0xAC00 <= cp <= 0xD7A3:  # Hangul is decomposed in code
+            continue
+        folded = fold(cp)
+        if len(folded) == 1 and folded != chr(cp):
+            folds.append((cp, ord(folded)))
+
+    print("// Generated by gen_unicode_tables.py from Unicode %s; do not edit." % unicodedata.unidata_version)
+    print('#include "unicode_tables.hpp"')
+    print("#include <algorithm>\n")
+    print("namespace health_ingestion {\n")
+    print("namespace {\n")
+    print("struct CodeRange {\n    uint32_t first;\n    uint32_t last;\n};\n")
+    print("struct Fold {\n    uint32_t from;\n    uint32_t to;\n};\n")
+    emit_ranges("kPunctuation", punctuation)
+    emit_ranges("kControl", control)
+    emit_ranges("kMarks", marks)
+    print("const Fold kFolds[] = {")
+    for i in range(0, len(folds), 6):
+        row = ", ".join(f"{{0x{a:04X}, 0x{b:04X}}}" for a, b in folds[i:i + 6])
+        print(f"    {row},")
+    print("};\n")
+    print("""template <size_t N>
+bool inRanges(const CodeRange (&table)[N], uint32_t cp) {
+    auto it = std::upper_bound(table, table + N, cp, [](uint32_t value, const CodeRange& range) {
+        return value < range.first;
+    });
+    return it != table && cp <= (it - 1)->last;
+}
+
+} // namespace
+
+namespace unicode {
+
+bool isPunctuation(uint32_t cp) { return inRanges(kPunctuation, cp); }
+bool isControl(uint32_t cp) { return inRanges(kControl, cp); }
+bool isMark(uint32_t cp) { return inRanges(kMarks, cp); }
+
+uint32_t fold(uint32_t cp) {
+    auto end = kFolds + sizeof(kFolds) / sizeof(kFolds[0]);
+    auto it = std::lower_bound(kFolds, end, cp, [](const Fold& fold, uint32_t value) { return fold.from < value; });
+    return it != end && it->from == cp ? it->to : cp;
+}
+
+} // namespace unicode
+
+} // namespace health_ingestion""")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,326 @@
+#include "health_processor.hpp"
+#include "product_quantizer.hpp"
+#include "query_cache.hpp"
+#include "record_scanner.hpp"
+#include "record_format.hpp"
+#include "spill_store.hpp"
+#include "task_scheduler.hpp"
+#include "vector_scan.hpp"
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+
+using json = nlohmann::json;
+using namespace health_ingestion;
+
+namespace {
+
+// Synthetic records with the same fields and value ranges as the generated dataset
+json makeActivity(std::mt19937& rng, int user, int day) {
+    static const char* kTypes[] = {"Running", "Cycling", "Walking", "Swimming", "Yoga"};
+    static const char* kWeather[] = {"sunny", "cloudy", "rainy", "windy"};
+    std::uniform_int_distribution<int> pick(0, 3);
+    return {
+        {"user_id", "user_" + std::to_string(user)},
+        {"date", "2024-01-" + std::to_string(10 + day % 20)},
+        {"activity_type", kTypes[rng() % 5]},
+        {"duration", 20 + rng() % 70},
+        {"weather", kWeather[pick(rng)]},
+        {"calories_burned", 150 + rng() % 600},
+        {"distance", 1.0 + (rng() % 150) / 10.0},
+        {"steps", 2000 + rng() % 12000},
+        {"heart_rate_avg", 100 + rng() % 60},
+        {"heart_rate_max", 150 + rng() % 40}
+    };
+}
+
+json makeWorkout(std::mt19937& rng, int user, int day) {
+    static const char* kTypes[] = {"Strength", "HIIT", "Pilates", "CrossFit"};
+    return {
+        {"user_id", "user_" + std::to_string(user)},
+        {"date", "2024-01-" + std::to_string(10 + day % 20)},
+        {"workout_type", kTypes[rng() % 4]},
+        {"duration", 20 + rng() % 60},
+        {"sets", 3 + rng() % 3},
+        {"reps", 8 + rng() % 8},
+        {"calories_burned", 150 + rng() % 400}
+    };
+}
+
+json makeNutrition(std::mt19937& rng, int user, int day) {
+    static const char* kMeals[] = {"breakfast", "lunch", "dinner", "snack"};
+    return {
+        {"user_id", "user_" + std::to_string(user)},
+        {"date", "2024-01-" + std::to_string(10 + day % 20)},
+        {"meal_type", kMeals[rng() % 4]},
+        {"calories", 200 + rng() % 800},
+        {"protein", 5 + rng() % 50},
+        {"carbs", 10 + rng() % 100},
+        {"fat", 5 + rng() % 40}
+    };
+}
+
+json makeSleep(std::mt19937& rng, int user, int day) {
+    return {
+        {"user_id", "user_" + std::to_string(user)},
+        {"date", "2024-01-" + std::to_string(10 + day % 20)},
+        {"total_sleep", 5.0 + (rng() % 40) / 10.0},
+        {"deep_sleep", 1.0 + (rng() % 20) / 10.0},
+        {"rem_sleep", 1.0 + (rng() % 15) / 10.0},
+        {"sleep_quality", (rng() % 2) ? "good" : "fair"},
+        {"resting_heart_rate", 50 + rng() % 20}
+    };
+}
+
+json makeHeartRate(std::mt19937& rng, int user, int day) {
+    return {
+        {"user_id", "user_" + std::to_string(user)},
+        {"date_time", "2024-01-" + std::to_string(10 + day % 20) + " 08:" +
+                      std::to_string(10 + rng() % 50) + ":00"},
+        {"value", 55 + rng() % 100}
+    };
+}
+
+UserProfile benchProfile(int user) {
+    return {"user_" + std::to_string(user), "Bench User " + std::to_string(user), 35,
+            symbols().intern("female"), 168.0, 62.5, symbols().intern("intermediate")};
+}
+
+// A realistic user-day: a few activities, workouts, meals, one sleep record and
+// `heart_rates` minute-level readings
+DayData makeDay(std::mt19937& rng, size_t heart_rates) {
+    DayData day;
+    for (int i = 0; i < 2; ++i) day.add(parseRecord<ActivityRecord>(makeActivity(rng, 0, 0)));
+    day.add(parseRecord<WorkoutRecord>(makeWorkout(rng, 0, 0)));
+    for (int i = 0; i < 4; ++i) day.add(parseRecord<NutritionRecord>(makeNutrition(rng, 0, 0)));
+    day.add(parseRecord<SleepRecord>(makeSleep(rng, 0, 0)));
+    for (size_t i = 0; i < heart_rates; ++i) day.add(parseRecord<HeartRateRecord>(makeHeartRate(rng, 0, 0)));
+    return day;
+}
+
+// One shared processor so the constructor's log line is printed once
+HealthDataProcessor& benchProcessor() {
+    static HealthDataProcessor processor(".");
+    static bool initialised = (processor.addUserProfile(benchProfile(1)), true);
+    (void)initialised;
+    return processor;
+}
+
+} // namespace
+
+static void BM_ExtractDate(benchmark::State& state) {
+    std::mt19937 rng(1);
+    json record = state.range(0) ? makeHeartRate(rng, 1, 1) : makeActivity(rng, 1, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HealthDataProcessor::extractDate(record));
+    }
+}
+BENCHMARK(BM_ExtractDate)->Arg(0)->Arg(1)->ArgName("date_time");
+
+// The raw user_id lookup that lets sharded runs skip other users' records unparsed
+static void BM_FindUserId(benchmark::State& state) {
+    std::mt19937 rng(1);
+    std::string text = makeActivity(rng, 1, 1).dump();
+    std::string_view user_id;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(findTopLevelString(text, "user_id", user_id));
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FindUserId);
+
+static void BM_ParseRecord(benchmark::State& state) {
+    std::mt19937 rng(2);
+    std::string text = makeActivity(rng, 1, 1).dump();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(json::parse(text));
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ParseRecord);
+
+// Record to sentence: the typed parse at aggregation plus the later rendering
+template <json (*Make)(std::mt19937&, int, int), class Record>
+static void BM_Format(benchmark::State& state) {
+    std::mt19937 rng(3);
+    json record = Make(rng, 1, 1);
+    for (auto _ : state) {
+        std::ostringstream sentence;
+        formatRecord(sentence, parseRecord<Record>(record));
+        benchmark::DoNotOptimize(sentence.str());
+    }
+}
+BENCHMARK_TEMPLATE(BM_Format, makeActivity, ActivityRecord)->Name("BM_FormatActivity");
+BENCHMARK_TEMPLATE(BM_Format, makeWorkout, WorkoutRecord)->Name("BM_FormatWorkout");
+BENCHMARK_TEMPLATE(BM_Format, makeNutrition, NutritionRecord)->Name("BM_FormatNutrition");
+BENCHMARK_TEMPLATE(BM_Format, makeSleep, SleepRecord)->Name("BM_FormatSleep");
+
+// Folds a stream of mixed records into a fresh DayMap; range(0) users x 7 days
+static void BM_AggregateRecord(benchmark::State& state) {
+    const int users = static_cast<int>(state.range(0));
+    std::mt19937 rng(4);
+    HealthDataProcessor& processor = benchProcessor();
+    std::vector<std::pair<std::string, json>> records;
+    for (int user = 0; user < users; ++user) {
+        for (int day = 0; day < 7; ++day) {
+            records.emplace_back("activities", makeActivity(rng, user, day));
+            records.emplace_back("nutrition", makeNutrition(rng, user, day));
+            records.emplace_back("sleep", makeSleep(rng, user, day));
+            for (int i = 0; i < 8; ++i) records.emplace_back("heart_rate", makeHeartRate(rng, user, day));
+        }
+    }
+    StageTimes times;
+    for (auto _ : state) {
+        DayMap day_map;
+        size_t bytes = 0;
+        for (const auto& [type, record] : records) {
+            processor.aggregateRecord(type, record, day_map, bytes, times);
+        }
+        benchmark::DoNotOptimize(day_map.size());
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_AggregateRecord)->Arg(10)->Arg(100);
+
+// range(0) = heart-rate readings per day (minute-level data gives ~1440)
+static void BM_CreateSummary(benchmark::State& state) {
+    std::mt19937 rng(5);
+    HealthDataProcessor& processor = benchProcessor();
+    DayData day = makeDay(rng, static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor.createSummary("user_1", "2024-01-15", day));
+    }
+}
+BENCHMARK(BM_CreateSummary)->Arg(0)->Arg(100)->Arg(1440);
+
+static void BM_BuildPayload(benchmark::State& state) {
+    std::mt19937 rng(6);
+    HealthDataProcessor& processor = benchProcessor();
+    DayData day = makeDay(rng, 100);
+    Summary summary;
+    summary.user_id = "user_1";
+    summary.date = "2024-01-15";
+    summary.text = processor.createSummary(summary.user_id, summary.date, day);
+    summary.totals = day.totals;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HealthDataProcessor::buildPayload(summary));
+    }
+    state.SetBytesProcessed(state.iterations() * summary.text.size());
+}
+BENCHMARK(BM_BuildPayload);
+
+// Spills range(0) user-days to two sorted runs and merges them back
+static void BM_SpillAndMerge(benchmark::State& state) {
+    std::mt19937 rng(7);
+    DayMap first, second;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        std::string key = "user_" + std::to_string(i % 500) + "|2024-01-" + std::to_string(10 + i / 500);
+        first.emplace(key, makeDay(rng, 8));
+        second.emplace(key, makeDay(rng, 8));
+    }
+    std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                                ("health_bench_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    std::vector<std::string> runs = {(dir / "run_0").string(), (dir / "run_1").string()};
+
+    for (auto _ : state) {
+        writeSortedRun(runs[0], first);
+        writeSortedRun(runs[1], second);
+        size_t visited = 0;
+        mergeRuns(runs, [&](const std::string&, DayData&) { ++visited; });
+        benchmark::DoNotOptimize(visited);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+    std::filesystem::remove_all(dir);
+}
+BENCHMARK(BM_SpillAndMerge)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// Per-user exact top-10 over range(0) unit vectors of 384 dimensions (MiniLM):
+// scalar loop, then the SIMD float32, int8 and PQ kernels
+struct ScanFixture {
+    static constexpr size_t kDimension = 384;
+    std::vector<float> rows;
+    std::vector<float> query;
+    Int8Matrix codes;
+
+    explicit ScanFixture(size_t count) : rows(count * kDimension), query(kDimension) {
+        std::mt19937 rng(7);
+        std::normal_distribution<float> gauss;
+        for (float& value : rows) value = gauss(rng);
+        for (float& value : query) value = gauss(rng);
+        for (size_t r = 0; r < count; ++r) normaliseVector(rows.data() + r * kDimension, kDimension);
+        normaliseVector(query.data(), kDimension);
+        codes.assign(rows.data(), count, kDimension);
+    }
+};
+
+static void BM_ScanScalar(benchmark::State& state) {
+    ScanFixture fixture(state.range(0));
+    for (auto _ : state) {
+        TopK top(10);
+        for (uint32_t r = 0; r < state.range(0); ++r) {
+            const float* row = fixture.rows.data() + r * ScanFixture::kDimension;
+            float dot = 0.0f;
+            for (size_t i = 0; i < ScanFixture::kDimension; ++i) dot += fixture.query[i] * row[i];
+            top.push(1.0f - dot, r);
+        }
+        benchmark::DoNotOptimize(top.take());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ScanScalar)->Arg(1000)->Arg(5000);
+
+static void BM_ScanF32(benchmark::State& state) {
+    ScanFixture fixture(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanTopK(fixture.rows.data(), ScanFixture::kDimension, 0,
+                                          static_cast<uint32_t>(state.range(0)), fixture.query.data(), 10));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ScanF32)->Arg(1000)->Arg(5000);
+
+static void BM_ScanInt8(benchmark::State& state) {
+    ScanFixture fixture(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            scanTopK(fixture.codes, 0, static_cast<uint32_t>(state.range(0)), fixture.query.data(), 10));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ScanInt8)->Arg(1000)->Arg(5000);
+
+// The same scan over 48-byte PQ codes (8 dimensions per subspace), ADC table included
+static void BM_ScanPQ(benchmark::State& state) {
+    ScanFixture fixture(state.range(0));
+    TaskScheduler scheduler(1);
+    ProductQuantizer quantizer(ScanFixture::kDimension, ScanFixture::kDimension / 8);
+    quantizer.train(fixture.rows.data(), state.range(0), scheduler);
+    std::vector<uint8_t> codes = quantizer.encodeAll(fixture.rows.data(), state.range(0), scheduler);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanTopK(quantizer, codes.data(), 0, static_cast<uint32_t>(state.range(0)),
+                                          fixture.query.data(), 10));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ScanPQ)->Arg(1000)->Arg(5000);
+
+// /query result cache: key normalisation and hashing plus a hit on a full cache
+static void BM_QueryCacheHit(benchmark::State& state) {
+    const std::string scope = "text|10|64|-2147483648|2147483647\n";
+    QueryCache cache(10000);
+    for (int i = 0; i < 10000; ++i) cache.put(hashText(scope + "question " + std::to_string(i)), "{}");
+    std::string value;
+    int i = 0;
+    for (auto _ : state) {
+        std::string text = "  Question " + std::to_string(i++ % 10000) + "?";
+        benchmark::DoNotOptimize(cache.get(hashText(scope + normaliseQueryText(text)), value));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QueryCacheHit);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,481 @@
+// Synthetic dataset generator producing the seven input files health_ingestion reads.
+// Every record is derived from (seed, file, user, day) alone, so output is identical
+// across runs, hosts and --order choices for the same configuration.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum class FileKind { Activities, Workouts, Nutrition, Sleep, HeartRate, Measurements, Count };
+
+const char* kFileNames[] = {"activities", "workouts", "nutrition", "sleep", "heart_rate", "measurements"};
+
+// Mean records per user per day before skew is applied
+double kDefaultDensity[] = {1.5, 0.7, 3.0, 0.95, 96.0, 0.3};
+
+const char* kActivityTypes[] = {"Running", "Cycling", "Walking", "Swimming", "Hiking", "Yoga", "Rowing"};
+const char* kWeather[] = {"Sunny", "Cloudy", "Rainy", "Windy", "Snowy"};
+const char* kWorkoutTypes[] = {"Strength", "HIIT", "CrossFit", "Pilates", "Circuit", "Calisthenics"};
+const char* kMealTypes[] = {"breakfast", "lunch", "dinner", "snack"};
+const char* kSleepQuality[] = {"Poor", "Fair", "Good", "Excellent"};
+const char* kGenders[] = {"male", "female"};
+const char* kFitnessLevels[] = {"beginner", "intermediate", "advanced"};
+const char* kFirstNames[] = {"Alex", "Sam", "Jordan", "Taylor", "Morgan", "Casey", "Riley", "Jamie",
+                             "Avery", "Quinn", "Harper", "Rowan", "Emerson", "Parker", "Reese", "Skyler"};
+const char* kLastNames[] = {"Smith", "Garcia", "Chen", "Patel", "Okafor", "Novak", "Silva", "Kim",
+                            "Müller", "Rossi", "Haddad", "Nguyen", "Larsen", "Cohen", "Ivanova", "Brown"};
+
+template <size_t N>
+const char* pick(const char* (&values)[N], uint64_t r) { return values[r % N]; }
+
+struct GeneratorConfig {
+    std::string out_dir = "data";
+    size_t users = 1000;
+    size_t days = 30;
+    int start_days = 0;              // Days since 1970-01-01 of the first day
+    double density[static_cast<size_t>(FileKind::Count)];
+    double skew = 0.0;               // Zipf exponent over users; 0 = every user equally active
+    uint64_t seed = 42;
+    bool day_major = false;          // Emit all users for day 0, then day 1, ... instead of per user
+};
+
+// Small, fully specified PRNG so output does not depend on the standard library's distributions
+struct SplitMix64 {
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+    double range(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+    int range(int lo, int hi) { return lo + static_cast<int>(next() % static_cast<uint64_t>(hi - lo + 1)); }
+    double normal(double mean, double stddev) {
+        double u1 = std::max(uniform(), 1e-300);
+        return mean + stddev * std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * uniform());
+    }
+    // Knuth for small means, rounded normal approximation above that
+    size_t poisson(double mean) {
+        if (mean <= 0.0) return 0;
+        if (mean > 30.0) return static_cast<size_t>(std::max(0.0, std::round(normal(mean, std::sqrt(mean)))));
+        double limit = std::exp(-mean), product = uniform();
+        size_t count = 0;
+        while (product > limit) {
+            ++count;
+            product *= uniform();
+        }
+        return count;
+    }
+};
+
+uint64_t recordSeed(uint64_t seed, FileKind kind, size_t user, size_t day) {
+    SplitMix64 mix(seed ^ (static_cast<uint64_t>(kind) << 56));
+    mix.state ^= user * 0xD6E8FEB86659FD93ull;
+    mix.next();
+    mix.state ^= day * 0xA0761D6478BD642Full;
+    return mix.next();
+}
+
+// Howard Hinnant's days-to-civil conversion
+void civilFromDays(int z, int& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    y = static_cast<int>(yoe) + era * 400;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    if (m <= 2) ++y;
+}
+
+int daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int>(doe) - 719468;
+}
+
+// Buffered writer for one JSON array file; with no FILE* it only counts bytes
+class ArrayWriter {
+public:
+    explicit ArrayWriter(FILE* out) : out_(out) { buffer_.reserve(kFlushBytes + 4096); append("[\n"); }
+
+    // printf-style record body without the surrounding braces
+    template <typename... Args>
+    void record(const char* format, Args... args) {
+        if (records_++ > 0) append(",\n");
+        char line[512];
+        int n = std::snprintf(line, sizeof(line), format, args...);
+        buffer_.push_back('{');
+        buffer_.append(line, static_cast<size_t>(std::clamp<int>(n, 0, sizeof(line) - 1)));
+        buffer_.push_back('}');
+        if (buffer_.size() >= kFlushBytes) flush();
+    }
+
+    uint64_t finish() {
+        append("\n]\n");
+        flush();
+        return bytes_;
+    }
+    uint64_t records() const { return records_; }
+
+private:
+    static constexpr size_t kFlushBytes = 1 << 20;
+
+    void append(const char* text) { buffer_.append(text); }
+    void flush() {
+        if (out_) std::fwrite(buffer_.data(), 1, buffer_.size(), out_);
+        bytes_ += buffer_.size();
+        buffer_.clear();
+    }
+
+    FILE* out_;
+    std::string buffer_;
+    uint64_t bytes_ = 0;
+    uint64_t records_ = 0;
+};
+
+class DatasetGenerator {
+public:
+    explicit DatasetGenerator(const GeneratorConfig& config) : config_(config) {
+        // Zipf-like activity weights, normalised so the mean user keeps the configured density
+        weights_.resize(config_.users);
+        double total = 0.0;
+        for (size_t u = 0; u < config_.users; ++u) {
+            weights_[u] = std::pow(static_cast<double>(u + 1), -config_.skew);
+            total += weights_[u];
+        }
+        for (double& weight : weights_) {
+            weight *= static_cast<double>(config_.users) / total;
+        }
+    }
+
+    // Writes every record of one kind; out == nullptr only counts bytes
+    uint64_t writeFile(FileKind kind, FILE* out, uint64_t* records) const {
+        ArrayWriter writer(out);
+        size_t users = config_.users;
+        if (config_.day_major) {
+            for (size_t day = 0; day < config_.days; ++day)
+                for (size_t user = 0; user < users; ++user) writeUserDay(writer, kind, user, day);
+        } else {
+            for (size_t user = 0; user < users; ++user)
+                for (size_t day = 0; day < config_.days; ++day) writeUserDay(writer, kind, user, day);
+        }
+        uint64_t bytes = writer.finish();
+        if (records) *records = writer.records();
+        return bytes;
+    }
+
+    uint64_t writeUsers(FILE* out) const {
+        ArrayWriter writer(out);
+        for (size_t user = 0; user < config_.users; ++user) {
+            SplitMix64 rng(recordSeed(config_.seed, FileKind::Count, user, 0));
+            const char* gender = pick(kGenders, rng.next());
+            double height = std::round(rng.normal(gender[0] == 'm' ? 177.0 : 164.0, 7.0) * 10) / 10;
+            double bmi = rng.range(19.0, 31.0);
+            writer.record("\"user_id\": \"%s\", \"name\": \"%s %s\", \"age\": %d, \"gender\": \"%s\", "
+                          "\"height\": %.1f, \"weight\": %.1f, \"fitness_level\": \"%s\"",
+                          userId(user).c_str(), pick(kFirstNames, rng.next()), pick(kLastNames, rng.next()),
+                          rng.range(18, 75), gender, height, bmi * height * height / 10000.0,
+                          pick(kFitnessLevels, rng.next()));
+        }
+        return writer.finish();
+    }
+
+private:
+    std::string userId(size_t user) const {
+        char id[32];
+        std::snprintf(id, sizeof(id), "user_%06zu", user + 1);
+        return id;
+    }
+
+    std::string date(size_t day) const {
+        int y;
+        unsigned m, d;
+        civilFromDays(config_.start_days + static_cast<int>(day), y, m, d);
+        char text[16];
+        std::snprintf(text, sizeof(text), "%04d-%02u-%02u", y, m, d);
+        return text;
+    }
+
+    void writeUserDay(ArrayWriter& writer, FileKind kind, size_t user, size_t day) const {
+        SplitMix64 rng(recordSeed(config_.seed, kind, user, day));
+        double mean = config_.density[static_cast<size_t>(kind)] * weights_[user];
+        size_t count = rng.poisson(mean);
+        if (count == 0) return;
+
+        std::string id = userId(user);
+        std::string today = date(day);
+        const char* u = id.c_str();
+        const char* d = today.c_str();
+
+        for (size_t i = 0; i < count; ++i) {
+            switch (kind) {
+                case FileKind::Activities: {
+                    int duration = rng.range(10, 120);
+                    int hr_avg = rng.range(95, 165);
+                    writer.record("\"user_id\": \"%s\", \"date\": \"%s\", \"activity_type\": \"%s\", "
+                                  "\"duration\": %d, \"weather\": \"%s\", \"calories_burned\": %.1f, "
+                                  "\"distance\": %.2f, \"steps\": %d, \"heart_rate_avg\": %d, \"heart_rate_max\": %d",
+                                  u, d, pick(kActivityTypes, rng.next()), duration, pick(kWeather, rng.next()),
+                                  duration * rng.range(4.0, 12.0), duration * rng.range(0.05, 0.2),
+                                  duration * rng.range(60, 160), hr_avg, hr_avg + rng.range(10, 35));
+                    break;
+                }
+                case FileKind::Workouts: {
+                    int duration = rng.range(15, 90);
+                    writer.record("\"user_id\": \"%s\", \"date\": \"%s\", \"workout_type\": \"%s\", "
+                                  "\"duration\": %d, \"sets\": %d, \"reps\": %d, \"calories_burned\": %.1f",
+                                  u, d, pick(kWorkoutTypes, rng.next()), duration, rng.range(2, 6),
+                                  rng.range(5, 20), duration * rng.range(5.0, 11.0));
+                    break;
+                }
+                case FileKind::Nutrition:
+                    writer.record("\"user_id\": \"%s\", \"date\": \"%s\", \"meal_type\": \"%s\", "
+                                  "\"calories\": %d, \"protein\": %.1f, \"carbs\": %.1f, \"fat\": %.1f",
+                                  u, d, kMealTypes[i % 4], rng.range(80, 1200), rng.range(2.0, 60.0),
+                                  rng.range(5.0, 150.0), rng.range(1.0, 50.0));
+                    break;
+                case FileKind::Sleep: {
+                    double total = rng.range(4.5, 9.5);
+                    writer.record("\"user_id\": \"%s\", \"date\": \"%s\", \"total_sleep\": %.1f, "
+                                  "\"deep_sleep\": %.1f, \"rem_sleep\": %.1f, \"sleep_quality\": \"%s\", "
+                                  "\"resting_heart_rate\": %d",
+                                  u, d, total, total * rng.range(0.1, 0.25), total * rng.range(0.15, 0.25),
+                                  pick(kSleepQuality, rng.next()), rng.range(45, 75));
+                    break;
+                }
+                case FileKind::HeartRate: {
+                    // Readings spread evenly over the day
+                    unsigned second = static_cast<unsigned>((i * 86400 + rng.next() % 60) / count) % 86400;
+                    writer.record("\"user_id\": \"%s\", \"date_time\": \"%s %02u:%02u:%02u\", \"value\": %d",
+                                  u, d, second / 3600, second / 60 % 60, second % 60, rng.range(50, 180));
+                    break;
+                }
+                case FileKind::Measurements: {
+                    // Scales report weight; the other fields are optional, as on real devices
+                    std::string extra;
+                    char field[128];
+                    if (rng.uniform() < 0.7) {
+                        std::snprintf(field, sizeof(field), ", \"body_fat\": %.1f", rng.range(8.0, 38.0));
+                        extra += field;
+                    }
+                    if (rng.uniform() < 0.4) {
+                        std::snprintf(field, sizeof(field), ", \"muscle_mass\": %.1f", rng.range(25.0, 60.0));
+                        extra += field;
+                    }
+                    if (rng.uniform() < 0.3) {
+                        std::snprintf(field, sizeof(field), ", \"blood_pressure_systolic\": %d, "
+                                      "\"blood_pressure_diastolic\": %d", rng.range(100, 150), rng.range(60, 95));
+                        extra += field;
+                    }
+                    writer.record("\"user_id\": \"%s\", \"date\": \"%s\", \"weight\": %.1f%s",
+                                  u, d, rng.range(45.0, 120.0), extra.c_str());
+                    break;
+                }
+                case FileKind::Count:
+                    break;
+            }
+        }
+    }
+
+    GeneratorConfig config_;
+    std::vector<double> weights_;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [out_dir] [options]\n"
+              << "  --users <n>             Number of users (default: 1000)\n"
+              << "  --days <n>              Days per user (default: 30)\n"
+              << "  --start-date <date>     First day, YYYY-MM-DD (default: 2024-01-01)\n"
+              << "  --density <type>=<n>    Mean records per user-day for one file, e.g.\n"
+              << "                          heart_rate=1440 (repeatable)\n"
+              << "  --skew <s>              Zipf exponent of per-user activity (default: 0)\n"
+              << "  --size <size>           Pick --users so the dataset is about this size\n"
+              << "                          (e.g. 1G, 100G)\n"
+              << "  --order <user|day>      Group records by user (default) or by day\n"
+              << "  --seed <n>              Random seed (default: 42)\n";
+}
+
+// Parses sizes like "1048576", "512M", "2G" or "1T"
+bool parseByteSize(const std::string& text, uint64_t& bytes) {
+    try {
+        size_t pos = 0;
+        unsigned long long value = std::stoull(text, &pos);
+        std::string suffix = text.substr(pos);
+        if (suffix == "K" || suffix == "k") value <<= 10;
+        else if (suffix == "M" || suffix == "m") value <<= 20;
+        else if (suffix == "G" || suffix == "g") value <<= 30;
+        else if (suffix == "T" || suffix == "t") value <<= 40;
+        else if (!suffix.empty()) return false;
+        bytes = value;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    GeneratorConfig config;
+    std::copy(std::begin(kDefaultDensity), std::end(kDefaultDensity), config.density);
+    config.start_days = daysFromCivil(2024, 1, 1);
+    uint64_t target_size = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--users" && i + 1 < argc) {
+            config.users = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--days" && i + 1 < argc) {
+            config.days = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--start-date" && i + 1 < argc) {
+            int y;
+            unsigned m, d;
+            if (std::sscanf(argv[++i], "%d-%u-%u", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31) {
+                std::cerr << "Error: Invalid --start-date value: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.start_days = daysFromCivil(y, m, d);
+        } else if (arg == "--density" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t eq = spec.find('=');
+            size_t kind = static_cast<size_t>(FileKind::Count);
+            for (size_t k = 0; eq != std::string::npos && k < kind; ++k) {
+                if (spec.compare(0, eq, kFileNames[k]) == 0 && std::strlen(kFileNames[k]) == eq) kind = k;
+            }
+            if (kind == static_cast<size_t>(FileKind::Count)) {
+                std::cerr << "Error: Invalid --density value (expected <type>=<n>): " << spec << std::endl;
+                return 1;
+            }
+            config.density[kind] = std::strtod(spec.c_str() + eq + 1, nullptr);
+        } else if (arg == "--skew" && i + 1 < argc) {
+            config.skew = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--size" && i + 1 < argc) {
+            if (!parseByteSize(argv[++i], target_size) || target_size == 0) {
+                std::cerr << "Error: Invalid --size value: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--order" && i + 1 < argc) {
+            std::string order = argv[++i];
+            if (order != "user" && order != "day") {
+                std::cerr << "Error: Invalid --order value: " << order << std::endl;
+                return 1;
+            }
+            config.day_major = order == "day";
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            config.out_dir = arg;
+        }
+    }
+
+    if (config.days == 0) {
+        std::cerr << "Error: --days must be at least 1" << std::endl;
+        return 1;
+    }
+
+    if (target_size > 0) {
+        // Size a sample of unskewed users, then scale the user count to the target
+        GeneratorConfig sample = config;
+        sample.users = 64;
+        sample.skew = 0.0;
+        DatasetGenerator sizer(sample);
+        uint64_t sample_bytes = sizer.writeUsers(nullptr);
+        for (size_t k = 0; k < static_cast<size_t>(FileKind::Count); ++k) {
+            sample_bytes += sizer.writeFile(static_cast<FileKind>(k), nullptr, nullptr);
+        }
+        config.users = std::max<size_t>(1, target_size * sample.users / std::max<uint64_t>(sample_bytes, 1));
+        std::cout << "Sized dataset to " << config.users << " users for about "
+                  << target_size / (1 << 20) << " MiB" << std::endl;
+    }
+    if (config.users == 0) {
+        std::cerr << "Error: --users must be at least 1" << std::endl;
+        return 1;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(config.out_dir, ec);
+    if (ec) {
+        std::cerr << "Error: Cannot create output directory " << config.out_dir << ": " << ec.message() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Generating " << config.users << " users x " << config.days << " days into "
+              << config.out_dir << " (seed " << config.seed << ", skew " << config.skew << ")" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    DatasetGenerator generator(config);
+    const size_t kinds = static_cast<size_t>(FileKind::Count);
+    std::vector<uint64_t> bytes(kinds + 1, 0), records(kinds + 1, 0);
+    std::vector<bool> ok(kinds + 1, true);
+
+    // One thread per file; the files are independent
+    std::vector<std::thread> threads;
+    for (size_t k = 0; k <= kinds; ++k) {
+        threads.emplace_back([&, k] {
+            std::string name = k == kinds ? "users" : kFileNames[k];
+            std::string path = config.out_dir + "/" + name + ".json";
+            FILE* out = std::fopen(path.c_str(), "wb");
+            if (!out) {
+                ok[k] = false;
+                return;
+            }
+            if (k == kinds) {
+                bytes[k] = generator.writeUsers(out);
+                records[k] = config.users;
+            } else {
+                bytes[k] = generator.writeFile(static_cast<FileKind>(k), out, &records[k]);
+            }
+            ok[k] = std::fclose(out) == 0;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t total_bytes = 0, total_records = 0;
+    bool success = true;
+    for (size_t k = 0; k <= kinds; ++k) {
+        std::string name = k == kinds ? "users" : kFileNames[k];
+        if (!ok[k]) {
+            std::cerr << "Error: Failed to write " << name << ".json" << std::endl;
+            success = false;
+            continue;
+        }
+        std::cout << "  " << name << ".json: " << records[k] << " records, "
+                  << bytes[k] / (1 << 20) << " MiB" << std::endl;
+        total_bytes += bytes[k];
+        total_records += records[k];
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << total_records << " records (" << total_bytes / (1 << 20) << " MiB) in "
+              << seconds << "s" << std::endl;
+    return success ? 0 : 1;
+}
@@ -1,11 +1,23 @@
 #include "health_processor.hpp"
+#include "spill_store.hpp"
+#include "work_manifest.hpp"
+#include "task_scheduler.hpp"
+#include "metrics.hpp"
+#include "record_format.hpp"
+#include "embedding_model.hpp"
+#include "embedding_cache.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <charconv>
 #include <curl/curl.h>
+#include <unistd.h>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -13,17 +25,98 @@ using namespace std::chrono;
 
 namespace health_ingestion {
 
-// CURL callback for HTTP responses
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
-    userp->append((char*)contents, size * nmemb);
-    return size * nmemb;
+// (file name, data type) of every registered record type, in processing order
+static std::vector<std::pair<std::string, std::string>> dataFiles() {
+    std::vector<std::pair<int, std::string>> types;
+    RecordTypes::forEach([&](auto tag) {
+        using Record = typename decltype(tag)::type;
+        types.emplace_back(Record::kFileOrder, Record::kDataType);
+    });
+    std::sort(types.begin(), types.end());
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const auto& type : types) files.emplace_back(type.second + ".json", type.second);
+    return files;
+}
+
+// Input files in processing order (smaller to larger); users.json is loaded separately
+static const std::vector<std::pair<std::string, std::string>> kDataFiles = dataFiles();
+
+// Records between progress reports (and early flushes when no memory budget is set)
+static constexpr size_t kProgressInterval = 50000;
+
+// Bytes per independently parsed range of an input file
+static constexpr uint64_t kParseRangeBytes = 8 << 20;
+// Smallest range a memory budget can shrink them to
+static constexpr uint64_t kMinParseRangeBytes = 64 << 10;
+
+// Partial aggregation of one byte range, produced by a parse task
+struct ParsedRange {
+    DayMap days;
+    StageTimes times;
+    size_t bytes = 0;
+    size_t accepted = 0;
+    size_t skipped = 0;
+};
+
+void DayData::append(DayData&& later) {
+    RecordTypes::forEach([&](auto tag) {
+        using Record = typename decltype(tag)::type;
+        store<Record>().append(std::move(later.store<Record>()));
+    });
+    totals.merge(later.totals);
+}
+
+// Live counters exported on the --metrics-port status endpoint
+struct IngestionMetrics {
+    Counter& bytes_read = metrics().counter(
+        "health_ingest_bytes_read_total", "Input bytes scanned");
+    Gauge& user_days = metrics().gauge(
+        "health_ingest_user_days_in_memory", "User-days held in the aggregation map");
+    Counter& summaries = metrics().counter(
+        "health_ingest_summaries_generated_total", "Daily summaries rendered");
+    Counter& cache_hits = metrics().counter(
+        "health_ingest_embedding_cache_hits_total", "Summaries whose embedding came from the cache");
+    Counter& cache_misses = metrics().counter(
+        "health_ingest_embedding_cache_misses_total", "Summaries not found in the embedding cache");
+    
+    Counter& recordsParsed(const std::string& filename) {
+        return metrics().counter("health_ingest_records_parsed_total", "Records aggregated per input file",
+                                 "file=\"" + filename + "\"");
+    }
+};
+
+static IngestionMetrics& ingestMetrics() {
+    static IngestionMetrics instance;
+    return instance;
+}
+
+uint64_t shardHash(const std::string& user_id) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : user_id) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int32_t dateKey(const std::string& date) {
+    if (date.size() < 10 || date[4] != '-' || date[7] != '-') return 0;
+    int32_t key = 0;
+    for (size_t i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        if (date[i] < '0' || date[i] > '9') return 0;
+        key = key * 10 + (date[i] - '0');
+    }
+    return key;
 }
 
 HealthDataProcessor::HealthDataProcessor(const std::string& data_dir)
     : data_dir_(data_dir)
-    , api_url_("http://localhost:5000/ingest")
     , batch_size_(1000)
-    , max_concurrent_(1000) {  // Updated limit to 1000
+    , max_concurrent_(1000)  // Updated limit to 1000
+    , memory_budget_(0)
+    , shard_index_(0)
+    , shard_count_(1)
+    , threads_(0) {
     
     // Initialize CURL globally
     curl_global_init(CURL_GLOBAL_DEFAULT);
@@ -31,6 +124,8 @@ HealthDataProcessor::HealthDataProcessor(const std::string& data_dir)
     std::cout << "Initialized HealthDataProcessor for directory: " << data_dir_ << std::endl;
 }
 
+HealthDataProcessor::~HealthDataProcessor() = default;
+
 bool HealthDataProcessor::loadUserProfiles() {
     std::ifstream file(data_dir_ + "/users.json");
     if (!file.is_open()) {
@@ -47,10 +142,10 @@ bool HealthDataProcessor::loadUserProfiles() {
             profile.user_id = user_obj["user_id"];
             profile.name = user_obj["name"];
             profile.age = user_obj["age"];
-            profile.gender = user_obj["gender"];
+            profile.gender = symbols().intern(user_obj["gender"].get<std::string>());
             profile.height = user_obj["height"];
             profile.weight = user_obj["weight"];
-            profile.fitness_level = user_obj["fitness_level"];
+            profile.fitness_level = symbols().intern(user_obj["fitness_level"].get<std::string>());
             
             users_[profile.user_id] = profile;
         }
@@ -70,109 +165,120 @@ void HealthDataProcessor::processAllFiles() {
     auto start_time = high_resolution_clock::now();
     
     // Map to accumulate user-day data efficiently
-    std::unordered_map<std::string, DayData> user_day_data;
-    
-    // Process files in optimal order (smaller to larger)
-    std::vector<std::pair<std::string, std::string>> files = {
-        {"users.json", "users"},
-        {"measurements.json", "measurements"},
-        {"activities.json", "activities"},
-        {"workouts.json", "workouts"},
-        {"sleep.json", "sleep"},
-        {"nutrition.json", "nutrition"},
-        {"heart_rate.json", "heart_rate"}
-    };
+    DayMap user_day_data;
+    
+    // With a memory budget, overflow is spilled to sorted runs instead of flushed early
+    std::unique_ptr<SpillStore> spill_store;
+    size_t accumulator_bytes = 0;
+    if (memory_budget_ > 0) {
+        spill_store = std::make_unique<SpillStore>(spill_dir_);
+        std::cout << "Memory budget: " << memory_budget_ << " bytes" << std::endl;
+    }
+    if (shard_count_ > 1) {
+        std::cout << "Processing shard " << shard_index_ << "/" << shard_count_ << std::endl;
+    }
+    
+    TaskScheduler& pool = scheduler();
+    std::cout << "Using " << pool.concurrency() << " worker threads" << std::endl;
+    
+    // Under a budget, half of it is for the partial maps of the wave being parsed (a
+    // range's typed records take no more than its JSON text) and half for the accumulator
+    const size_t wave_size = pool.concurrency() * 2;
+    uint64_t range_bytes = kParseRangeBytes;
+    size_t accumulator_budget = memory_budget_;
+    if (memory_budget_ > 0) {
+        range_bytes = std::clamp<uint64_t>(memory_budget_ / 2 / wave_size, kMinParseRangeBytes, kParseRangeBytes);
+        accumulator_budget = memory_budget_ - std::min<size_t>(memory_budget_ / 2, range_bytes * wave_size);
+    }
     
     size_t total_records = 0;
-    std::vector<std::tuple<std::string, std::string, std::string>> batch;
+    size_t skipped_records = 0;
+    size_t next_progress = kProgressInterval;
+    PendingDays pending;
     
-    for (const auto& [filename, data_type] : files) {
-        if (data_type == "users") continue; // Already loaded
-        
+    for (const auto& [filename, data_type] : kDataFiles) {
         std::cout << "Processing " << filename << "..." << std::endl;
         
-        std::ifstream file(data_dir_ + "/" + filename);
-        if (!file.is_open()) {
+        std::string path = data_dir_ + "/" + filename;
+        if (!std::filesystem::exists(path)) {
             std::cerr << "Warning: Could not open " << filename << std::endl;
             continue;
         }
         
+        Counter& records_parsed = ingestMetrics().recordsParsed(filename);
+        
         try {
-            // Parse JSON in streaming fashion for memory efficiency
-            json file_json;
-            file >> file_json;
+            // Cut the file on record boundaries so ranges can be parsed independently;
+            // ranges are handled in waves to keep the in-flight partial maps bounded
+            std::vector<ByteRange> ranges = splitIntoRanges(path, range_bytes);
             
-            for (const auto& record : file_json) {
-                std::string user_id = record["user_id"];
-                std::string date = extractDate(record.dump());
-                
-                if (date.empty()) continue;
-                
-                std::string key = user_id + "|" + date;
+            // The record type is resolved once per file; the scan loop is instantiated
+            // per type, so each record goes straight to its own parse and store
+            std::function<void(const ByteRange&, ParsedRange&)> parse_range;
+            RecordTypes::dispatch(data_type, [&](auto tag) {
+                using Record = typename decltype(tag)::type;
+                parse_range = [&](const ByteRange& range, ParsedRange& out) {
+                    uint64_t read_nanos = 0;
+                    scanRecords(path, range.begin, range.end, [&](std::string_view text, uint64_t) {
+                        if (otherShard(text)) {
+                            out.skipped++;
+                            return;
+                        }
+                        json record;
+                        {
+                            ScopedStageTimer timer(out.times, Stage::Parse);
+                            record = json::parse(text);
+                        }
+                        switch (aggregateRecord<Record>(record, out.days, out.bytes, out.times)) {
+                            case RecordStatus::Accepted: out.accepted++; break;
+                            case RecordStatus::OtherShard: out.skipped++; break;
+                            case RecordStatus::MissingDate: break;
+                        }
+                    }, &read_nanos);
+                    out.times.add(Stage::Read, read_nanos);
+                };
+            });
+            
+            for (size_t first = 0; first < ranges.size(); first += wave_size) {
+                std::vector<ParsedRange> parsed(std::min(wave_size, ranges.size() - first));
+                pool.parallelFor(parsed.size(), [&](size_t i) {
+                    const ByteRange& range = ranges[first + i];
+                    parse_range(range, parsed[i]);
+                    ingestMetrics().bytes_read.inc(range.end - range.begin);
+                });
                 
-                // Store relevant data efficiently based on type
-                if (data_type == "activities") {
-                    std::ostringstream activity;
-                    activity << "did " << record["activity_type"] 
-                             << " for " << record["duration"] << " minutes in " 
-                             << record["weather"] << " weather, burning " 
-                             << record["calories_burned"] << " calories, covering "
-                             << record["distance"] << " km with " << record["steps"]
-                             << " steps, avg HR " << record["heart_rate_avg"]
-                             << " bpm (max " << record["heart_rate_max"] << ").";
-                    user_day_data[key].activities.push_back(activity.str());
-                }
-                else if (data_type == "workouts") {
-                    std::ostringstream workout;
-                    workout << "Completed a " << record["workout_type"] 
-                            << " workout for " << record["duration"] << " minutes, "
-                            << record["sets"] << " sets of " << record["reps"]
-                            << " reps, burned " << record["calories_burned"] << " calories.";
-                    user_day_data[key].workouts.push_back(workout.str());
-                }
-                else if (data_type == "nutrition") {
-                    std::ostringstream nutrition;
-                    nutrition << "Ate " << record["calories"] << " calories at " 
-                              << record["meal_type"] << " (" << record["protein"]
-                              << "g protein, " << record["carbs"] << "g carbs, "
-                              << record["fat"] << "g fat).";
-                    user_day_data[key].nutrition.push_back(nutrition.str());
-                }
-                else if (data_type == "sleep") {
-                    std::ostringstream sleep;
-                    sleep << "Slept " << record["total_sleep"] << " hours (deep "
-                          << record["deep_sleep"] << "h, REM " << record["rem_sleep"]
-                          << "h), quality " << record["sleep_quality"]
-                          << ", resting HR " << record["resting_heart_rate"] << " bpm.";
-                    user_day_data[key].sleep.push_back(sleep.str());
-                }
-                else if (data_type == "heart_rate") {
-                    user_day_data[key].heart_rates.push_back(record["value"]);
+                // Fold partials in range order so each day keeps its records in file order
+                for (auto& part : parsed) {
+                    for (auto& [key, day_data] : part.days) {
+                        auto [slot, inserted] = user_day_data.try_emplace(key, std::move(day_data));
+                        if (!inserted) slot->second.append(std::move(day_data));
+                    }
+                    accumulator_bytes += part.bytes;
+                    total_records += part.accepted;
+                    skipped_records += part.skipped;
+                    records_parsed.inc(part.accepted);
+                    profile_.add(filename, part.times);
+                    part.days = DayMap();
+                    
+                    // Checked per range, so the accumulator never runs a wave past its share
+                    if (spill_store && accumulator_bytes > accumulator_budget) {
+                        spill_store->spill(user_day_data);
+                        accumulator_bytes = 0;
+                    }
                 }
-                
-                total_records++;
+                ingestMetrics().user_days.set(static_cast<int64_t>(user_day_data.size()));
                 
                 // Process batches periodically to manage memory
-                if (total_records % 50000 == 0) {
+                if (total_records >= next_progress) {
                     std::cout << "Processed " << total_records << " records..." << std::endl;
+                    next_progress = (total_records / kProgressInterval + 1) * kProgressInterval;
+                    if (spill_store) continue;  // Spilling keeps days whole; no early flush
                     
                     // Generate summaries for completed days and add to batch
                     for (auto it = user_day_data.begin(); it != user_day_data.end();) {
-                        const std::string& key = it->first;
-                        size_t pos = key.find('|');
-                        std::string user_id = key.substr(0, pos);
-                        std::string date = key.substr(pos + 1);
-                        
                         // Create summary if we have substantial data
-                        if (!it->second.activities.empty() || !it->second.nutrition.empty()) {
-                            std::string summary = createSummary(user_id, date, it->second);
-                            batch.emplace_back(user_id, date, summary);
-                            
-                            if (batch.size() >= batch_size_) {
-                                processBatch(batch);
-                                batch.clear();
-                            }
-                            
+                        if (!it->second.store<ActivityRecord>().empty() || !it->second.store<NutritionRecord>().empty()) {
+                            emitSummary(it->first, std::move(it->second), pending);
                             it = user_day_data.erase(it);
                         } else {
                             ++it;
@@ -187,23 +293,25 @@ void HealthDataProcessor::processAllFiles() {
     }
     
     // Process remaining data
-    for (const auto& [key, day_data] : user_day_data) {
-        size_t pos = key.find('|');
-        std::string user_id = key.substr(0, pos);
-        std::string date = key.substr(pos + 1);
-        
-        std::string summary = createSummary(user_id, date, day_data);
-        batch.emplace_back(user_id, date, summary);
-        
-        if (batch.size() >= batch_size_) {
-            processBatch(batch);
-            batch.clear();
+    if (spill_store && spill_store->runCount() > 0) {
+        // Spill the tail as the last run and merge so each user-day is summarised once
+        spill_store->spill(user_day_data);
+        std::cout << "Merging " << spill_store->runCount() << " spill runs..." << std::endl;
+        spill_store->merge([&](const std::string& key, DayData& day_data) {
+            emitSummary(key, std::move(day_data), pending);
+        });
+    } else {
+        for (auto& [key, day_data] : user_day_data) {
+            emitSummary(key, std::move(day_data), pending);
         }
     }
+    user_day_data.clear();
+    ingestMetrics().user_days.set(0);
     
     // Process final batch
-    if (!batch.empty()) {
-        processBatch(batch);
+    flushPending(pending);
+    if (!sink().finish()) {
+        std::cerr << "Failed to finish output to " << output_.describe() << std::endl;
     }
     
     auto end_time = high_resolution_clock::now();
@@ -211,178 +319,397 @@ void HealthDataProcessor::processAllFiles() {
     
     std::cout << "C++ Processing completed!" << std::endl;
     std::cout << "Total records processed: " << total_records << std::endl;
+    if (shard_count_ > 1) {
+        std::cout << "Records skipped (other shards): " << skipped_records << std::endl;
+    }
     std::cout << "Time taken: " << duration.count() << " seconds" << std::endl;
+    
+    reportRun(duration_cast<std::chrono::duration<double>>(end_time - start_time).count(), total_records, "");
 }
 
-std::string HealthDataProcessor::extractDate(const std::string& json_str) {
-    try {
-        json obj = json::parse(json_str);
-        
-        if (obj.contains("date")) {
-            return obj["date"];
-        } else if (obj.contains("date_time")) {
-            std::string datetime = obj["date_time"];
-            size_t space_pos = datetime.find(' ');
-            return space_pos != std::string::npos ? datetime.substr(0, space_pos) : datetime;
-        }
-    } catch (const std::exception&) {
-        // Ignore parsing errors for date extraction
+void HealthDataProcessor::reportRun(double wall_seconds, size_t records, const std::string& report_suffix) {
+    std::string report = profile_.toJson(wall_seconds, records, scheduler().concurrency());
+    std::cout << "Performance report:" << std::endl << report << std::endl;
+    
+    if (cache_) {
+        uint64_t hits = ingestMetrics().cache_hits.value();
+        uint64_t lookups = hits + ingestMetrics().cache_misses.value();
+        std::cout << "Embedding cache: " << hits << "/" << lookups << " hits ("
+                  << (lookups ? 100.0 * hits / lookups : 0.0) << "%), " << cache_->inserts() << " added, "
+                  << cache_->size() << " of " << cache_->capacity() << " slots used" << std::endl;
     }
     
-    return "";
+    if (!report_path_.empty()) {
+        std::ofstream out(report_path_ + report_suffix, std::ios::trunc);
+        out << report << std::endl;
+        if (!out) {
+            std::cerr << "Warning: Could not write report to " << report_path_ + report_suffix << std::endl;
+        }
+    }
+    if (!benchmark_csv_.empty() && !profile_.appendCsv(benchmark_csv_, "CPP", wall_seconds)) {
+        std::cerr << "Warning: Could not append to " << benchmark_csv_ << std::endl;
+    }
 }
 
-std::string HealthDataProcessor::createSummary(const std::string& user_id, 
-                                               const std::string& date,
-                                               const DayData& data) {
-    auto it = users_.find(user_id);
-    if (it == users_.end()) {
-        return "Unknown user " + user_id + " on " + date;
+bool HealthDataProcessor::planWork(const std::string& work_dir, uint64_t unit_bytes, size_t partitions) {
+    std::vector<WorkUnit> units;
+    for (const auto& [filename, data_type] : kDataFiles) {
+        std::string path = data_dir_ + "/" + filename;
+        if (!std::filesystem::exists(path)) {
+            std::cerr << "Warning: Could not open " << filename << std::endl;
+            continue;
+        }
+        for (const auto& range : splitIntoRanges(path, unit_bytes)) {
+            units.push_back({units.size(), filename, data_type, range});
+        }
     }
     
-    const UserProfile& profile = it->second;
-    
-    std::ostringstream summary;
-    summary << profile.name << " (" << profile.age << " years old " << profile.gender
-            << ", " << profile.height << " cm, " << profile.weight << " kg, "
-            << profile.fitness_level << " fitness level)";
-    
-    // Add activities
-    for (const auto& activity : data.activities) {
-        summary << " " << activity;
+    WorkManifest manifest(work_dir);
+    if (!manifest.create(units, partitions)) {
+        return false;
     }
+    std::cout << "Planned " << units.size() << " work units and " << partitions
+              << " merge partitions in " << work_dir << std::endl;
+    return true;
+}
+
+bool HealthDataProcessor::runWorker(const std::string& work_dir) {
+    auto start_time = high_resolution_clock::now();
     
-    // Add workouts
-    for (const auto& workout : data.workouts) {
-        summary << " " << workout;
+    // Workers may start before the coordinator publishes the manifest
+    WorkManifest manifest(work_dir);
+    for (int attempt = 0; !manifest.load(); ++attempt) {
+        if (attempt >= 600) {
+            std::cerr << "No manifest found in " << work_dir << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(milliseconds(100));
     }
     
-    // Add nutrition
-    for (const auto& nutrition : data.nutrition) {
-        summary << " " << nutrition;
+    const size_t partitions = manifest.partitions();
+    size_t units_done = 0;
+    size_t total_records = 0;
+    
+    // Phase 1: claim byte ranges, aggregate them and write one sorted run per partition
+    for (const auto& unit : manifest.units()) {
+        if (!manifest.claim(WorkManifest::unitTask(unit.id))) continue;
+        
+        DayMap day_map;
+        size_t bytes_added = 0;
+        StageTimes times;
+        uint64_t read_nanos = 0;
+        Counter& records_parsed = ingestMetrics().recordsParsed(unit.filename);
+        try {
+            // One dispatch per unit; the scan loop is instantiated per record type
+            bool known = RecordTypes::dispatch(unit.data_type, [&](auto tag) {
+                using Record = typename decltype(tag)::type;
+                scanRecords(data_dir_ + "/" + unit.filename, unit.range.begin, unit.range.end,
+                            [&](std::string_view text, uint64_t) {
+                    if (otherShard(text)) return;
+                    json record;
+                    {
+                        ScopedStageTimer timer(times, Stage::Parse);
+                        record = json::parse(text);
+                    }
+                    if (aggregateRecord<Record>(record, day_map, bytes_added, times) == RecordStatus::Accepted) {
+                        total_records++;
+                        records_parsed.inc();
+                    }
+                }, &read_nanos);
+            });
+            if (!known) {
+                throw std::runtime_error("unknown data type " + unit.data_type);
+            }
+            times.add(Stage::Read, read_nanos);
+            profile_.add(unit.filename, times);
+            ingestMetrics().bytes_read.inc(unit.range.end - unit.range.begin);
+            
+            std::vector<DayMap> parts(partitions);
+            for (auto& [key, day_data] : day_map) {
+                size_t part = shardHash(key.substr(0, key.find('|'))) % partitions;
+                parts[part].emplace(key, std::move(day_data));
+            }
+            for (size_t p = 0; p < partitions; ++p) {
+                writeSortedRun(manifest.runPath(unit.id, p), parts[p]);
+            }
+        } catch (const std::exception& e) {
+            // Every worker waits on every unit, so the failure must be published
+            std::cerr << "Error processing unit " << unit.id << " (" << unit.filename << "): "
+                      << e.what() << std::endl;
+            manifest.markFailed(WorkManifest::unitTask(unit.id), e.what());
+            return false;
+        }
+        
+        manifest.markDone(WorkManifest::unitTask(unit.id));
+        units_done++;
     }
     
-    // Add sleep
-    for (const auto& sleep : data.sleep) {
-        summary << " " << sleep;
+    // Every unit's runs must exist before any partition can be merged
+    for (const auto& unit : manifest.units()) {
+        std::string task = WorkManifest::unitTask(unit.id);
+        while (!manifest.isDone(task)) {
+            if (manifest.isFailed(task)) {
+                std::cerr << "Worker " << getpid() << " stopping: unit " << unit.id << " failed or its worker exited" << std::endl;
+                return false;
+            }
+            std::this_thread::sleep_for(milliseconds(50));
+        }
     }
     
-    // Add heart rate summary
-    if (!data.heart_rates.empty()) {
-        auto minmax = std::minmax_element(data.heart_rates.begin(), data.heart_rates.end());
-        summary << " Heart rate ranged " << *minmax.first << "–" << *minmax.second 
-                << " bpm during the day.";
+    // Phase 2: claim partitions and merge their runs in unit order into summaries
+    PendingDays pending;
+    size_t partitions_done = 0;
+    for (size_t p = 0; p < partitions; ++p) {
+        if (!manifest.claim(WorkManifest::partitionTask(p))) continue;
+        
+        std::vector<std::string> runs;
+        for (const auto& unit : manifest.units()) {
+            runs.push_back(manifest.runPath(unit.id, p));
+        }
+        try {
+            mergeRuns(runs, [&](const std::string& key, DayData& day_data) {
+                emitSummary(key, std::move(day_data), pending);
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "Error merging partition " << p << ": " << e.what() << std::endl;
+            manifest.markFailed(WorkManifest::partitionTask(p), e.what());
+            return false;
+        }
+        flushPending(pending);
+        if (!sink().finish()) {
+            std::cerr << "Failed to finish output for partition " << p << std::endl;
+            manifest.markFailed(WorkManifest::partitionTask(p), "output not finished");
+            return false;
+        }
+        
+        manifest.markDone(WorkManifest::partitionTask(p));
+        manifest.removeRuns(p);
+        partitions_done++;
     }
     
-    return summary.str();
+    auto elapsed = high_resolution_clock::now() - start_time;
+    std::cout << "Worker " << getpid() << " finished: " << units_done << " units ("
+              << total_records << " records), " << partitions_done << " partitions in "
+              << duration_cast<milliseconds>(elapsed).count() << " ms" << std::endl;
+    
+    // Each worker reports its own share; report files get a per-process suffix
+    reportRun(duration_cast<std::chrono::duration<double>>(elapsed).count(), total_records,
+              "." + std::to_string(getpid()));
+    return true;
 }
 
-bool HealthDataProcessor::sendToVectorAPI(const std::string& user_id, 
-                                          const std::string& date,
-                                          const std::string& summary) {
-    // Check for print mode (dry run)
-    if (api_url_ == "PRINT_MODE") {
-        std::cout << "[" << user_id << " - " << date << "] " 
-                  << summary.substr(0, 150) << "..." << std::endl;
-        return true;
+bool HealthDataProcessor::otherShard(std::string_view text) const {
+    std::string_view user_id;
+    return shard_count_ > 1 && findTopLevelString(text, "user_id", user_id) && !inShard(std::string(user_id));
+}
+
+RecordStatus HealthDataProcessor::locateRecord(const json& record, std::string& key, StageTimes& times) const {
+    std::string user_id = record["user_id"];
+    if (!inShard(user_id)) {
+        return RecordStatus::OtherShard;
     }
     
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "Failed to initialize CURL for " << user_id << std::endl;
-        return false;
+    std::string date;
+    {
+        ScopedStageTimer timer(times, Stage::DateExtract);
+        date = extractDate(record);
     }
     
-    // Prepare JSON payload
-    json payload = {
-        {"text", summary},
-        {"meta", {
-            {"user_id", user_id},
-            {"date", date},
-            {"type", "daily_summary"}
-        }}
-    };
+    if (date.empty()) return RecordStatus::MissingDate;
     
-    std::string json_string = payload.dump();
-    std::string response_string;
-    
-    // Set CURL options with improved timeout and retry logic
-    curl_easy_setopt(curl, CURLOPT_URL, api_url_.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_string.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, json_string.length());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
-    
-    // Improved timeout settings - wait longer for server response
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);           // Total timeout: 60 seconds
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);    // Connection timeout: 10 seconds
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 30L);    // Low speed timeout: 30 seconds
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 100L);  // Min 100 bytes/sec
-    
-    // Enable verbose logging for debugging (optional)
-    // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-    
-    // Set headers
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "Accept: application/json");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    
-    // Perform request with retry logic
-    CURLcode res;
-    long response_code = 0;
-    int max_retries = 3;
-    
-    for (int attempt = 1; attempt <= max_retries; ++attempt) {
-        response_string.clear();
-        res = curl_easy_perform(curl);
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-        
-        if (res == CURLE_OK && (response_code == 200 || response_code == 201)) {
-            break; // Success!
+    key = user_id + "|" + date;
+    return RecordStatus::Accepted;
+}
+
+template <class Record>
+RecordStatus HealthDataProcessor::aggregateRecord(const json& record, DayMap& day_map, size_t& bytes_added,
+                                                  StageTimes& times) {
+    std::string key;
+    RecordStatus status = locateRecord(record, key, times);
+    if (status != RecordStatus::Accepted) return status;
+    
+    ScopedStageTimer timer(times, Stage::Aggregate);
+    // Finds or creates the accumulator entry, charging new keys to the budget
+    auto [slot, inserted] = day_map.try_emplace(key);
+    if (inserted) bytes_added += approxEntryBytes(key);
+    bytes_added += slot->second.add(parseRecord<Record>(record));
+    return RecordStatus::Accepted;
+}
+
+RecordStatus HealthDataProcessor::aggregateRecord(const std::string& data_type, const json& record,
+                                                  DayMap& day_map, size_t& bytes_added, StageTimes& times) {
+    RecordStatus status = RecordStatus::Accepted;
+    bool known = RecordTypes::dispatch(data_type, [&](auto tag) {
+        using Record = typename decltype(tag)::type;
+        status = aggregateRecord<Record>(record, day_map, bytes_added, times);
+    });
+    if (!known) {
+        std::string key;
+        status = locateRecord(record, key, times);
+    }
+    return status;
+}
+
+TaskScheduler& HealthDataProcessor::scheduler() {
+    if (!scheduler_) {
+        scheduler_ = std::make_unique<TaskScheduler>(threads_);
+    }
+    return *scheduler_;
+}
+
+OutputSink& HealthDataProcessor::sink() {
+    if (!sink_) {
+        sink_ = makeOutputSink(output_, scheduler(), cache_.get());
+    }
+    return *sink_;
+}
+
+void HealthDataProcessor::emitSummary(const std::string& key, DayData&& data, PendingDays& pending) {
+    pending.emplace_back(key, std::move(data));
+    
+    if (pending.size() >= batch_size_) {
+        flushPending(pending);
+    }
+}
+
+void HealthDataProcessor::flushPending(PendingDays& pending) {
+    if (pending.empty()) return;
+    
+    // Summaries are independent, so render them in parallel into fixed slots
+    SummaryBatch batch(pending.size());
+    std::vector<StageTimes> times(pending.size());
+    std::vector<uint8_t> cached(pending.size(), 0);
+    scheduler().parallelFor(pending.size(), [&](size_t i) {
+        const std::string& key = pending[i].first;
+        size_t pos = key.find('|');
+        std::string user_id = key.substr(0, pos);
+        std::string date = key.substr(pos + 1);
+        Summary& summary = batch[i];
+        {
+            ScopedStageTimer timer(times[i], Stage::Summarise);
+            summary.text = createSummary(user_id, date, pending[i].second);
         }
+        summary.totals = pending[i].second.totals;
+        summary.user_id = std::move(user_id);
+        summary.date = std::move(date);
         
-        if (attempt < max_retries) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500 * attempt)); // Exponential backoff
-            std::cout << "Retry " << attempt << "/" << max_retries << " for " << user_id 
-                      << " (HTTP " << response_code << ")" << std::endl;
-        } else {
-            std::cerr << "Failed after " << max_retries << " attempts for " << user_id 
-                      << " - CURL: " << curl_easy_strerror(res) 
-                      << ", HTTP: " << response_code << std::endl;
+        // A cached vector is sent like an in-process one, so the API skips encode() too
+        TextHash text_hash;
+        if (cache_) {
+            ScopedStageTimer timer(times[i], Stage::EmbedCache);
+            text_hash = hashText(summary.text);
+            if (cache_->lookup(text_hash, summary.embedding)) {
+                cached[i] = 1;
+                return;
+            }
+        }
+        if (encoder_) {
+            ScopedStageTimer timer(times[i], Stage::Embed);
+            summary.embedding = encoder_->embed(summary.text);
+            if (cache_) cache_->insert(text_hash, summary.embedding);
         }
+    });
+    pending.clear();
+    StageTimes output_times;
+    for (const auto& task_times : times) {
+        output_times.merge(task_times);
+    }
+    profile_.add("(output)", output_times);
+    ingestMetrics().summaries.inc(batch.size());
+    if (cache_) {
+        size_t hits = std::count(cached.begin(), cached.end(), 1);
+        ingestMetrics().cache_hits.inc(hits);
+        ingestMetrics().cache_misses.inc(batch.size() - hits);
     }
     
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    
-    // Check if we got a valid response (accept both 200 and 201)
-    bool success = (res == CURLE_OK && (response_code == 200 || response_code == 201));
-    if (success && !response_string.empty()) {
-        // Parse response to verify it's valid JSON with "status": "ok"
-        try {
-            json response_json = json::parse(response_string);
-            if (response_json.contains("status") && response_json["status"] == "ok") {
-                return true;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Invalid response JSON for " << user_id << ": " << e.what() << std::endl;
-        }
+    processBatch(batch);
+}
+
+std::string HealthDataProcessor::extractDate(const json& record) {
+    auto date = record.find("date");
+    if (date != record.end()) {
+        return date->is_string() ? date->get<std::string>() : "";
+    }
+    auto datetime = record.find("date_time");
+    if (datetime != record.end() && datetime->is_string()) {
+        const std::string& text = datetime->get_ref<const std::string&>();
+        return text.substr(0, text.find(' '));
     }
+    return "";
+}
+
+std::string HealthDataProcessor::extractDate(const std::string& json_str) {
+    json record = json::parse(json_str, nullptr, false);
+    return record.is_object() ? extractDate(record) : "";
+}
+
+std::string HealthDataProcessor::createSummary(const std::string& user_id, 
+                                               const std::string& date,
+                                               const DayData& data) {
+    auto it = users_.find(user_id);
+    if (it == users_.end()) {
+        return "Unknown user " + user_id + " on " + date;
+    }
+    
+    const UserProfile& profile = it->second;
+    
+    std::ostringstream summary;
+    summary << profile.name << " (" << profile.age << " years old " << symbols().name(profile.gender)
+            << ", " << profile.height << " cm, " << profile.weight << " kg, "
+            << symbols().name(profile.fitness_level) << " fitness level)";
+    
+    // Each type's sentences, in registry order
+    RecordTypes::forEach([&](auto tag) {
+        using Record = typename decltype(tag)::type;
+        data.store<Record>().render(summary);
+    });
     
-    return false;
+    return summary.str();
 }
 
-void HealthDataProcessor::processBatch(const std::vector<std::tuple<std::string, std::string, std::string>>& batch) {
-    std::cout << "Processing batch of " << batch.size() << " summaries..." << std::endl;
+json HealthDataProcessor::summaryMeta(const Summary& summary) {
+    return {
+        {"user_id", summary.user_id},
+        {"date", summary.date},
+        {"type", "daily_summary"},
+        {"totals", summary.totals.toJson()}
+    };
+}
 
-    // Simplified batch processing logic
-    size_t success_count = 0;
-    for (const auto& [user_id, date, summary] : batch) {
-        if (sendToVectorAPI(user_id, date, summary)) {
-            success_count++;
-        }
+std::string HealthDataProcessor::buildPayload(const Summary& summary) {
+    const std::vector<float>& embedding = summary.embedding;
+    json payload = {
+        {"text", summary.text},
+        {"meta", summaryMeta(summary)},
+        {"user_id", summary.user_id},
+        {"date", dateKey(summary.date)},
+        {"type", "daily_summary"}
+    };
+    std::string body = payload.dump();
+    if (embedding.empty()) {
+        return body;
+    }
+
+    // json stores floats as doubles and would print 17 digits each; the shortest
+    // round-trip float form is under half the size and loses nothing
+    body.pop_back();
+    body += ",\"embedding\":[";
+    char buffer[32];
+    for (size_t i = 0; i < embedding.size(); ++i) {
+        if (i > 0) body += ',';
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), embedding[i]);
+        body.append(buffer, result.ptr);
     }
+    body += "]}";
+    return body;
+}
+
+void HealthDataProcessor::processBatch(const SummaryBatch& batch) {
+    std::cout << "Processing batch of " << batch.size() << " summaries..." << std::endl;
+    
+    StageTimes output_times;
+    size_t success_count = sink().write(batch, output_times);
+    profile_.add("(output)", output_times);
 
     std::cout << "Batch completed: " << success_count << "/" << batch.size() << " successful" << std::endl;
 }
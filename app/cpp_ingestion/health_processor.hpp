@@ -1,12 +1,21 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <memory>
 #include <future>
 #include <chrono>
 #include <thread>
+#include <cstdint>
+#include <nlohmann/json_fwd.hpp>
+#include "stage_profile.hpp"
+#include "output_sink.hpp"
+#include "daily_totals.hpp"
+#include "record_format.hpp"
+#include "record_store.hpp"
+#include "symbol_table.hpp"
 
 namespace health_ingestion {
 
@@ -14,55 +23,150 @@ struct UserProfile {
     std::string user_id;
     std::string name;
     int age;
-    std::string gender;
+    Symbol gender;          // In symbols()
     double height;
     double weight;
-    std::string fitness_level;
+    Symbol fitness_level;
 };
 
+// Records are kept typed (numbers and symbol ids) and only rendered to sentences by
+// createSummary, so a day costs tens of bytes per record until it is summarised
 struct DayData {
-    std::vector<std::string> activities;
-    std::vector<std::string> workouts;
-    std::vector<std::string> nutrition;
-    std::vector<std::string> sleep;
-    std::vector<double> heart_rates;
-    std::vector<std::string> measurements;
+    RecordTypes::Storage stores;   // One Record::Store per registered type
+    DailyTotals totals;   // Kept up to date as records are added
+
+    template <class Record>
+    typename Record::Store& store() { return std::get<typename Record::Store>(stores); }
+    template <class Record>
+    const typename Record::Store& store() const { return std::get<typename Record::Store>(stores); }
+
+    // Stores one parsed record and updates totals; returns the bytes it adds
+    template <class Record>
+    size_t add(const Record& record) {
+        totals.add(record);
+        return store<Record>().add(record);
+    }
+    // Appends a later partial of the same user-day
+    void append(DayData&& later);
 };
 
+// Accumulator of per user-day data, keyed by "user_id|date"
+using DayMap = std::unordered_map<std::string, DayData>;
+
+// User-days awaiting summary generation, flushed in batches of batch_size
+using PendingDays = std::vector<std::pair<std::string, DayData>>;
+
+class TaskScheduler;
+class SentenceEncoder;
+class EmbeddingCache;
+
+// Outcome of folding one input record into the accumulator
+enum class RecordStatus {
+    Accepted,      // Counted (and stored, for the aggregated types)
+    MissingDate,
+    OtherShard
+};
+
+// Stable 64-bit FNV-1a hash; identical on every host so shards agree without coordination
+uint64_t shardHash(const std::string& user_id);
+
+// "YYYY-MM-DD" (optionally followed by a time) as the integer YYYYMMDD, which orders
+// like the date and supports range filters; 0 if the string is not a date
+int32_t dateKey(const std::string& date);
+
 class HealthDataProcessor {
 public:
     explicit HealthDataProcessor(const std::string& data_dir);
-    ~HealthDataProcessor() = default;
+    ~HealthDataProcessor();
 
     // Main processing methods
     bool loadUserProfiles();
+    void addUserProfile(const UserProfile& profile) { users_[profile.user_id] = profile; }
     void processAllFiles();
     
+    // Coordinated multi-process mode: planWork() cuts the input into byte-range units
+    // under work_dir, then any number of runWorker() processes claim units until done.
+    // runWorker() returns false when a task failed, its own or another worker's
+    bool planWork(const std::string& work_dir, uint64_t unit_bytes, size_t partitions);
+    bool runWorker(const std::string& work_dir);
+    
     // Configuration
-    void setApiUrl(const std::string& url) { api_url_ = url; }
+    void setOutput(const OutputConfig& output) { output_ = output; }
     void setBatchSize(size_t size) { batch_size_ = size; }
     void setMaxConcurrentRequests(size_t max) { max_concurrent_ = max; }
+    void setMemoryBudget(size_t bytes) { memory_budget_ = bytes; }
+    void setSpillDir(const std::string& dir) { spill_dir_ = dir; }
+    void setShard(size_t index, size_t count) { shard_index_ = index; shard_count_ = count; }
+    void setThreads(size_t threads) { threads_ = threads; }  // 0 = hardware concurrency
+    void setReportPath(const std::string& path) { report_path_ = path; }
+    void setBenchmarkCsv(const std::string& path) { benchmark_csv_ = path; }
+    // Embed each summary in-process and send the vector with the text
+    void setEncoder(std::shared_ptr<const SentenceEncoder> encoder) { encoder_ = std::move(encoder); }
+    // Reuse vectors of previously seen summary texts instead of embedding them again
+    void setEmbeddingCache(std::shared_ptr<EmbeddingCache> cache) { cache_ = std::move(cache); }
+    
+    // The meta dict of a summary: user_id, date, type and the day's numeric totals
+    static nlohmann::json summaryMeta(const Summary& summary);
+    // Request body for the /ingest endpoint: text, the meta dict, and meta's fields again
+    // as typed top-level user_id, date (YYYYMMDD int) and type for filtering. A non-empty
+    // embedding is sent as "embedding" so the API skips its own encode()
+    static std::string buildPayload(const Summary& summary);
+    
+    // Record-level stages, also driven directly by health_bench. The date is "date", or
+    // the day part of "date_time"; empty if neither is a string
+    static std::string extractDate(const nlohmann::json& record);
+    static std::string extractDate(const std::string& json_obj);
+    // Folds one record of a RecordTypes type into day_map
+    template <class Record>
+    RecordStatus aggregateRecord(const nlohmann::json& record, DayMap& day_map, size_t& bytes_added,
+                                 StageTimes& times);
+    // Same, looking the type up by name per record; records of unknown types are
+    // counted but not stored
+    RecordStatus aggregateRecord(const std::string& data_type, const nlohmann::json& record,
+                                 DayMap& day_map, size_t& bytes_added, StageTimes& times);
+    std::string createSummary(const std::string& user_id, const std::string& date, 
+                             const DayData& data);
 
 private:
     std::string data_dir_;
-    std::string api_url_;
+    OutputConfig output_;
     size_t batch_size_;
     size_t max_concurrent_;
+    size_t memory_budget_;   // 0 = unbounded accumulator
+    std::string spill_dir_;
+    size_t shard_index_;
+    size_t shard_count_;     // 1 = process every user
+    size_t threads_;
+    std::unique_ptr<TaskScheduler> scheduler_;  // Created on first use, after any fork()
+    std::unique_ptr<OutputSink> sink_;          // Likewise; uses scheduler_
+    std::shared_ptr<const SentenceEncoder> encoder_;  // Optional; shared read-only by all threads
+    std::shared_ptr<EmbeddingCache> cache_;           // Optional; lock-free, shared by all threads
+    
+    // Per-stage timing of the current run
+    StageProfile profile_;
+    std::string report_path_;
+    std::string benchmark_csv_;
     
     std::unordered_map<std::string, UserProfile> users_;
     
-    // File processing
-    void processFile(const std::string& filename, const std::string& data_type);
-    std::string extractDate(const std::string& json_obj);
+    bool inShard(const std::string& user_id) const {
+        return shard_count_ <= 1 || shardHash(user_id) % shard_count_ == shard_index_;
+    }
+    // True if a record's raw text shows it belongs to another shard, so it can be skipped
+    // before json::parse; records it cannot tell are left to locateRecord()
+    bool otherShard(std::string_view text) const;
     
-    // Summary generation
-    std::string createSummary(const std::string& user_id, const std::string& date, 
-                             const DayData& data);
+    // Shard and date checks shared by every record type; sets key to "user_id|date"
+    RecordStatus locateRecord(const nlohmann::json& record, std::string& key, StageTimes& times) const;
+    
+    TaskScheduler& scheduler();
+    OutputSink& sink();
     
-    // API integration
-    bool sendToVectorAPI(const std::string& user_id, const std::string& date, 
-                        const std::string& summary);
-    void processBatch(const std::vector<std::tuple<std::string, std::string, std::string>>& batch);
+    // Output
+    void emitSummary(const std::string& key, DayData&& data, PendingDays& pending);
+    void flushPending(PendingDays& pending);
+    void reportRun(double wall_seconds, size_t records, const std::string& report_suffix);
+    void processBatch(const SummaryBatch& batch);
 };
 
 } // namespace health_ingestion
\ No newline at end of file
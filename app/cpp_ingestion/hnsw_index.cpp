@@ -0,0 +1,291 @@
+#include "hnsw_index.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <random>
+
+namespace health_ingestion {
+
+namespace {
+
+// Per-thread visited marks; bumping the epoch clears them without touching memory
+struct VisitedList {
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 0;
+
+    void reset(size_t count) {
+        if (marks.size() < count) {
+            marks.assign(count, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    // True the first time id is seen since reset()
+    bool visit(uint32_t id) {
+        if (marks[id] == epoch) return false;
+        marks[id] = epoch;
+        return true;
+    }
+};
+
+thread_local VisitedList visited;
+
+using Entry = std::pair<float, uint32_t>;
+using MinHeap = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+using MaxHeap = std::priority_queue<Entry>;
+
+} // namespace
+
+HnswIndex::HnswIndex(size_t dimension, const HnswParams& params)
+    : dimension_(dimension)
+    , params_(params)
+    , max_links0_(params.M * 2)
+    , level_mult_(1.0 / std::log(static_cast<double>(std::max<size_t>(params.M, 2)))) {
+}
+
+float HnswIndex::distance(const float* a, const float* b) const {
+    // Compiled with -fassociative-math (see CMakeLists.txt) so this reduction vectorises
+    float dot = 0.0f;
+    for (size_t i = 0; i < dimension_; ++i) {
+        dot += a[i] * b[i];
+    }
+    return 1.0f - dot;
+}
+
+void HnswIndex::normalise(float* vector) const {
+    float norm = 0.0f;
+    for (size_t i = 0; i < dimension_; ++i) {
+        norm += vector[i] * vector[i];
+    }
+    if (norm <= 0.0f) return;
+    float scale = 1.0f / std::sqrt(norm);
+    for (size_t i = 0; i < dimension_; ++i) {
+        vector[i] *= scale;
+    }
+}
+
+uint32_t* HnswIndex::links(uint32_t node, int level) {
+    if (level == 0) return links0_.data() + static_cast<size_t>(node) * (max_links0_ + 1);
+    return upper_[node].data() + static_cast<size_t>(level - 1) * (params_.M + 1);
+}
+
+const uint32_t* HnswIndex::links(uint32_t node, int level) const {
+    return const_cast<HnswIndex*>(this)->links(node, level);
+}
+
+void HnswIndex::build(std::vector<float> vectors, TaskScheduler& scheduler) {
+    count_ = dimension_ > 0 ? vectors.size() / dimension_ : 0;
+    vectors_ = std::move(vectors);
+    vectors_.resize(count_ * dimension_);
+    for (size_t i = 0; i < count_; ++i) {
+        normalise(vectors_.data() + i * dimension_);
+    }
+
+    // Level of each node: floor(-ln(U) * mL), drawn up front so builds are reproducible
+    std::mt19937_64 rng(params_.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    levels_.resize(count_);
+    upper_.assign(count_, {});
+    for (size_t i = 0; i < count_; ++i) {
+        double u = std::max(uniform(rng), 1e-12);
+        levels_[i] = static_cast<int>(-std::log(u) * level_mult_);
+        upper_[i].assign(static_cast<size_t>(levels_[i]) * (params_.M + 1), 0);
+    }
+    links0_.assign(count_ * (max_links0_ + 1), 0);
+    node_locks_ = std::make_unique<std::mutex[]>(count_);
+    max_level_ = -1;
+    if (count_ == 0) return;
+
+    entry_ = 0;
+    max_level_ = levels_[0];
+    scheduler.parallelFor(count_ - 1, [&](size_t i) { insert(static_cast<uint32_t>(i + 1)); });
+}
+
+void HnswIndex::insert(uint32_t node) {
+    const int level = levels_[node];
+    const float* query = vector(node);
+
+    // A node that raises the top level keeps the entry lock until it is linked, so no
+    // other insert starts from an entry point without links yet
+    std::unique_lock<std::mutex> entry_guard(entry_lock_);
+    uint32_t current = entry_;
+    const int top_level = max_level_;
+    if (level <= top_level) entry_guard.unlock();
+
+    for (int l = top_level; l > level; --l) {
+        current = greedyClosest(query, current, l, true);
+    }
+    for (int l = std::min(level, top_level); l >= 0; --l) {
+        Candidates found = searchLayer(query, current, params_.ef_construction, l, true);
+        current = found.front().second;
+        selectNeighbors(found, params_.M);
+        {
+            std::lock_guard<std::mutex> lock(node_locks_[node]);
+            uint32_t* list = links(node, l);
+            list[0] = static_cast<uint32_t>(found.size());
+            for (size_t i = 0; i < found.size(); ++i) list[i + 1] = found[i].second;
+        }
+        for (const auto& neighbor : found) {
+            connect(neighbor.second, node, l);
+        }
+    }
+    if (level > top_level) {
+        entry_ = node;
+        max_level_ = level;
+    }
+}
+
+uint32_t HnswIndex::greedyClosest(const float* query, uint32_t entry, int level, bool locked) const {
+    uint32_t current = entry;
+    float best = distance(query, vector(current));
+    std::vector<uint32_t> neighbors;
+    for (bool improved = true; improved;) {
+        improved = false;
+        {
+            std::unique_lock<std::mutex> lock;
+            if (locked) lock = std::unique_lock<std::mutex>(node_locks_[current]);
+            const uint32_t* list = links(current, level);
+            neighbors.assign(list + 1, list + 1 + list[0]);
+        }
+        for (uint32_t neighbor : neighbors) {
+            float d = distance(query, vector(neighbor));
+            if (d < best) {
+                best = d;
+                current = neighbor;
+                improved = true;
+            }
+        }
+    }
+    return current;
+}
+
+HnswIndex::Candidates HnswIndex::searchLayer(const float* query, uint32_t entry, size_t ef, int level,
+                                             bool locked) const {
+    visited.reset(count_);
+    MinHeap candidates;
+    MaxHeap nearest;
+    float d = distance(query, vector(entry));
+    candidates.emplace(d, entry);
+    nearest.emplace(d, entry);
+    visited.visit(entry);
+
+    std::vector<uint32_t> neighbors;
+    while (!candidates.empty()) {
+        Entry closest = candidates.top();
+        if (closest.first > nearest.top().first && nearest.size() >= ef) break;
+        candidates.pop();
+        {
+            std::unique_lock<std::mutex> lock;
+            if (locked) lock = std::unique_lock<std::mutex>(node_locks_[closest.second]);
+            const uint32_t* list = links(closest.second, level);
+            neighbors.assign(list + 1, list + 1 + list[0]);
+        }
+        for (uint32_t neighbor : neighbors) {
+            __builtin_prefetch(vector(neighbor));
+        }
+        for (uint32_t neighbor : neighbors) {
+            if (!visited.visit(neighbor)) continue;
+            float nd = distance(query, vector(neighbor));
+            if (nearest.size() < ef || nd < nearest.top().first) {
+                candidates.emplace(nd, neighbor);
+                nearest.emplace(nd, neighbor);
+                if (nearest.size() > ef) nearest.pop();
+            }
+        }
+    }
+
+    Candidates result(nearest.size());
+    for (size_t i = result.size(); i-- > 0;) {
+        result[i] = nearest.top();
+        nearest.pop();
+    }
+    return result;
+}
+
+void HnswIndex::selectNeighbors(Candidates& candidates, size_t keep) const {
+    if (candidates.size() <= keep) return;
+    Candidates kept;
+    Candidates pruned;
+    kept.reserve(keep);
+    for (const auto& candidate : candidates) {
+        if (kept.size() >= keep) break;
+        const float* v = vector(candidate.second);
+        bool diverse = true;
+        for (const auto& chosen : kept) {
+            if (distance(v, vector(chosen.second)) < candidate.first) {
+                diverse = false;
+                break;
+            }
+        }
+        (diverse ? kept : pruned).push_back(candidate);
+    }
+    // Spare slots go to the closest pruned candidates (the paper's keepPrunedConnections)
+    for (size_t i = 0; i < pruned.size() && kept.size() < keep; ++i) {
+        kept.push_back(pruned[i]);
+    }
+    candidates.swap(kept);
+}
+
+void HnswIndex::connect(uint32_t node, uint32_t neighbor, int level) {
+    std::lock_guard<std::mutex> lock(node_locks_[node]);
+    uint32_t* list = links(node, level);
+    const size_t limit = capacity(level);
+    if (list[0] < limit) {
+        list[1 + list[0]] = neighbor;
+        list[0]++;
+        return;
+    }
+    // Full: re-select among the old links and the newcomer
+    const float* v = vector(node);
+    Candidates candidates;
+    candidates.reserve(limit + 1);
+    for (uint32_t i = 1; i <= list[0]; ++i) {
+        candidates.emplace_back(distance(v, vector(list[i])), list[i]);
+    }
+    candidates.emplace_back(distance(v, vector(neighbor)), neighbor);
+    std::sort(candidates.begin(), candidates.end());
+    selectNeighbors(candidates, limit);
+    list[0] = static_cast<uint32_t>(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) list[i + 1] = candidates[i].second;
+}
+
+std::vector<Neighbor> HnswIndex::search(const float* query, size_t k, size_t ef) const {
+    if (count_ == 0 || k == 0) return {};
+    std::vector<float> unit(query, query + dimension_);
+    normalise(unit.data());
+
+    uint32_t current = entry_;
+    for (int l = max_level_; l > 0; --l) {
+        current = greedyClosest(unit.data(), current, l, false);
+    }
+    Candidates found = searchLayer(unit.data(), current, std::max(ef, k), 0, false);
+    std::vector<Neighbor> result;
+    result.reserve(std::min(k, found.size()));
+    for (size_t i = 0; i < found.size() && i < k; ++i) {
+        result.push_back({found[i].first, found[i].second});
+    }
+    return result;
+}
+
+std::vector<Neighbor> HnswIndex::exactSearch(const float* query, size_t k) const {
+    std::vector<float> unit(query, query + dimension_);
+    normalise(unit.data());
+    std::vector<Neighbor> all(count_);
+    for (size_t i = 0; i < count_; ++i) {
+        all[i] = {distance(unit.data(), vector(static_cast<uint32_t>(i))), static_cast<uint32_t>(i)};
+    }
+    k = std::min(k, all.size());
+    std::partial_sort(all.begin(), all.begin() + k, all.end(), [](const Neighbor& a, const Neighbor& b) {
+        return a.distance < b.distance || (a.distance == b.distance && a.id < b.id);
+    });
+    all.resize(k);
+    return all;
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace health_ingestion {
+
+class TaskScheduler;
+
+struct HnswParams {
+    size_t M = 16;                 // Links per node on upper layers; 2*M on layer 0
+    size_t ef_construction = 200;  // Candidate list size while linking a new node
+    uint64_t seed = 42;            // Level draws, so builds are reproducible
+};
+
+// One search hit; distance is cosine distance (1 - cosine similarity)
+struct Neighbor {
+    float distance;
+    uint32_t id;
+};
+
+// Hierarchical navigable small world graph (Malkov & Yashunin) over unit vectors, for
+// top-k cosine search.
+//
+// build() takes every vector at once and links them in parallel on the scheduler,
+// taking a per-node lock whenever a neighbour list is read or rewritten. After that
+// the index is immutable, and search() is lock-free and safe from any number of
+// threads. Vectors are normalised on the way in, so cosine distance is 1 - dot product.
+class HnswIndex {
+public:
+    HnswIndex(size_t dimension, const HnswParams& params = {});
+
+    // Row-major [count][dimension]; replaces any previous contents
+    void build(std::vector<float> vectors, TaskScheduler& scheduler);
+
+    // The k nearest of `query` (dimension floats, any norm), closest first. ef is the
+    // layer-0 candidate list size; larger is slower and more accurate (at least k).
+    std::vector<Neighbor> search(const float* query, size_t k, size_t ef) const;
+
+    // Exhaustive top-k, for measuring recall
+    std::vector<Neighbor> exactSearch(const float* query, size_t k) const;
+
+    size_t size() const { return count_; }
+    size_t dimension() const { return dimension_; }
+    size_t maxLevel() const { return static_cast<size_t>(max_level_); }
+    const float* vector(uint32_t id) const { return vectors_.data() + static_cast<size_t>(id) * dimension_; }
+    // Every normalised vector, [size][dimension] in id order
+    const float* data() const { return vectors_.data(); }
+
+private:
+    using Candidates = std::vector<std::pair<float, uint32_t>>;
+
+    float distance(const float* a, const float* b) const;
+    void normalise(float* vector) const;
+
+    // Neighbour list of node at level: [count, id...]
+    uint32_t* links(uint32_t node, int level);
+    const uint32_t* links(uint32_t node, int level) const;
+    size_t capacity(int level) const { return level == 0 ? max_links0_ : params_.M; }
+
+    void insert(uint32_t node);
+    uint32_t greedyClosest(const float* query, uint32_t entry, int level, bool locked) const;
+    Candidates searchLayer(const float* query, uint32_t entry, size_t ef, int level, bool locked) const;
+    // Keeps up to `keep` candidates (sorted by distance) that are not closer to an already
+    // kept one than to the query: the paper's diversity heuristic
+    void selectNeighbors(Candidates& candidates, size_t keep) const;
+    void connect(uint32_t node, uint32_t neighbor, int level);
+
+    size_t dimension_;
+    HnswParams params_;
+    size_t max_links0_;
+    double level_mult_;
+
+    size_t count_ = 0;
+    std::vector<float> vectors_;
+    std::vector<int> levels_;
+    std::vector<uint32_t> links0_;                 // [count][max_links0_ + 1]
+    std::vector<std::vector<uint32_t>> upper_;     // Per node, levels 1.. at (level-1)*(M+1)
+    std::unique_ptr<std::mutex[]> node_locks_;     // Held while a node's lists change (build only)
+    std::mutex entry_lock_;
+    uint32_t entry_ = 0;
+    int max_level_ = -1;
+};
+
+} // namespace health_ingestion
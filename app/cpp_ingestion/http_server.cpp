@@ -0,0 +1,237 @@
+#include "http_server.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr size_t kMaxHeaderBytes = 64 << 10;
+constexpr size_t kMaxBodyBytes = 256 << 20;
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+std::string trim(const std::string& value) {
+    size_t begin = value.find_first_not_of(" \t");
+    size_t end = value.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? "" : value.substr(begin, end - begin + 1);
+}
+
+// Parses the request line and headers of `head` (without the blank line)
+bool parseHead(const std::string& head, HttpRequest& request) {
+    size_t line_end = head.find("\r\n");
+    std::string request_line = head.substr(0, line_end);
+    size_t sp1 = request_line.find(' ');
+    size_t sp2 = request_line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) return false;
+
+    request.method = request_line.substr(0, sp1);
+    std::string target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    request.query = question == std::string::npos ? "" : target.substr(question + 1);
+
+    size_t pos = line_end == std::string::npos ? head.size() : line_end + 2;
+    while (pos < head.size()) {
+        size_t next = head.find("\r\n", pos);
+        if (next == std::string::npos) next = head.size();
+        std::string line = head.substr(pos, next - pos);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            request.headers[toLower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+        pos = next + 2;
+    }
+    return true;
+}
+
+} // namespace
+
+const char* httpStatusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+HttpServer::HttpServer(uint16_t port, HttpHandler handler)
+    : port_(port)
+    , handler_(std::move(handler))
+    , listen_fd_(-1)
+    , running_(false) {
+}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+bool HttpServer::start() {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "HTTP server: socket() failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd_, SOMAXCONN) < 0) {
+        std::cerr << "HTTP server: cannot listen on port " << port_ << ": " << std::strerror(errno) << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    running_ = true;
+    accept_thread_ = std::thread(&HttpServer::acceptLoop, this);
+    return true;
+}
+
+void HttpServer::stop() {
+    if (!running_.exchange(false)) return;
+
+    // Shutting the listener down unblocks accept(); live connections are cut the same way
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    ::close(listen_fd_);
+    accept_thread_.join();
+
+    std::unique_lock<std::mutex> lock(connections_mutex_);
+    for (int fd : open_fds_) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    connections_idle_.wait(lock, [this] { return open_fds_.empty(); });
+}
+
+void HttpServer::acceptLoop() {
+    while (running_) {
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (!running_) break;
+            continue;
+        }
+        int nodelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        open_fds_.push_back(fd);
+        std::thread(&HttpServer::serveConnection, this, fd).detach();
+    }
+}
+
+void HttpServer::serveConnection(int fd) {
+    std::string buffer;
+    char chunk[16384];
+    bool keep_alive = true;
+
+    while (keep_alive && running_) {
+        // Read until the end of the headers
+        size_t head_end;
+        while ((head_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (buffer.size() > kMaxHeaderBytes) { keep_alive = false; break; }
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) { keep_alive = false; break; }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        if (!keep_alive) break;
+
+        HttpRequest request;
+        HttpResponse response;
+        bool valid = parseHead(buffer.substr(0, head_end), request);
+        if (!valid) {
+            response = {400, "application/json", "{\"error\": \"malformed request\"}"};
+            keep_alive = false;
+        }
+
+        size_t body_size = 0;
+        auto length = request.headers.find("content-length");
+        if (length != request.headers.end()) {
+            body_size = std::strtoull(length->second.c_str(), nullptr, 10);
+        }
+        if (body_size > kMaxBodyBytes) {
+            response = {413, "application/json", "{\"error\": \"body too large\"}"};
+            keep_alive = false;
+            valid = false;
+            body_size = 0;
+        }
+
+        size_t total = head_end + 4 + body_size;
+        while (keep_alive && buffer.size() < total) {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) { keep_alive = false; break; }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        if (buffer.size() < total) break;
+
+        if (valid) {
+            request.body = buffer.substr(head_end + 4, body_size);
+            try {
+                response = handler_(request);
+            } catch (const std::exception& e) {
+                response = {500, "application/json", std::string("{\"error\": \"") + e.what() + "\"}"};
+            }
+        }
+        buffer.erase(0, total);
+
+        auto connection = request.headers.find("connection");
+        if (connection != request.headers.end() && toLower(connection->second) == "close") {
+            keep_alive = false;
+        }
+
+        std::string out = "HTTP/1.1 " + std::to_string(response.status) + " " +
+                          httpStatusText(response.status) + "\r\n" +
+                          "Content-Type: " + response.content_type + "\r\n" +
+                          "Content-Length: " + std::to_string(response.body.size()) + "\r\n" +
+                          (keep_alive ? "" : "Connection: close\r\n") + "\r\n" + response.body;
+        if (!sendAll(fd, out)) break;
+    }
+
+    {
+        // Untrack before closing so a reused descriptor number is never shut down by stop()
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        open_fds_.erase(std::find(open_fds_.begin(), open_fds_.end(), fd));
+        if (open_fds_.empty()) connections_idle_.notify_all();
+    }
+    ::close(fd);
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace health_ingestion {
+
+struct HttpRequest {
+    std::string method;
+    std::string path;   // Without query string
+    std::string query;
+    std::unordered_map<std::string, std::string> headers;  // Lower-cased names
+    std::string body;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string content_type = "application/json";
+    std::string body;
+};
+
+using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+
+// Minimal embedded HTTP/1.1 server (keep-alive, Content-Length bodies) on a thread per connection.
+// Good enough for status endpoints and local stand-in services; not meant for the open internet.
+class HttpServer {
+public:
+    HttpServer(uint16_t port, HttpHandler handler);
+    ~HttpServer();
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    // Binds and starts accepting; port 0 picks an ephemeral port
+    bool start();
+    void stop();
+
+    uint16_t port() const { return port_; }
+
+private:
+    void acceptLoop();
+    void serveConnection(int fd);
+
+    uint16_t port_;
+    HttpHandler handler_;
+    int listen_fd_;
+    std::atomic<bool> running_;
+    std::thread accept_thread_;
+    std::mutex connections_mutex_;
+    std::condition_variable connections_idle_;
+    std::vector<int> open_fds_;  // Connections being served by detached threads
+};
+
+const char* httpStatusText(int status);
+
+} // namespace health_ingestion
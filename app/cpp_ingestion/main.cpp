@@ -1,15 +1,253 @@
 #include "health_processor.hpp"
+#include "http_server.hpp"
+#include "metrics.hpp"
+#include "mock_ingest.hpp"
+#include "embedding_model.hpp"
+#include "embedding_cache.hpp"
+#include "work_manifest.hpp"
 #include <iostream>
 #include <filesystem>
+#include <fstream>
 #include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [data_dir] [options]\n"
+              << "  --memory-budget <size>  Cap the user-day accumulator (e.g. 512M, 2G);\n"
+              << "                          overflow is spilled to sorted runs and merged\n"
+              << "  --spill-dir <dir>       Directory for spill runs (default: system temp)\n"
+              << "  --shard <i>/<N>         Only aggregate users with hash(user_id) % N == i\n"
+              << "  --coordinate <work_dir> Cut input into byte-range units and run local workers\n"
+              << "  --workers <n>           Worker processes for --coordinate (default: CPU count)\n"
+              << "  --unit-size <size>      Target bytes per work unit (default: 64M)\n"
+              << "  --worker <work_dir>     Join an existing coordinated run as one more worker\n"
+              << "  --report <path>         Write the JSON per-stage performance report to a file\n"
+              << "  --bench-csv <path>      Append per-stage seconds to a benchmark CSV\n"
+              << "  --metrics-port <port>   Serve Prometheus metrics on /metrics (e.g. 9090)\n"
+              << "  --threads <n>           Parse/summarise threads per process (default: CPU\n"
+              << "                          count, or 1 per worker process)\n"
+              << "  --output <sink>         Where summaries go: http[:<url>] (default, URL from\n"
+              << "                          API_URL), stdout, ndjson:<path>, weaviate[:<url>][,batch=N]\n"
+              << "                          [,class=C][,embed=<api>/embed] (URL from WEAVIATE_URL) or null\n"
+              << "  --mock-ingest <spec>    Benchmark the client against an in-process mock /ingest\n"
+              << "                          server, e.g. latency=lognormal:5ms:80ms,error-rate=0.01,\n"
+              << "                          error-status=500/503 (use latency=none for no delay)\n"
+              << "  --embed-model <dir>     Embed summaries in-process with the model exported by\n"
+              << "                          export_minilm.py and send vectors with the text\n"
+              << "  --embed-cache <spec>    Persistent text-hash -> embedding cache consulted before\n"
+              << "                          embedding: <path>[,entries=N][,dim=D] (entries 65536,\n"
+              << "                          dim the model's or 384 for vectors returned by the API)\n";
+}
+
+// Parses "<path>[,entries=N][,dim=D]"
+static bool parseCacheSpec(const std::string& spec, std::string& path, size_t& entries, size_t& dimension) {
+    size_t comma = spec.find(',');
+    path = spec.substr(0, comma);
+    while (comma != std::string::npos) {
+        size_t next = spec.find(',', comma + 1);
+        std::string item = spec.substr(comma + 1, next == std::string::npos ? std::string::npos : next - comma - 1);
+        comma = next;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        try {
+            if (item.compare(0, eq, "entries") == 0) entries = std::stoul(item.substr(eq + 1));
+            else if (item.compare(0, eq, "dim") == 0) dimension = std::stoul(item.substr(eq + 1));
+            else return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return !path.empty();
+}
+
+// Parses sizes like "1048576", "512K", "512M" or "2G"
+static bool parseByteSize(const std::string& text, size_t& bytes) {
+    try {
+        size_t pos = 0;
+        unsigned long long value = std::stoull(text, &pos);
+        std::string suffix = text.substr(pos);
+        if (suffix == "K" || suffix == "k") value <<= 10;
+        else if (suffix == "M" || suffix == "m") value <<= 20;
+        else if (suffix == "G" || suffix == "g") value <<= 30;
+        else if (!suffix.empty()) return false;
+        bytes = static_cast<size_t>(value);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Parses "i/N" with 0 <= i < N
+static bool parseShard(const std::string& text, size_t& index, size_t& count) {
+    size_t slash = text.find('/');
+    if (slash == std::string::npos) return false;
+    try {
+        index = std::stoul(text.substr(0, slash));
+        count = std::stoul(text.substr(slash + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return count > 0 && index < count;
+}
+
+// A coordinated worker; its counters are published to the work dir every second so the
+// coordinator's /metrics can sum them
+static bool runPublishingWorker(health_ingestion::HealthDataProcessor& processor, const std::string& work_dir) {
+    health_ingestion::WorkManifest manifest(work_dir);
+    std::error_code ec;
+    std::filesystem::create_directories(manifest.metricsDir(), ec);  // --worker may start before the plan
+    health_ingestion::MetricsPublisher publisher(manifest.metricsPath(getpid()), std::chrono::seconds(1));
+    return processor.runWorker(work_dir);
+}
+
+// Live status endpoint for Prometheus scrapes; nullptr if it cannot listen. Coordinated
+// runs count in the forked workers, which publish snapshots to the work dir
+static std::unique_ptr<health_ingestion::HttpServer> startStatusServer(int port, const std::string& coordinate_dir) {
+    auto server = std::make_unique<health_ingestion::HttpServer>(
+        static_cast<uint16_t>(port), [coordinate_dir](const health_ingestion::HttpRequest& request) {
+            health_ingestion::HttpResponse response;
+            if (request.path == "/metrics") {
+                response.content_type = "text/plain; version=0.0.4";
+                response.body = coordinate_dir.empty()
+                    ? health_ingestion::metrics().renderPrometheus()
+                    : health_ingestion::renderPrometheusWithSnapshots(
+                          health_ingestion::WorkManifest(coordinate_dir).metricsDir());
+            } else if (request.path == "/health") {
+                response.body = "{\"status\": \"ok\"}";
+            } else {
+                response.status = 404;
+                response.body = "{\"error\": \"not found\"}";
+            }
+            return response;
+        });
+    if (!server->start()) {
+        return nullptr;
+    }
+    std::cout << "Metrics available on http://0.0.0.0:" << server->port() << "/metrics" << std::endl;
+    return server;
+}
+
+// Client throughput and tail latency of a --mock-ingest run
+static void printMockReport(const health_ingestion::MockIngestServer& server, double wall_seconds) {
+    health_ingestion::DeliveryStats stats = health_ingestion::deliveryStats();
+    uint64_t delivered = stats.sent - std::min(stats.sent, stats.failed);
+    
+    std::cout << "\n=== Mock Ingest Benchmark ===" << std::endl;
+    if (server.batchObjects() > 0) {
+        // --output weaviate: whole batches per request, so only the totals are meaningful
+        std::cout << "Requests served:    " << server.requests() << " (" << server.injectedErrors()
+                  << " injected errors, " << server.bodyBytes() / 1024 << " KiB of payload)" << std::endl;
+        std::cout << "Batch objects:      " << server.batchObjects() << " via /v1/batch/objects ("
+                  << server.embeddedRequests() << " with vectors)" << std::endl;
+        std::cout << "End-to-end rate:    " << (wall_seconds > 0 ? server.batchObjects() / wall_seconds : 0.0)
+                  << " summaries/s over " << wall_seconds << "s" << std::endl;
+        return;
+    }
+    std::cout << "Summaries sent:     " << stats.sent << " (" << delivered << " delivered, "
+              << stats.failed << " failed, " << stats.retries << " retries)" << std::endl;
+    std::cout << "Requests served:    " << server.requests() << " (" << server.injectedErrors()
+              << " injected errors, " << server.bodyBytes() / 1024 << " KiB of payload, "
+              << server.embeddedRequests() << " summaries with embeddings)" << std::endl;
+    std::cout << "End-to-end rate:    " << (wall_seconds > 0 ? delivered / wall_seconds : 0.0)
+              << " summaries/s over " << wall_seconds << "s" << std::endl;
+    std::cout << "Send-only rate:     " << (stats.send_seconds > 0 ? stats.sent / stats.send_seconds : 0.0)
+              << " summaries/s per sending thread" << std::endl;
+    std::cout << "Send latency:       p50 " << stats.p50 * 1e3 << " ms, p95 " << stats.p95 * 1e3
+              << " ms, p99 " << stats.p99 * 1e3 << " ms (including retries)" << std::endl;
+}
 
 int main(int argc, char* argv[]) {
     std::cout << "=== High-Performance C++ Health Data Ingestion ===" << std::endl;
     
-    // Determine data directory
+    // Determine data directory and options
     std::string data_dir = "/home/gl1tch/Repos/Project/app/data";
-    if (argc > 1) {
-        data_dir = argv[1];
+    size_t memory_budget = 0;
+    std::string spill_dir;
+    size_t shard_index = 0;
+    size_t shard_count = 1;
+    std::string coordinate_dir;
+    std::string worker_dir;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t unit_size = 64 << 20;
+    long threads = -1;  // Unset
+    int metrics_port = -1;  // Disabled
+    std::string report_path;
+    std::string bench_csv;
+    std::string mock_spec;
+    std::string output_spec;
+    std::string embed_model;
+    std::string embed_cache_spec;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--memory-budget" && i + 1 < argc) {
+            if (!parseByteSize(argv[++i], memory_budget)) {
+                std::cerr << "Error: Invalid --memory-budget value: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--spill-dir" && i + 1 < argc) {
+            spill_dir = argv[++i];
+        } else if (arg == "--shard" && i + 1 < argc) {
+            if (!parseShard(argv[++i], shard_index, shard_count)) {
+                std::cerr << "Error: Invalid --shard value (expected i/N): " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--coordinate" && i + 1 < argc) {
+            coordinate_dir = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            worker_dir = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = std::strtoul(argv[++i], nullptr, 10);
+            if (workers == 0) {
+                std::cerr << "Error: --workers must be at least 1" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--unit-size" && i + 1 < argc) {
+            if (!parseByteSize(argv[++i], unit_size) || unit_size == 0) {
+                std::cerr << "Error: Invalid --unit-size value: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtol(argv[++i], nullptr, 10);
+            if (threads < 0) {
+                std::cerr << "Error: Invalid --threads value: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            metrics_port = std::atoi(argv[++i]);
+            if (metrics_port < 0 || metrics_port > 65535) {
+                std::cerr << "Error: Invalid --metrics-port value: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--report" && i + 1 < argc) {
+            report_path = argv[++i];
+        } else if (arg == "--bench-csv" && i + 1 < argc) {
+            bench_csv = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            output_spec = argv[++i];
+        } else if (arg == "--mock-ingest" && i + 1 < argc) {
+            mock_spec = argv[++i];
+        } else if (arg == "--embed-model" && i + 1 < argc) {
+            embed_model = argv[++i];
+        } else if (arg == "--embed-cache" && i + 1 < argc) {
+            embed_cache_spec = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            data_dir = arg;
+        }
     }
     
     // Check if data directory exists
@@ -20,18 +258,130 @@ int main(int argc, char* argv[]) {
     
     std::cout << "Using data directory: " << data_dir << std::endl;
     
-    // Initialize processor
-    health_ingestion::HealthDataProcessor processor(data_dir);
+    // A coordinator starts its status server only after forking the workers, so they
+    // inherit neither its threads nor its listening socket
+    std::unique_ptr<health_ingestion::HttpServer> status_server;
+    if (metrics_port >= 0 && coordinate_dir.empty()) {
+        status_server = startStatusServer(metrics_port, coordinate_dir);
+        if (!status_server) {
+            return 1;
+        }
+    }
     
-    // Configure settings - use environment variable or default
+    // The sink is chosen once here; API_URL=PRINT_MODE is kept as an alias for --output stdout
+    health_ingestion::OutputConfig output;
     const char* api_url = std::getenv("API_URL");
-    if (!api_url) {
-        api_url = "http://localhost:5000/ingest";
+    if (!output_spec.empty()) {
+        if (!health_ingestion::OutputConfig::parse(output_spec, output)) {
+            std::cerr << "Error: Invalid --output value: " << output_spec << std::endl;
+            return 1;
+        }
+    } else if (api_url && std::string(api_url) == "PRINT_MODE") {
+        output.kind = health_ingestion::OutputConfig::Kind::Stdout;
+    }
+    if (output.kind == health_ingestion::OutputConfig::Kind::Http && output.target.empty()) {
+        output.target = api_url ? api_url : "http://localhost:5000/ingest";
+    }
+    if (output.kind == health_ingestion::OutputConfig::Kind::Weaviate && output.target.empty()) {
+        const char* weaviate_url = std::getenv("WEAVIATE_URL");
+        output.target = weaviate_url ? weaviate_url : "http://localhost:8080";
     }
+    if (output.kind == health_ingestion::OutputConfig::Kind::Ndjson &&
+        !std::ofstream(output.target, std::ios::app).is_open()) {
+        std::cerr << "Error: Cannot open output file: " << output.target << std::endl;
+        return 1;
+    }
+    
+    // Benchmark mode: the vector API is replaced by a local mock with a known latency profile
+    std::unique_ptr<health_ingestion::MockIngestServer> mock_server;
+    if (!mock_spec.empty()) {
+        health_ingestion::MockIngestConfig mock_config;
+        if (!health_ingestion::MockIngestConfig::parse(mock_spec, mock_config)) {
+            std::cerr << "Error: Invalid --mock-ingest spec: " << mock_spec << std::endl;
+            return 1;
+        }
+        if (!coordinate_dir.empty() || !worker_dir.empty()) {
+            std::cerr << "Error: --mock-ingest cannot be combined with --coordinate or --worker" << std::endl;
+            return 1;
+        }
+        // The mock stands in for the vector API, so only the sinks that talk to it make sense
+        if (output.kind != health_ingestion::OutputConfig::Kind::Http &&
+            output.kind != health_ingestion::OutputConfig::Kind::Weaviate) {
+            std::cerr << "Error: --mock-ingest needs the http or weaviate output, not "
+                      << output.describe() << std::endl;
+            return 1;
+        }
+        mock_server = std::make_unique<health_ingestion::MockIngestServer>(0, mock_config);
+        if (!mock_server->start()) {
+            return 1;
+        }
+        std::cout << "Mock ingest server on " << mock_server->url() << " ("
+                  << mock_config.describe() << ")" << std::endl;
+        if (output.kind == health_ingestion::OutputConfig::Kind::Weaviate) {
+            // The mock also serves the Weaviate batch/schema endpoints and /embed
+            output.target = mock_server->baseUrl();
+            if (!output.embed_url.empty()) output.embed_url = mock_server->baseUrl() + "/embed";
+        } else {
+            output.target = mock_server->url();
+        }
+    }
+    std::cout << "Output: " << output.describe() << std::endl;
+    
+    // Loaded before any fork() so worker processes share the weights copy-on-write
+    std::shared_ptr<const health_ingestion::SentenceEncoder> encoder;
+    if (!embed_model.empty()) {
+        encoder = health_ingestion::SentenceEncoder::load(embed_model);
+        if (!encoder) {
+            std::cerr << "Error: Cannot load embedding model from " << embed_model << std::endl;
+            return 1;
+        }
+        const auto& config = encoder->config();
+        std::cout << "Embedding: " << embed_model << " (" << encoder->dimension() << "-d, "
+                  << config.layers << " layers, " << config.vocab_size << " tokens)" << std::endl;
+    }
+    
+    // Mapped MAP_SHARED before any fork(), so workers share one table
+    std::shared_ptr<health_ingestion::EmbeddingCache> embed_cache;
+    if (!embed_cache_spec.empty()) {
+        std::string cache_path;
+        size_t entries = 1 << 16;
+        size_t dimension = 0;
+        if (!parseCacheSpec(embed_cache_spec, cache_path, entries, dimension)) {
+            std::cerr << "Error: Invalid --embed-cache value: " << embed_cache_spec << std::endl;
+            return 1;
+        }
+        if (encoder && dimension != 0 && dimension != encoder->dimension()) {
+            std::cerr << "Error: --embed-cache dim=" << dimension << " does not match the "
+                      << encoder->dimension() << "-d model" << std::endl;
+            return 1;
+        }
+        if (dimension == 0) dimension = encoder ? encoder->dimension() : 384;
+        embed_cache = health_ingestion::EmbeddingCache::open(cache_path, dimension, entries);
+        if (!embed_cache) {
+            return 1;
+        }
+        std::cout << "Embedding cache: " << cache_path << " (" << embed_cache->size() << " entries, "
+                  << embed_cache->capacity() << " slots, " << dimension << "-d)" << std::endl;
+    }
+    
+    // Initialize processor
+    health_ingestion::HealthDataProcessor processor(data_dir);
     
-    processor.setApiUrl(api_url);
+    // Configure settings
+    processor.setOutput(output);
     processor.setBatchSize(100);
     processor.setMaxConcurrentRequests(10);
+    processor.setMemoryBudget(memory_budget);
+    processor.setSpillDir(spill_dir);
+    processor.setShard(shard_index, shard_count);
+    processor.setReportPath(report_path);
+    processor.setBenchmarkCsv(bench_csv);
+    processor.setEncoder(encoder);
+    processor.setEmbeddingCache(embed_cache);
+    
+    // Worker processes already provide the parallelism unless threads are requested
+    bool multi_process = !worker_dir.empty() || !coordinate_dir.empty();
+    processor.setThreads(threads >= 0 ? static_cast<size_t>(threads) : (multi_process ? 1 : 0));
     
     // Load user profiles
     if (!processor.loadUserProfiles()) {
@@ -39,9 +389,65 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if (!worker_dir.empty()) {
+        return runPublishingWorker(processor, worker_dir) ? 0 : 1;
+    }
+    
+    if (!coordinate_dir.empty()) {
+        // Over-partition the merge so fast workers can also steal merge work
+        if (!processor.planWork(coordinate_dir, unit_size, workers * 4)) {
+            std::cerr << "Failed to plan work in " << coordinate_dir << std::endl;
+            return 1;
+        }
+        
+        std::vector<pid_t> children;
+        for (size_t w = 0; w < workers; ++w) {
+            std::cout.flush();
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "fork() failed after " << w << " workers" << std::endl;
+                break;
+            }
+            if (pid == 0) {
+                bool ok = runPublishingWorker(processor, coordinate_dir);
+                std::cout.flush();
+                _exit(ok ? 0 : 1);
+            }
+            children.push_back(pid);
+        }
+        if (metrics_port >= 0) {
+            // The workers are already running; losing the endpoint is not worth stopping them
+            status_server = startStatusServer(metrics_port, coordinate_dir);
+            if (!status_server) std::cerr << "Warning: continuing without /metrics" << std::endl;
+        }
+        
+        // Reap in exit order: a killed worker must not linger as a zombie, or the
+        // others' liveness probe on its claims would still see it running
+        int failed = 0;
+        for (size_t reaped = 0; reaped < children.size(); ++reaped) {
+            int status = 0;
+            if (waitpid(-1, &status, 0) < 0) break;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+        }
+        if (failed > 0 || children.empty()) {
+            std::cerr << failed << " worker(s) failed; see " << coordinate_dir << "/done" << std::endl;
+            return 1;
+        }
+        health_ingestion::WorkManifest(coordinate_dir).removeScratch();
+        std::cout << "Ingestion completed successfully!" << std::endl;
+        return 0;
+    }
+    
     // Process all data files
+    auto run_start = std::chrono::steady_clock::now();
     processor.processAllFiles();
     
+    if (mock_server) {
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+        mock_server->stop();
+        printMockReport(*mock_server, wall);
+    }
+    
     std::cout << "Ingestion completed successfully!" << std::endl;
     return 0;
 }
\ No newline at end of file
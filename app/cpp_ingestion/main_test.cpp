@@ -22,7 +22,7 @@ int main(int argc, char* argv[]) {
     
     // Initialize processor with dry-run mode
     health_ingestion::HealthDataProcessor processor(data_dir);
-    processor.setApiUrl("PRINT_MODE");  // Special flag to print instead of send
+    processor.setOutput({health_ingestion::OutputConfig::Kind::Stdout, ""});  // Print instead of send
     processor.setBatchSize(10);         // Smaller batches for testing
     
     if (!processor.loadUserProfiles()) {
@@ -0,0 +1,246 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace health_ingestion {
+
+Histogram::Histogram(std::vector<double> upper_bounds)
+    : bounds_(std::move(upper_bounds))
+    , buckets_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+    std::sort(bounds_.begin(), bounds_.end());
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(double value) {
+    size_t index = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    buckets_[index].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    addSum(value);
+}
+
+void Histogram::merge(const std::vector<uint64_t>& buckets, uint64_t count, double sum) {
+    for (size_t i = 0; i < buckets.size() && i <= bounds_.size(); ++i) {
+        buckets_[i].fetch_add(buckets[i], std::memory_order_relaxed);
+    }
+    count_.fetch_add(count, std::memory_order_relaxed);
+    addSum(sum);
+}
+
+void Histogram::addSum(double value) {
+    // std::atomic<double> has no fetch_add before C++20
+    double current = sum_.load(std::memory_order_relaxed);
+    while (!sum_.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
+double Histogram::quantile(double q) const {
+    uint64_t total = count();
+    if (total == 0) return 0.0;
+
+    double rank = q * static_cast<double>(total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        uint64_t in_bucket = bucketCount(i);
+        if (in_bucket > 0 && static_cast<double>(seen + in_bucket) >= rank) {
+            if (i == bounds_.size()) return bounds_.empty() ? 0.0 : bounds_.back();
+            double lower = i == 0 ? 0.0 : bounds_[i - 1];
+            double fraction = (rank - static_cast<double>(seen)) / static_cast<double>(in_bucket);
+            return lower + (bounds_[i] - lower) * fraction;
+        }
+        seen += in_bucket;
+    }
+    return bounds_.empty() ? 0.0 : bounds_.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& family = families_[name];
+    family.type = "counter";
+    family.help = help;
+    auto& slot = family.counters[labels];
+    if (!slot) slot = std::make_unique<Counter>();
+    return *slot;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& family = families_[name];
+    family.type = "gauge";
+    family.help = help;
+    auto& slot = family.gauges[labels];
+    if (!slot) slot = std::make_unique<Gauge>();
+    return *slot;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      const std::vector<double>& upper_bounds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& family = families_[name];
+    family.type = "histogram";
+    family.help = help;
+    if (!family.histogram) family.histogram = std::make_unique<Histogram>(upper_bounds);
+    return *family.histogram;
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+
+    auto series = [&](const std::string& name, const std::string& labels) {
+        out << name;
+        if (!labels.empty()) out << "{" << labels << "}";
+        out << " ";
+    };
+
+    for (const auto& [name, family] : families_) {
+        out << "# HELP " << name << " " << family.help << "\n";
+        out << "# TYPE " << name << " " << family.type << "\n";
+        for (const auto& [labels, counter] : family.counters) {
+            series(name, labels);
+            out << counter->value() << "\n";
+        }
+        for (const auto& [labels, gauge] : family.gauges) {
+            series(name, labels);
+            out << gauge->value() << "\n";
+        }
+        if (family.histogram) {
+            const Histogram& histogram = *family.histogram;
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < histogram.bounds().size(); ++i) {
+                cumulative += histogram.bucketCount(i);
+                out << name << "_bucket{le=\"" << histogram.bounds()[i] << "\"} " << cumulative << "\n";
+            }
+            cumulative += histogram.bucketCount(histogram.bounds().size());
+            out << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+            out << name << "_sum " << histogram.sum() << "\n";
+            out << name << "_count " << histogram.count() << "\n";
+        }
+    }
+    return out.str();
+}
+
+// Lines are "family\t<name>\t<type>\t<help>", then "counter|gauge\t<name>\t<labels>\t<value>"
+// and "histogram\t<name>\t<sum>\t<count>\t<bounds>\t<buckets>" with space-separated lists
+std::string MetricsRegistry::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    out.precision(17);
+    for (const auto& [name, family] : families_) {
+        out << "family\t" << name << "\t" << family.type << "\t" << family.help << "\n";
+        for (const auto& [labels, counter] : family.counters) {
+            out << "counter\t" << name << "\t" << labels << "\t" << counter->value() << "\n";
+        }
+        for (const auto& [labels, gauge] : family.gauges) {
+            out << "gauge\t" << name << "\t" << labels << "\t" << gauge->value() << "\n";
+        }
+        if (family.histogram) {
+            const Histogram& histogram = *family.histogram;
+            out << "histogram\t" << name << "\t" << histogram.sum() << "\t" << histogram.count() << "\t";
+            for (size_t i = 0; i < histogram.bounds().size(); ++i) {
+                out << (i ? " " : "") << histogram.bounds()[i];
+            }
+            out << "\t";
+            for (size_t i = 0; i <= histogram.bounds().size(); ++i) {
+                out << (i ? " " : "") << histogram.bucketCount(i);
+            }
+            out << "\n";
+        }
+    }
+    return out.str();
+}
+
+void MetricsRegistry::merge(const std::string& snapshot) {
+    std::map<std::string, std::string> help;
+    std::istringstream in(snapshot);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::istringstream columns(line);
+        std::string field;
+        while (std::getline(columns, field, '\t')) fields.push_back(field);
+        if (fields.size() < 4) continue;
+
+        const std::string& kind = fields[0];
+        const std::string& name = fields[1];
+        if (kind == "family") {
+            help[name] = fields[3];
+        } else if (kind == "counter") {
+            counter(name, help[name], fields[2]).inc(std::stoull(fields[3]));
+        } else if (kind == "gauge") {
+            gauge(name, help[name], fields[2]).add(std::stoll(fields[3]));
+        } else if (kind == "histogram" && fields.size() == 6) {
+            std::vector<double> bounds;
+            std::vector<uint64_t> buckets;
+            std::istringstream bound_list(fields[4]);
+            for (double bound; bound_list >> bound;) bounds.push_back(bound);
+            std::istringstream bucket_list(fields[5]);
+            for (uint64_t count; bucket_list >> count;) buckets.push_back(count);
+            histogram(name, help[name], bounds).merge(buckets, std::stoull(fields[3]), std::stod(fields[2]));
+        }
+    }
+}
+
+MetricsRegistry& metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsPublisher::MetricsPublisher(const std::string& path, std::chrono::milliseconds interval)
+    : path_(path) {
+    thread_ = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, interval, [this] { return stopping_; })) {
+            publish();
+        }
+    });
+}
+
+MetricsPublisher::~MetricsPublisher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    publish();
+}
+
+void MetricsPublisher::publish() {
+    // Renamed into place so a scrape never reads half a snapshot
+    std::string tmp_path = path_ + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        out << metrics().snapshot();
+        if (!out) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path_, ec);
+    if (ec) {
+        std::cerr << "Failed to publish metrics to " << path_ << ": " << ec.message() << std::endl;
+    }
+}
+
+std::string renderPrometheusWithSnapshots(const std::string& dir) {
+    MetricsRegistry combined;
+    combined.merge(metrics().snapshot());
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.path().extension() != ".metrics") continue;
+        std::ifstream in(entry.path());
+        std::stringstream text;
+        text << in.rdbuf();
+        combined.merge(text.str());
+    }
+    return combined.renderPrometheus();
+}
+
+std::vector<double> latencyBuckets() {
+    return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0};
+}
+
+} // namespace health_ingestion
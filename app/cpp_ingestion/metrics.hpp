@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace health_ingestion {
+
+class Counter {
+public:
+    void inc(uint64_t amount = 1) { value_.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Fixed-bucket histogram; observations are lock-free
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> upper_bounds);
+
+    void observe(double value);
+    // Adds another histogram's observations; `buckets` is non-cumulative, +Inf last
+    void merge(const std::vector<uint64_t>& buckets, uint64_t count, double sum);
+
+    const std::vector<double>& bounds() const { return bounds_; }
+    uint64_t bucketCount(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    // Estimated q-quantile (0..1) by linear interpolation inside the matching bucket
+    double quantile(double q) const;
+
+private:
+    void addSum(double value);
+
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_;  // Non-cumulative, last one is +Inf
+    std::atomic<uint64_t> count_{0};
+    std::atomic<double> sum_{0.0};
+};
+
+// Process-wide registry rendered in the Prometheus text exposition format.
+// Registration takes a lock; callers keep the returned reference for hot paths.
+class MetricsRegistry {
+public:
+    // `labels` is a pre-rendered label set such as `file="sleep.json"` (empty for none)
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         const std::vector<double>& upper_bounds);
+
+    std::string renderPrometheus() const;
+
+    // Every series and its value as tab-separated lines, for another process to merge()
+    std::string snapshot() const;
+    // Adds a snapshot's values: counters and gauges are summed, histograms combined
+    void merge(const std::string& snapshot);
+
+private:
+    struct Family {
+        std::string type;
+        std::string help;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+MetricsRegistry& metrics();
+
+// Writes metrics().snapshot() to a file every interval and once more when destroyed,
+// so a worker process's counters can be served by the process that owns /metrics
+class MetricsPublisher {
+public:
+    MetricsPublisher(const std::string& path, std::chrono::milliseconds interval);
+    ~MetricsPublisher();
+
+    MetricsPublisher(const MetricsPublisher&) = delete;
+    MetricsPublisher& operator=(const MetricsPublisher&) = delete;
+
+private:
+    void publish();
+
+    std::string path_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// Prometheus text for this process's metrics plus every snapshot file in `dir`
+std::string renderPrometheusWithSnapshots(const std::string& dir);
+
+// Bucket bounds (seconds) suited to HTTP round trips
+std::vector<double> latencyBuckets();
+
+} // namespace health_ingestion
@@ -0,0 +1,287 @@
+#include "mock_ingest.hpp"
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace health_ingestion {
+
+namespace {
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+std::string formatSeconds(double seconds) {
+    std::ostringstream out;
+    if (seconds < 1e-3) out << seconds * 1e6 << "us";
+    else if (seconds < 1.0) out << seconds * 1e3 << "ms";
+    else out << seconds << "s";
+    return out.str();
+}
+
+} // namespace
+
+bool parseDuration(const std::string& text, double& seconds) {
+    try {
+        size_t pos = 0;
+        double value = std::stod(text, &pos);
+        std::string unit = text.substr(pos);
+        if (unit == "us") seconds = value / 1e6;
+        else if (unit == "ms" || unit.empty()) seconds = value / 1e3;
+        else if (unit == "s") seconds = value;
+        else return false;
+        return seconds >= 0.0;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool LatencyModel::parse(const std::string& text, LatencyModel& model) {
+    std::vector<std::string> parts = split(text, ':');
+    if (parts.empty()) return false;
+    const std::string& kind = parts[0];
+
+    model = LatencyModel();
+    if (kind == "none" && parts.size() == 1) return true;
+    if (kind == "fixed" && parts.size() == 2) {
+        model.kind = Kind::Fixed;
+        return parseDuration(parts[1], model.a);
+    }
+    if (kind == "exp" && parts.size() == 2) {
+        model.kind = Kind::Exponential;
+        return parseDuration(parts[1], model.a) && model.a > 0.0;
+    }
+    if (kind == "uniform" && parts.size() == 3) {
+        model.kind = Kind::Uniform;
+        return parseDuration(parts[1], model.a) && parseDuration(parts[2], model.b) && model.a <= model.b;
+    }
+    if (kind == "lognormal" && parts.size() == 3) {
+        model.kind = Kind::LogNormal;
+        return parseDuration(parts[1], model.a) && parseDuration(parts[2], model.b) &&
+               model.a > 0.0 && model.b >= model.a;
+    }
+    return false;
+}
+
+double LatencyModel::sample(std::mt19937_64& rng) const {
+    switch (kind) {
+        case Kind::None:
+            return 0.0;
+        case Kind::Fixed:
+            return a;
+        case Kind::Uniform:
+            return std::uniform_real_distribution<double>(a, b)(rng);
+        case Kind::Exponential:
+            return std::exponential_distribution<double>(1.0 / a)(rng);
+        case Kind::LogNormal: {
+            // Median and p99 pin mu and sigma; z(0.99) = 2.3263
+            double sigma = std::log(b / a) / 2.3263;
+            return std::lognormal_distribution<double>(std::log(a), sigma)(rng);
+        }
+    }
+    return 0.0;
+}
+
+std::string LatencyModel::describe() const {
+    switch (kind) {
+        case Kind::None: return "none";
+        case Kind::Fixed: return "fixed " + formatSeconds(a);
+        case Kind::Uniform: return "uniform " + formatSeconds(a) + ".." + formatSeconds(b);
+        case Kind::Exponential: return "exponential mean " + formatSeconds(a);
+        case Kind::LogNormal: return "lognormal median " + formatSeconds(a) + ", p99 " + formatSeconds(b);
+    }
+    return "unknown";
+}
+
+bool MockIngestConfig::parse(const std::string& spec, MockIngestConfig& config) {
+    for (const std::string& item : split(spec, ',')) {
+        if (item.empty()) continue;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        try {
+            if (key == "latency") {
+                if (!LatencyModel::parse(value, config.latency)) return false;
+            } else if (key == "error-rate") {
+                config.error_rate = std::stod(value);
+                if (config.error_rate < 0.0 || config.error_rate > 1.0) return false;
+            } else if (key == "error-status") {
+                config.error_statuses.clear();
+                for (const std::string& status : split(value, '/')) {
+                    config.error_statuses.push_back(std::stoi(status));
+                }
+                if (config.error_statuses.empty()) return false;
+            } else if (key == "ok-status") {
+                config.ok_status = std::stoi(value);
+            } else if (key == "embed-dim") {
+                config.embed_dim = std::stoul(value);
+            } else if (key == "seed") {
+                config.seed = std::stoull(value);
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string MockIngestConfig::describe() const {
+    std::ostringstream out;
+    out << "latency " << latency.describe() << ", error rate " << error_rate << " (status";
+    for (int status : error_statuses) out << " " << status;
+    out << "), ok status " << ok_status;
+    if (embed_dim > 0) out << ", " << embed_dim << "-d embeddings";
+    return out.str();
+}
+
+MockIngestServer::MockIngestServer(uint16_t port, const MockIngestConfig& config)
+    : config_(config)
+    , rng_(config.seed)
+    , server_(port, [this](const HttpRequest& request) { return handle(request); }) {
+}
+
+HttpResponse MockIngestServer::handle(const HttpRequest& request) {
+    HttpResponse response;
+    if (request.method == "GET" && request.path == "/health") {
+        response.body = "{\"status\": \"ok\"}";
+        return response;
+    }
+    // Weaviate schema: classes exist once created, as on a fresh Weaviate
+    const std::string schema_prefix = "/v1/schema/";
+    if (request.method == "GET" && request.path.compare(0, schema_prefix.size(), schema_prefix) == 0) {
+        std::lock_guard<std::mutex> lock(rng_mutex_);
+        bool exists = classes_.count(request.path.substr(schema_prefix.size())) > 0;
+        response.status = exists ? 200 : 404;
+        response.body = exists ? "{}" : "";
+        return response;
+    }
+    if (request.method == "POST" && request.path == "/v1/schema") {
+        json definition = json::parse(request.body, nullptr, false);
+        if (definition.is_discarded() || !definition.contains("class")) {
+            response.status = 422;
+            response.body = "{\"error\": [{\"message\": \"class name required\"}]}";
+            return response;
+        }
+        std::lock_guard<std::mutex> lock(rng_mutex_);
+        classes_.insert(definition["class"].get<std::string>());
+        response.body = definition.dump();
+        return response;
+    }
+    bool ingest = request.path == "/ingest";
+    bool batch = request.path == "/v1/batch/objects";
+    bool embed = request.path == "/embed" && config_.embed_dim > 0;
+    if (request.method != "POST" || !(ingest || batch || embed)) {
+        response.status = request.method == "POST" ? 404 : 405;
+        response.body = "{\"error\": \"not found\"}";
+        return response;
+    }
+
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    body_bytes_.fetch_add(request.body.size(), std::memory_order_relaxed);
+
+    double delay;
+    bool fail;
+    int error_status;
+    {
+        std::lock_guard<std::mutex> lock(rng_mutex_);
+        delay = config_.latency.sample(rng_);
+        fail = std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < config_.error_rate;
+        error_status = config_.error_statuses[rng_() % config_.error_statuses.size()];
+    }
+    if (delay > 0.0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(delay));
+    }
+
+    if (fail) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        response.status = error_status;
+        response.body = "{\"error\": \"injected failure\"}";
+        return response;
+    }
+
+    // Same validation as app.py so malformed payloads still surface as client bugs
+    json payload = json::parse(request.body, nullptr, false);
+    if (payload.is_discarded() || !payload.is_object()) {
+        response.status = 400;
+        response.body = "{\"error\": \"JSON body required\"}";
+        return response;
+    }
+    if (batch) return handleBatch(payload);
+    if (embed) {
+        if (!payload.contains("texts") || !payload["texts"].is_array()) {
+            response.status = 400;
+            response.body = "{\"error\": \"texts list required\"}";
+            return response;
+        }
+        json embeddings = json::array();
+        for (const auto& text : payload["texts"]) {
+            embeddings.push_back(pseudoEmbedding(text.is_string() ? text.get<std::string>() : text.dump()));
+        }
+        response.body = json{{"embeddings", embeddings}}.dump();
+        return response;
+    }
+    if (!payload.contains("embedding") && payload.value("text", std::string()).empty()) {
+        response.status = 400;
+        response.body = "{\"error\": \"text required if no embedding provided\"}";
+        return response;
+    }
+
+    response.status = config_.ok_status;
+    if (payload.contains("embedding")) {
+        embedded_.fetch_add(1, std::memory_order_relaxed);
+    } else if (config_.embed_dim > 0 && payload.value("return_embedding", false)) {
+        response.body = json{{"status", "ok"}, {"embedding", pseudoEmbedding(payload.value("text", std::string()))}}.dump();
+        return response;
+    }
+    response.body = "{\"status\": \"ok\"}";
+    return response;
+}
+
+// Answers like Weaviate: 200 with one result per object, errors reported per object
+HttpResponse MockIngestServer::handleBatch(const json& payload) {
+    HttpResponse response;
+    if (!payload.contains("objects") || !payload["objects"].is_array()) {
+        response.status = 422;
+        response.body = "{\"error\": [{\"message\": \"objects list required\"}]}";
+        return response;
+    }
+    json results = json::array();
+    for (const auto& object : payload["objects"]) {
+        json result = {{"class", object.value("class", "")}, {"id", object.value("id", "")}};
+        const json* properties = object.contains("properties") ? &object["properties"] : nullptr;
+        if (!properties || !properties->contains("text")) {
+            result["result"] = {{"errors", {{"error", {{{"message", "text property required"}}}}}}};
+        } else {
+            result["result"] = json::object();
+            objects_.fetch_add(1, std::memory_order_relaxed);
+            if (object.contains("vector")) embedded_.fetch_add(1, std::memory_order_relaxed);
+        }
+        results.push_back(std::move(result));
+    }
+    response.body = results.dump();
+    return response;
+}
+
+// Deterministic per text, so a cached vector can be told apart from a wrong one
+std::vector<float> MockIngestServer::pseudoEmbedding(const std::string& text) const {
+    std::mt19937_64 text_rng(std::hash<std::string>()(text));
+    std::normal_distribution<float> normal;
+    std::vector<float> embedding(config_.embed_dim);
+    for (float& value : embedding) value = normal(text_rng);
+    return embedding;
+}
+
+} // namespace health_ingestion
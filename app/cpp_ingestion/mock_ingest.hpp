@@ -0,0 +1,84 @@
+#pragma once
+
+#include "http_server.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <nlohmann/json_fwd.hpp>
+
+namespace health_ingestion {
+
+// Server-side delay applied before answering each request
+struct LatencyModel {
+    enum class Kind { None, Fixed, Uniform, Exponential, LogNormal };
+
+    Kind kind = Kind::None;
+    double a = 0.0;   // Fixed: delay; Uniform: min; Exponential: mean; LogNormal: median (seconds)
+    double b = 0.0;   // Uniform: max; LogNormal: p99 (seconds)
+
+    // "fixed:5ms", "uniform:1ms:20ms", "exp:10ms", "lognormal:5ms:80ms" or "none"
+    static bool parse(const std::string& text, LatencyModel& model);
+
+    double sample(std::mt19937_64& rng) const;
+    std::string describe() const;
+};
+
+// Behaviour of the mock /ingest endpoint, parsed from a comma-separated spec such as
+// "latency=lognormal:5ms:80ms,error-rate=0.02,error-status=500/503,ok-status=201,embed-dim=384"
+struct MockIngestConfig {
+    LatencyModel latency;
+    double error_rate = 0.0;              // Fraction of requests answered with an error status
+    std::vector<int> error_statuses{500}; // Picked uniformly for injected errors
+    int ok_status = 201;                  // Same as the Flask API
+    size_t embed_dim = 0;                 // Return an N-float pseudo-embedding like app.py; 0 = none
+    uint64_t seed = 1;
+
+    static bool parse(const std::string& spec, MockIngestConfig& config);
+    std::string describe() const;
+};
+
+// Stand-in for the Flask vector API: accepts POST /ingest bodies and answers like app.py
+// after a sampled delay, without embedding or storing anything. Used to benchmark the
+// client side of the pipeline in isolation. It also answers Weaviate's /v1/schema and
+// /v1/batch/objects (for --output weaviate) and, with embed-dim, the API's /embed.
+class MockIngestServer {
+public:
+    MockIngestServer(uint16_t port, const MockIngestConfig& config);
+
+    bool start() { return server_.start(); }
+    void stop() { server_.stop(); }
+    uint16_t port() const { return server_.port(); }
+    std::string baseUrl() const { return "http://127.0.0.1:" + std::to_string(port()); }
+    std::string url() const { return baseUrl() + "/ingest"; }
+
+    uint64_t requests() const { return requests_.load(); }
+    uint64_t injectedErrors() const { return errors_.load(); }
+    uint64_t bodyBytes() const { return body_bytes_.load(); }
+    uint64_t embeddedRequests() const { return embedded_.load(); }  // Summaries that carried a vector
+    uint64_t batchObjects() const { return objects_.load(); }       // Accepted via /v1/batch/objects
+
+private:
+    HttpResponse handle(const HttpRequest& request);
+    HttpResponse handleBatch(const nlohmann::json& payload);
+    std::vector<float> pseudoEmbedding(const std::string& text) const;
+
+    MockIngestConfig config_;
+    std::mutex rng_mutex_;
+    std::mt19937_64 rng_;
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> body_bytes_{0};
+    std::atomic<uint64_t> embedded_{0};
+    std::atomic<uint64_t> objects_{0};
+    std::set<std::string> classes_;  // Weaviate classes created so far; guarded by rng_mutex_
+    HttpServer server_;
+};
+
+// Parses durations like "250us", "5ms", "1.5s" (bare numbers are milliseconds) into seconds
+bool parseDuration(const std::string& text, double& seconds);
+
+} // namespace health_ingestion
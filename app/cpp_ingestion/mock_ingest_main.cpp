@@ -0,0 +1,68 @@
+#include "mock_ingest.hpp"
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// Standalone mock of the vector API for driving other clients (e.g. the Python ingester)
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --port <port>   Listen port (default: 5000)\n"
+              << "  --spec <spec>   Behaviour, e.g. latency=lognormal:5ms:80ms,error-rate=0.01,\n"
+              << "                  error-status=500/503,ok-status=201,seed=7\n"
+              << "Latency models: none, fixed:<d>, uniform:<min>:<max>, exp:<mean>,\n"
+              << "                lognormal:<median>:<p99> (durations in us, ms or s)\n";
+}
+
+int main(int argc, char* argv[]) {
+    int port = 5000;
+    std::string spec;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+            if (port < 0 || port > 65535) {
+                std::cerr << "Error: Invalid --port value: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--spec" && i + 1 < argc) {
+            spec = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    health_ingestion::MockIngestConfig config;
+    if (!health_ingestion::MockIngestConfig::parse(spec, config)) {
+        std::cerr << "Error: Invalid --spec: " << spec << std::endl;
+        return 1;
+    }
+
+    // Serve until SIGINT/SIGTERM
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    health_ingestion::MockIngestServer server(static_cast<uint16_t>(port), config);
+    if (!server.start()) {
+        return 1;
+    }
+    std::cout << "Mock ingest server on " << server.url() << " (" << config.describe() << ")" << std::endl;
+
+    int received = 0;
+    sigwait(&signals, &received);
+    server.stop();
+
+    std::cout << "Served " << server.requests() << " requests (" << server.injectedErrors()
+              << " injected errors)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,446 @@
+#include "output_sink.hpp"
+#include "file_sink.hpp"
+#include "weaviate_sink.hpp"
+#include "health_processor.hpp"
+#include "task_scheduler.hpp"
+#include "metrics.hpp"
+#include "embedding_cache.hpp"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <stdexcept>
+#include <cstring>
+#include <curl/curl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+using namespace std::chrono;
+
+namespace health_ingestion {
+
+namespace {
+
+// Bytes the NDJSON sink buffers before one sequential write(2)
+constexpr size_t kFileWriteBytes = 4 << 20;
+
+// Live counters for the HTTP sink, exported on the --metrics-port status endpoint
+struct HttpMetrics {
+    Gauge& in_flight = metrics().gauge(
+        "health_ingest_http_requests_in_flight", "Requests to the vector API in progress");
+    Histogram& send_latency = metrics().histogram(
+        "health_ingest_send_seconds", "Latency of one summary send including retries", latencyBuckets());
+    Counter& retries = metrics().counter(
+        "health_ingest_http_retries_total", "Retried vector API requests");
+    Counter& failures = metrics().counter(
+        "health_ingest_http_failures_total", "Summaries that could not be delivered");
+};
+
+HttpMetrics& httpMetrics() {
+    static HttpMetrics instance;
+    return instance;
+}
+
+// CURL callback for HTTP responses
+size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
+    userp->append((char*)contents, size * nmemb);
+    return size * nmemb;
+}
+
+// Asks /ingest to send back the vector it computes, for the embedding cache
+void requestEmbedding(std::string& payload) {
+    payload.pop_back();
+    payload += ",\"return_embedding\":true}";
+}
+
+// /ingest payloads for a batch, built in parallel
+std::vector<std::string> serialise(const SummaryBatch& batch, TaskScheduler& scheduler, StageTimes& times) {
+    std::vector<std::string> payloads(batch.size());
+    std::vector<StageTimes> task_times(batch.size());
+    scheduler.parallelFor(batch.size(), [&](size_t i) {
+        ScopedStageTimer timer(task_times[i], Stage::Serialise);
+        const Summary& summary = batch[i];
+        payloads[i] = HealthDataProcessor::buildPayload(summary);
+    });
+    for (const auto& item_times : task_times) {
+        times.merge(item_times);
+    }
+    return payloads;
+}
+
+class HttpSink : public OutputSink {
+public:
+    HttpSink(const std::string& url, TaskScheduler& scheduler, EmbeddingCache* cache)
+        : url_(url), scheduler_(scheduler), cache_(cache) {}
+
+    size_t write(const SummaryBatch& batch, StageTimes& times) override {
+        // Serialise payloads in parallel, then send in order
+        std::vector<std::string> payloads = serialise(batch, scheduler_, times);
+        size_t success_count = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (cache_ && batch[i].embedding.empty()) requestEmbedding(payloads[i]);
+            ScopedStageTimer timer(times, Stage::Send);
+            if (send(batch[i], payloads[i])) {
+                success_count++;
+            }
+        }
+        return success_count;
+    }
+
+private:
+    bool send(const Summary& summary, const std::string& json_string);
+
+    std::string url_;
+    TaskScheduler& scheduler_;
+    EmbeddingCache* cache_;  // Optional
+};
+
+bool HttpSink::send(const Summary& summary, const std::string& json_string) {
+    const std::string& user_id = summary.user_id;
+    HttpMetrics& stats = httpMetrics();
+    auto send_start = steady_clock::now();
+
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        std::cerr << "Failed to initialize CURL for " << user_id << std::endl;
+        stats.failures.inc();
+        return false;
+    }
+
+    std::string response_string;
+
+    // Set CURL options with improved timeout and retry logic
+    curl_easy_setopt(curl, CURLOPT_URL, url_.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_string.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, json_string.length());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
+
+    // Improved timeout settings - wait longer for server response
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);           // Total timeout: 60 seconds
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);    // Connection timeout: 10 seconds
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 30L);    // Low speed timeout: 30 seconds
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 100L);  // Min 100 bytes/sec
+
+    // Enable verbose logging for debugging (optional)
+    // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+
+    // Set headers
+    struct curl_slist* headers = nullptr;
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = curl_slist_append(headers, "Accept: application/json");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+    // Perform request with retry logic
+    CURLcode res;
+    long response_code = 0;
+    int max_retries = 3;
+
+    stats.in_flight.add(1);
+    for (int attempt = 1; attempt <= max_retries; ++attempt) {
+        response_string.clear();
+        res = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+        if (res == CURLE_OK && (response_code == 200 || response_code == 201)) {
+            break; // Success!
+        }
+
+        if (attempt < max_retries) {
+            stats.retries.inc();
+            std::this_thread::sleep_for(std::chrono::milliseconds(500 * attempt)); // Exponential backoff
+            std::cout << "Retry " << attempt << "/" << max_retries << " for " << user_id
+                      << " (HTTP " << response_code << ")" << std::endl;
+        } else {
+            std::cerr << "Failed after " << max_retries << " attempts for " << user_id
+                      << " - CURL: " << curl_easy_strerror(res)
+                      << ", HTTP: " << response_code << std::endl;
+        }
+    }
+
+    stats.in_flight.add(-1);
+
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    // Check if we got a valid response (accept both 200 and 201)
+    bool success = (res == CURLE_OK && (response_code == 200 || response_code == 201));
+    bool delivered = false;
+    if (success && !response_string.empty()) {
+        // Parse response to verify it's valid JSON with "status": "ok"
+        try {
+            json response_json = json::parse(response_string);
+            delivered = response_json.contains("status") && response_json["status"] == "ok";
+            // Asked for, the API returns the vector it computed so the next run can send it instead
+            if (delivered && cache_ && summary.embedding.empty() && response_json.contains("embedding")) {
+                cache_->insert(hashText(summary.text), response_json["embedding"].get<std::vector<float>>());
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid response JSON for " << user_id << ": " << e.what() << std::endl;
+        }
+    }
+
+    stats.send_latency.observe(duration<double>(steady_clock::now() - send_start).count());
+    if (!delivered) stats.failures.inc();
+    return delivered;
+}
+
+// Dry run: one truncated line per summary, written to stdout once per batch
+class StdoutSink : public OutputSink {
+public:
+    size_t write(const SummaryBatch& batch, StageTimes&) override {
+        std::string out;
+        for (const Summary& summary : batch) {
+            out += "[" + summary.user_id + " - " + summary.date + "] " + summary.text.substr(0, 150) + "...\n";
+        }
+        std::cout << out << std::flush;
+        return batch.size();
+    }
+};
+
+// Appends payloads as NDJSON through large O_APPEND writes, so worker processes can share a file
+class NdjsonSink : public OutputSink {
+public:
+    NdjsonSink(const std::string& path, TaskScheduler& scheduler) : path_(path), scheduler_(scheduler) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+        }
+        buffer_.reserve(kFileWriteBytes + (1 << 16));
+    }
+
+    ~NdjsonSink() override {
+        finish();
+        ::close(fd_);
+    }
+
+    size_t write(const SummaryBatch& batch, StageTimes& times) override {
+        std::vector<std::string> payloads = serialise(batch, scheduler_, times);
+        ScopedStageTimer timer(times, Stage::Send);
+        for (const std::string& payload : payloads) {
+            buffer_ += payload;
+            buffer_ += '\n';
+        }
+        if (buffer_.size() >= kFileWriteBytes && !flushBuffer()) {
+            return 0;
+        }
+        return batch.size();
+    }
+
+    bool finish() override {
+        return flushBuffer() && ::fdatasync(fd_) == 0;
+    }
+
+private:
+    bool flushBuffer() {
+        size_t written = 0;
+        while (written < buffer_.size()) {
+            ssize_t n = ::write(fd_, buffer_.data() + written, buffer_.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Failed to write " << path_ << ": " << std::strerror(errno) << std::endl;
+                buffer_.clear();
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        buffer_.clear();
+        return true;
+    }
+
+    std::string path_;
+    TaskScheduler& scheduler_;
+    int fd_;
+    std::string buffer_;
+};
+
+// Builds payloads and drops them: everything but the I/O, for CPU benchmarks
+class NullSink : public OutputSink {
+public:
+    explicit NullSink(TaskScheduler& scheduler) : scheduler_(scheduler) {}
+
+    size_t write(const SummaryBatch& batch, StageTimes& times) override {
+        serialise(batch, scheduler_, times);
+        return batch.size();
+    }
+
+private:
+    TaskScheduler& scheduler_;
+};
+
+// Parses sizes like "1048576", "512K", "256M" or "2G"
+bool parseSize(const std::string& text, uint64_t& bytes) {
+    try {
+        size_t pos = 0;
+        unsigned long long value = std::stoull(text, &pos);
+        std::string suffix = text.substr(pos);
+        if (suffix == "K" || suffix == "k") value <<= 10;
+        else if (suffix == "M" || suffix == "m") value <<= 20;
+        else if (suffix == "G" || suffix == "g") value <<= 30;
+        else if (!suffix.empty()) return false;
+        bytes = value;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Applies the ",key=value" options of a files: spec
+bool parseFileOptions(const std::string& options, OutputConfig& config) {
+    size_t pos = 0;
+    while (pos < options.size()) {
+        size_t end = options.find(',', pos);
+        if (end == std::string::npos) end = options.size();
+        std::string item = options.substr(pos, end - pos);
+        pos = end + 1;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        try {
+            if (key == "shards") {
+                config.shards = std::stoul(value);
+                if (config.shards == 0) return false;
+            } else if (key == "roll") {
+                if (!parseSize(value, config.roll_bytes) || config.roll_bytes == 0) return false;
+            } else if (key == "level") {
+                config.compression_level = std::stoi(value);
+                if (config.compression_level < 0 || config.compression_level > 9) return false;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Applies the ",key=value" options of a weaviate: spec
+bool parseWeaviateOptions(const std::string& options, OutputConfig& config) {
+    size_t pos = 0;
+    while (pos < options.size()) {
+        size_t end = options.find(',', pos);
+        if (end == std::string::npos) end = options.size();
+        std::string item = options.substr(pos, end - pos);
+        pos = end + 1;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        try {
+            if (key == "batch") {
+                config.weaviate_batch = std::stoul(value);
+                if (config.weaviate_batch == 0) return false;
+            } else if (key == "class") {
+                if (value.empty()) return false;
+                config.weaviate_class = value;
+            } else if (key == "embed") {
+                config.embed_url = value;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool OutputConfig::parse(const std::string& spec, OutputConfig& config) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string target = colon == std::string::npos ? "" : spec.substr(colon + 1);
+
+    if (kind == "http") {
+        config.kind = Kind::Http;
+    } else if (kind == "stdout" && target.empty()) {
+        config.kind = Kind::Stdout;
+    } else if (kind == "ndjson" && !target.empty()) {
+        config.kind = Kind::Ndjson;
+    } else if (kind == "files" && !target.empty()) {
+        config.kind = Kind::Files;
+        size_t comma = target.find(',');
+        if (comma != std::string::npos) {
+            if (!parseFileOptions(target.substr(comma + 1), config)) return false;
+            target = target.substr(0, comma);
+        }
+        if (target.empty()) return false;
+    } else if (kind == "weaviate") {
+        config.kind = Kind::Weaviate;
+        size_t comma = target.find(',');
+        if (comma != std::string::npos) {
+            if (!parseWeaviateOptions(target.substr(comma + 1), config)) return false;
+            target = target.substr(0, comma);
+        }
+    } else if (kind == "null" && target.empty()) {
+        config.kind = Kind::Null;
+    } else {
+        return false;
+    }
+    config.target = target;
+    return true;
+}
+
+std::string OutputConfig::describe() const {
+    switch (kind) {
+        case Kind::Http: return "HTTP " + target;
+        case Kind::Stdout: return "stdout";
+        case Kind::Ndjson: return "NDJSON file " + target;
+        case Kind::Files:
+            return std::to_string(shards) + " rolling " + (compression_level > 0 ? "gzip " : "") +
+                   "NDJSON streams in " + target;
+        case Kind::Weaviate:
+            return "Weaviate " + target + "/v1/batch/objects (class " + weaviate_class + ", " +
+                   std::to_string(weaviate_batch) + " objects per request" +
+                   (embed_url.empty() ? "" : ", vectors from " + embed_url) + ")";
+        case Kind::Null: return "null";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<OutputSink> makeOutputSink(const OutputConfig& config, TaskScheduler& scheduler,
+                                           EmbeddingCache* cache) {
+    switch (config.kind) {
+        case OutputConfig::Kind::Http: return std::make_unique<HttpSink>(config.target, scheduler, cache);
+        case OutputConfig::Kind::Stdout: return std::make_unique<StdoutSink>();
+        case OutputConfig::Kind::Ndjson: return std::make_unique<NdjsonSink>(config.target, scheduler);
+        case OutputConfig::Kind::Files: {
+            FileSinkOptions options;
+            options.dir = config.target;
+            options.shards = config.shards;
+            options.roll_bytes = config.roll_bytes;
+            options.compression_level = config.compression_level;
+            return std::make_unique<ShardedFileSink>(options, scheduler);
+        }
+        case OutputConfig::Kind::Weaviate: {
+            WeaviateSinkOptions options;
+            options.url = config.target;
+            options.class_name = config.weaviate_class;
+            options.batch = config.weaviate_batch;
+            options.embed_url = config.embed_url;
+            return std::make_unique<WeaviateSink>(options, scheduler, cache);
+        }
+        case OutputConfig::Kind::Null: return std::make_unique<NullSink>(scheduler);
+    }
+    return nullptr;
+}
+
+DeliveryStats deliveryStats() {
+    HttpMetrics& stats = httpMetrics();
+    DeliveryStats result;
+    result.sent = stats.send_latency.count();
+    result.failed = stats.failures.value();
+    result.retries = stats.retries.value();
+    result.send_seconds = stats.send_latency.sum();
+    result.p50 = stats.send_latency.quantile(0.50);
+    result.p95 = stats.send_latency.quantile(0.95);
+    result.p99 = stats.send_latency.quantile(0.99);
+    return result;
+}
+
+} // namespace health_ingestion
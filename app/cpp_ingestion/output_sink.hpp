@@ -0,0 +1,82 @@
+#pragma once
+
+#include "daily_totals.hpp"
+#include "stage_profile.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace health_ingestion {
+
+class TaskScheduler;
+class EmbeddingCache;
+
+// One rendered daily summary
+struct Summary {
+    std::string user_id;
+    std::string date;
+    std::string text;
+    std::vector<float> embedding;  // Empty unless an embedding model is loaded
+    DailyTotals totals;
+};
+
+using SummaryBatch = std::vector<Summary>;
+
+// Where summaries go, parsed once from --output (or API_URL) at startup:
+//   http[:<url>]   POST each summary to the vector API (default)
+//   stdout         Print a truncated line per summary (the old PRINT_MODE)
+//   ndjson:<path>  Append /ingest payloads, one per line, for bulk loading
+//   files:<dir>[,shards=N][,roll=SIZE][,level=L]
+//                  Sharded, rolling, gzip-compressed NDJSON files for bulk import
+//   weaviate[:<url>][,batch=N][,class=C][,embed=<url>]
+//                  Batch objects straight into Weaviate's /v1/batch/objects
+//   null           Build payloads and discard them, for CPU-only benchmarks
+struct OutputConfig {
+    enum class Kind { Http, Stdout, Ndjson, Files, Weaviate, Null };
+
+    Kind kind = Kind::Http;
+    std::string target;  // URL, file path or directory
+
+    // Files only
+    size_t shards = 4;
+    uint64_t roll_bytes = 256ull << 20;
+    int compression_level = 6;  // 0 = uncompressed
+
+    // Weaviate only
+    size_t weaviate_batch = 500;
+    std::string weaviate_class = "Sentence";
+    std::string embed_url{};    // API /embed endpoint for summaries without a vector
+
+    static bool parse(const std::string& spec, OutputConfig& config);
+    std::string describe() const;
+};
+
+// Destination for batches of summaries. A sink is created once per process, after any
+// fork(), and sees every batch of the run in order; finish() is called before the run
+// reports completion so buffered output is durable by then.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    // Returns the number of summaries delivered; stage times go to `times`
+    virtual size_t write(const SummaryBatch& batch, StageTimes& times) = 0;
+    virtual bool finish() { return true; }
+};
+
+// With a cache, the HTTP sink stores vectors the API returns for summaries sent without one
+std::unique_ptr<OutputSink> makeOutputSink(const OutputConfig& config, TaskScheduler& scheduler,
+                                           EmbeddingCache* cache = nullptr);
+
+// Client-side delivery figures for the vector API, from the live metrics
+struct DeliveryStats {
+    uint64_t sent = 0;        // Summaries handed to the HTTP sink
+    uint64_t failed = 0;
+    uint64_t retries = 0;
+    double send_seconds = 0;  // Summed send latency, including retries and backoff
+    double p50 = 0, p95 = 0, p99 = 0;
+};
+
+DeliveryStats deliveryStats();
+
+} // namespace health_ingestion
@@ -0,0 +1,201 @@
+#include "product_quantizer.hpp"
+#include "task_scheduler.hpp"
+#include "vector_scan.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace health_ingestion {
+
+ProductQuantizer::ProductQuantizer(size_t dimension, size_t subspaces)
+    : dimension_(dimension)
+    , subspaces_(subspaces)
+    , sub_dimension_(subspaces > 0 ? dimension / subspaces : 0)
+    , centroids_(dimension * kCentroids, 0.0f)
+    , norms_(subspaces * kCentroids, 0.0f) {
+    if (subspaces == 0 || dimension % subspaces != 0) {
+        throw std::invalid_argument("PQ subspaces must divide the dimension " + std::to_string(dimension));
+    }
+}
+
+uint8_t ProductQuantizer::nearest(size_t s, const float* x) const {
+    // |x - c|^2 = |x|^2 - 2 x.c + |c|^2, and |x|^2 is the same for every centroid
+    const float* centroids = centroids_.data() + s * sub_dimension_ * kCentroids;
+    const float* norms = norms_.data() + s * kCentroids;
+#if defined(__AVX512F__)
+    // 16 centroids per register with a running minimum per lane, so nothing leaves registers
+    __m512 best = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    __m512i best_index = _mm512_setzero_si512();
+    __m512i index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i step = _mm512_set1_epi32(16);
+    for (size_t block = 0; block < kCentroids; block += 16) {
+        __m512 distance = _mm512_loadu_ps(norms + block);
+        for (size_t d = 0; d < sub_dimension_; ++d) {
+            distance = _mm512_fmadd_ps(_mm512_set1_ps(-2.0f * x[d]),
+                                       _mm512_loadu_ps(centroids + d * kCentroids + block), distance);
+        }
+        __mmask16 closer = _mm512_cmp_ps_mask(distance, best, _CMP_LT_OQ);
+        best = _mm512_mask_mov_ps(best, closer, distance);
+        best_index = _mm512_mask_mov_epi32(best_index, closer, index);
+        index = _mm512_add_epi32(index, step);
+    }
+    __mmask16 winners = _mm512_cmp_ps_mask(best, _mm512_set1_ps(_mm512_reduce_min_ps(best)), _CMP_EQ_OQ);
+    alignas(64) uint32_t indices[16];
+    _mm512_store_si512(indices, best_index);
+    return static_cast<uint8_t>(indices[__builtin_ctz(winners)]);
+#else
+    float distances[kCentroids];
+    std::copy(norms, norms + kCentroids, distances);
+    for (size_t d = 0; d < sub_dimension_; ++d) {
+        const float weight = -2.0f * x[d];
+        const float* row = centroids + d * kCentroids;
+        for (size_t c = 0; c < kCentroids; ++c) distances[c] += weight * row[c];
+    }
+    return static_cast<uint8_t>(std::min_element(distances, distances + kCentroids) - distances);
+#endif
+}
+
+void ProductQuantizer::train(const float* vectors, size_t count, TaskScheduler& scheduler, size_t iterations,
+                             size_t max_samples, uint64_t seed) {
+    if (count == 0) return;
+    std::mt19937_64 rng(seed);
+    std::vector<size_t> samples(count);
+    std::iota(samples.begin(), samples.end(), 0);
+    if (count > max_samples) {
+        std::shuffle(samples.begin(), samples.end(), rng);
+        samples.resize(max_samples);
+    }
+    const size_t n = samples.size();
+
+    // Subspaces are independent k-means problems, one task each
+    scheduler.parallelFor(subspaces_, [&](size_t s) {
+        std::mt19937_64 local_rng(seed + s + 1);
+        std::vector<float> slices(n * sub_dimension_);
+        for (size_t i = 0; i < n; ++i) {
+            std::copy_n(vectors + samples[i] * dimension_ + s * sub_dimension_, sub_dimension_,
+                        slices.data() + i * sub_dimension_);
+        }
+        float* centroids = centroids_.data() + s * sub_dimension_ * kCentroids;
+        float* norms = norms_.data() + s * kCentroids;
+        auto setCentroid = [&](size_t c, const float* x) {
+            float norm = 0.0f;
+            for (size_t d = 0; d < sub_dimension_; ++d) {
+                centroids[d * kCentroids + c] = x[d];
+                norm += x[d] * x[d];
+            }
+            norms[c] = norm;
+        };
+
+        // Start from distinct random samples (repeated when there are fewer than 256)
+        std::vector<size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), local_rng);
+        for (size_t c = 0; c < kCentroids; ++c) setCentroid(c, slices.data() + order[c % n] * sub_dimension_);
+
+        std::vector<float> sums(kCentroids * sub_dimension_);
+        std::vector<size_t> sizes(kCentroids);
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+        for (size_t iteration = 0; iteration < iterations; ++iteration) {
+            std::fill(sums.begin(), sums.end(), 0.0f);
+            std::fill(sizes.begin(), sizes.end(), 0);
+            for (size_t i = 0; i < n; ++i) {
+                const float* x = slices.data() + i * sub_dimension_;
+                uint8_t c = nearest(s, x);
+                ++sizes[c];
+                for (size_t d = 0; d < sub_dimension_; ++d) sums[c * sub_dimension_ + d] += x[d];
+            }
+            for (size_t c = 0; c < kCentroids; ++c) {
+                if (sizes[c] == 0) {
+                    // Re-seed an empty cluster on a random sample
+                    setCentroid(c, slices.data() + pick(local_rng) * sub_dimension_);
+                    continue;
+                }
+                float* mean = sums.data() + c * sub_dimension_;
+                for (size_t d = 0; d < sub_dimension_; ++d) mean[d] /= static_cast<float>(sizes[c]);
+                setCentroid(c, mean);
+            }
+        }
+    });
+}
+
+void ProductQuantizer::encode(const float* vector, uint8_t* code) const {
+    for (size_t s = 0; s < subspaces_; ++s) {
+        code[s] = nearest(s, vector + s * sub_dimension_);
+    }
+}
+
+std::vector<uint8_t> ProductQuantizer::encodeAll(const float* vectors, size_t count, TaskScheduler& scheduler) const {
+    std::vector<uint8_t> codes(count * subspaces_);
+    constexpr size_t kChunk = 1024;
+    scheduler.parallelFor((count + kChunk - 1) / kChunk, [&](size_t chunk) {
+        size_t end = std::min(count, (chunk + 1) * kChunk);
+        for (size_t i = chunk * kChunk; i < end; ++i) {
+            encode(vectors + i * dimension_, codes.data() + i * subspaces_);
+        }
+    });
+    return codes;
+}
+
+void ProductQuantizer::lookupTable(const float* query, float* table) const {
+    for (size_t s = 0; s < subspaces_; ++s) {
+        const float* centroids = centroids_.data() + s * sub_dimension_ * kCentroids;
+        float* row = table + s * kCentroids;
+        std::fill(row, row + kCentroids, 0.0f);
+        for (size_t d = 0; d < sub_dimension_; ++d) {
+            const float weight = query[s * sub_dimension_ + d];
+            const float* centroid_row = centroids + d * kCentroids;
+            for (size_t c = 0; c < kCentroids; ++c) row[c] += weight * centroid_row[c];
+        }
+    }
+}
+
+float ProductQuantizer::score(const float* table, const uint8_t* code) const {
+    size_t s = 0;
+    float sum = 0.0f;
+#if defined(__AVX512F__)
+    // 16 subspaces per step: widen 16 code bytes to table offsets and gather the entries
+    const __m512i lanes = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                             _mm512_set1_epi32(static_cast<int>(kCentroids)));
+    __m512 acc = _mm512_setzero_ps();
+    for (; s + 16 <= subspaces_; s += 16) {
+        __m512i index = _mm512_add_epi32(
+            _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(code + s))), lanes);
+        acc = _mm512_add_ps(acc, _mm512_i32gather_ps(index, table + s * kCentroids, 4));
+    }
+    sum = _mm512_reduce_add_ps(acc);
+#elif defined(__AVX2__)
+    const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                             _mm256_set1_epi32(static_cast<int>(kCentroids)));
+    __m256 acc = _mm256_setzero_ps();
+    for (; s + 8 <= subspaces_; s += 8) {
+        __m256i index = _mm256_add_epi32(
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(code + s))), lanes);
+        acc = _mm256_add_ps(acc, _mm256_i32gather_ps(table + s * kCentroids, index, 4));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    sum = _mm_cvtss_f32(_mm_add_ss(half, _mm_movehdup_ps(half)));
+#endif
+    for (; s < subspaces_; ++s) sum += table[s * kCentroids + code[s]];
+    return sum;
+}
+
+std::vector<Neighbor> scanTopK(const ProductQuantizer& quantizer, const uint8_t* codes, uint32_t begin,
+                               uint32_t end, const float* query, size_t k) {
+    std::vector<float> table(quantizer.codeSize() * ProductQuantizer::kCentroids);
+    quantizer.lookupTable(query, table.data());
+    const size_t code_size = quantizer.codeSize();
+    TopK top(k);
+    for (uint32_t r = begin; r < end; ++r) {
+        float distance = 1.0f - quantizer.score(table.data(), codes + static_cast<size_t>(r) * code_size);
+        if (distance < top.bound()) top.push(distance, r);
+    }
+    return top.take();
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "hnsw_index.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace health_ingestion {
+
+class TaskScheduler;
+
+// Product quantisation (Jégou et al.): each vector is cut into `subspaces` equal slices
+// and every slice is replaced by the index of its nearest of 256 learned centroids, so
+// a 384-d float32 vector (1536 bytes) becomes `subspaces` bytes.
+//
+// Queries are not quantised. Asymmetric distance computation builds a [subspaces][256]
+// table of query-slice x centroid dot products once per query, after which scoring a
+// code is `subspaces` table lookups and adds.
+class ProductQuantizer {
+public:
+    static constexpr size_t kCentroids = 256;
+
+    // dimension must be a multiple of subspaces
+    ProductQuantizer(size_t dimension, size_t subspaces);
+
+    // k-means per subspace (in parallel) on up to max_samples of the `count` vectors;
+    // 64 samples per centroid is about where more data stops improving the codebooks
+    void train(const float* vectors, size_t count, TaskScheduler& scheduler, size_t iterations = 20,
+               size_t max_samples = 16384, uint64_t seed = 42);
+
+    void encode(const float* vector, uint8_t* code) const;
+    // Encodes `count` row-major vectors into count * codeSize() bytes
+    std::vector<uint8_t> encodeAll(const float* vectors, size_t count, TaskScheduler& scheduler) const;
+
+    // Dot products of each query slice with each centroid, [subspaces][kCentroids]
+    void lookupTable(const float* query, float* table) const;
+    // Approximate dot product of the query behind `table` with the encoded vector
+    float score(const float* table, const uint8_t* code) const;
+
+    size_t dimension() const { return dimension_; }
+    size_t codeSize() const { return subspaces_; }
+
+private:
+    // Nearest centroid of subspace s to the slice x
+    uint8_t nearest(size_t s, const float* x) const;
+
+    size_t dimension_;
+    size_t subspaces_;
+    size_t sub_dimension_;
+    // [subspaces][sub_dimension][kCentroids]: centroid-major rows, so distances to all
+    // 256 centroids and table entries are computed with contiguous, vectorisable loops
+    std::vector<float> centroids_;
+    std::vector<float> norms_;      // [subspaces][kCentroids] squared centroid lengths
+};
+
+// Top-k by approximate (ADC) cosine distance over rows [begin, end); `codes` holds
+// codeSize() bytes per row and the query must be unit length
+std::vector<Neighbor> scanTopK(const ProductQuantizer& quantizer, const uint8_t* codes, uint32_t begin,
+                               uint32_t end, const float* query, size_t k);
+
+} // namespace health_ingestion
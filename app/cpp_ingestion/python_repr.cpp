@@ -0,0 +1,64 @@
+#include "python_repr.hpp"
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+namespace health_ingestion {
+
+std::string pythonRepr(const std::string& value) {
+    char quote = value.find('\'') != std::string::npos && value.find('"') == std::string::npos ? '"' : '\'';
+    std::string out(1, quote);
+    for (unsigned char c : value) {
+        if (c == '\\' || c == static_cast<unsigned char>(quote)) {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (c < 0x20 || c == 0x7F) {
+            char escaped[5];
+            std::snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += quote;
+    return out;
+}
+
+std::string pythonRepr(const nlohmann::json& value) {
+    switch (value.type()) {
+    case nlohmann::json::value_t::string:
+        return pythonRepr(value.get_ref<const std::string&>());
+    case nlohmann::json::value_t::boolean:
+        return value.get<bool>() ? "True" : "False";
+    case nlohmann::json::value_t::null:
+        return "None";
+    case nlohmann::json::value_t::object: {
+        std::string out = "{";
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            if (out.size() > 1) out += ", ";
+            out += pythonRepr(it.key());
+            out += ": ";
+            out += pythonRepr(it.value());
+        }
+        return out + "}";
+    }
+    case nlohmann::json::value_t::array: {
+        std::string out = "[";
+        for (const auto& item : value) {
+            if (out.size() > 1) out += ", ";
+            out += pythonRepr(item);
+        }
+        return out + "]";
+    }
+    default:
+        // Numbers: json's shortest round-trip form is what Python prints too
+        return value.dump();
+    }
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <nlohmann/json_fwd.hpp>
+
+namespace health_ingestion {
+
+// Python repr() of a parsed JSON value: the text app.py stores as `meta` via
+// str(request.json["meta"]). Object keys come out in nlohmann's sorted order, which is
+// also the order this client's payloads put them in, so the strings match byte for byte.
+std::string pythonRepr(const nlohmann::json& value);
+
+// Python repr() of a str
+std::string pythonRepr(const std::string& value);
+
+} // namespace health_ingestion
@@ -0,0 +1,131 @@
+#include "query_cache.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace health_ingestion {
+
+std::string normaliseQueryText(const std::string& text) {
+    std::string normalised;
+    normalised.reserve(text.size());
+    bool space = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) {
+            space = !normalised.empty();
+            continue;
+        }
+        if (space) normalised += ' ';
+        space = false;
+        normalised += static_cast<char>(c < 0x80 ? std::tolower(c) : c);
+    }
+    while (!normalised.empty() && std::strchr("?!.,;: ", normalised.back())) normalised.pop_back();
+    return normalised;
+}
+
+QueryCache::FrequencySketch::FrequencySketch(size_t capacity)
+    : sample_size_(10 * std::max<size_t>(capacity, 1)) {
+    size_t width = 64;
+    while (width < capacity) width <<= 1;
+    counters_.assign(4 * width, 0);
+    mask_ = width - 1;
+}
+
+size_t QueryCache::FrequencySketch::slot(const TextHash& key, size_t row) const {
+    // Double hashing over the two independent halves of the 128-bit key
+    uint64_t hash = key.lo + (row + 1) * key.hi;
+    hash ^= hash >> 32;
+    return row * (mask_ + 1) + (hash & mask_);
+}
+
+void QueryCache::FrequencySketch::increment(const TextHash& key) {
+    for (size_t row = 0; row < 4; ++row) {
+        uint8_t& counter = counters_[slot(key, row)];
+        if (counter < 15) ++counter;
+    }
+    if (++additions_ >= sample_size_) {
+        for (uint8_t& counter : counters_) counter >>= 1;
+        additions_ /= 2;
+    }
+}
+
+uint32_t QueryCache::FrequencySketch::estimate(const TextHash& key) const {
+    uint32_t count = 15;
+    for (size_t row = 0; row < 4; ++row) count = std::min<uint32_t>(count, counters_[slot(key, row)]);
+    return count;
+}
+
+QueryCache::QueryCache(size_t capacity, bool admission)
+    : capacity_(capacity)
+    , window_capacity_(admission ? std::max<size_t>(capacity / 100, 1) : capacity)
+    , protected_capacity_((capacity - std::min(capacity, window_capacity_)) * 4 / 5)
+    , sketch_(capacity) {
+    entries_.reserve(capacity);
+}
+
+size_t QueryCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void QueryCache::moveTo(Entry& entry, Segment segment) {
+    std::list<TextHash>& target = segments_[segment];
+    target.splice(target.begin(), segments_[entry.segment], entry.position);
+    entry.segment = segment;
+}
+
+void QueryCache::evict(const TextHash& key) {
+    auto found = entries_.find(key);
+    segments_[found->second.segment].erase(found->second.position);
+    entries_.erase(found);
+}
+
+bool QueryCache::get(const TextHash& key, std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sketch_.increment(key);
+    auto found = entries_.find(key);
+    if (found == entries_.end()) return false;
+    Entry& entry = found->second;
+    // A second hit in probation earns a protected slot; protected overflow is demoted
+    moveTo(entry, entry.segment == Window ? Window : Protected);
+    if (segments_[Protected].size() > protected_capacity_) {
+        moveTo(entries_.find(segments_[Protected].back())->second, Probation);
+    }
+    value = entry.value;
+    return true;
+}
+
+void QueryCache::put(const TextHash& key, std::string value) {
+    if (capacity_ == 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+        found->second.value = std::move(value);
+        return;
+    }
+    std::list<TextHash>& window = segments_[Window];
+    window.push_front(key);
+    entries_.emplace(key, Entry{std::move(value), Window, window.begin()});
+    if (window.size() > window_capacity_) admitFromWindow();
+}
+
+void QueryCache::admitFromWindow() {
+    const TextHash candidate = segments_[Window].back();
+    const size_t main_capacity = capacity_ - window_capacity_;
+    if (main_capacity == 0) {
+        evict(candidate);
+        return;
+    }
+    if (segments_[Probation].size() + segments_[Protected].size() >= main_capacity) {
+        // Main region full: the candidate must be more popular than the entry it replaces
+        const std::list<TextHash>& victims = segments_[Probation].empty() ? segments_[Protected] : segments_[Probation];
+        const TextHash victim = victims.back();
+        if (sketch_.estimate(candidate) <= sketch_.estimate(victim)) {
+            evict(candidate);
+            return;
+        }
+        evict(victim);
+    }
+    moveTo(entries_.find(candidate)->second, Probation);
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "embedding_cache.hpp"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace health_ingestion {
+
+// Query text as a cache key: ASCII lower-cased, trimmed, whitespace runs collapsed and
+// trailing punctuation dropped, so "How did I sleep? " and "how did i sleep" share one
+std::string normaliseQueryText(const std::string& text);
+
+// Bounded map from a query key to its serialised response, for the repeated questions
+// that workflows send to /query.
+//
+// Eviction is W-TinyLFU (Einziger et al.). New entries enter an LRU window of 1% of the
+// capacity. An entry leaving the window displaces the main region's least recently used
+// entry only if a count-min sketch of recent key frequencies says it is requested more
+// often, so a burst of one-off queries cannot flush the regulars as it would under
+// plain LRU. The main region is segmented: an entry hit again moves from probation to
+// a protected segment (80% of the main region).
+//
+// Thread-safe; one mutex covers each lookup or insert.
+class QueryCache {
+public:
+    // With admission off the window spans the whole cache, i.e. plain LRU
+    explicit QueryCache(size_t capacity, bool admission = true);
+
+    bool get(const TextHash& key, std::string& value);
+    void put(const TextHash& key, std::string value);
+
+    size_t size() const;
+    size_t capacity() const { return capacity_; }
+
+private:
+    enum Segment { Window, Probation, Protected };
+
+    struct KeyHash {
+        size_t operator()(const TextHash& key) const { return static_cast<size_t>(key.lo); }
+    };
+    struct KeyEqual {
+        bool operator()(const TextHash& a, const TextHash& b) const { return a.lo == b.lo && a.hi == b.hi; }
+    };
+    struct Entry {
+        std::string value;
+        Segment segment;
+        std::list<TextHash>::iterator position;
+    };
+
+    // Counters saturating at 15 in four hashed rows, the minimum being the estimate. All
+    // counts are halved every 10 * capacity increments so it follows recent traffic.
+    class FrequencySketch {
+    public:
+        explicit FrequencySketch(size_t capacity);
+        void increment(const TextHash& key);
+        uint32_t estimate(const TextHash& key) const;
+
+    private:
+        size_t slot(const TextHash& key, size_t row) const;
+
+        std::vector<uint8_t> counters_;  // [4][width]
+        size_t mask_;
+        size_t additions_ = 0;
+        size_t sample_size_;
+    };
+
+    void moveTo(Entry& entry, Segment segment);
+    void evict(const TextHash& key);
+    // Moves the window's oldest entry into the main region, or drops it
+    void admitFromWindow();
+
+    size_t capacity_;
+    size_t window_capacity_;
+    size_t protected_capacity_;
+    std::unordered_map<TextHash, Entry, KeyHash, KeyEqual> entries_;
+    std::list<TextHash> segments_[3];  // Most recently used first
+    FrequencySketch sketch_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace health_ingestion
@@ -0,0 +1,476 @@
+#include "query_service.hpp"
+#include "embedding_model.hpp"
+#include "product_quantizer.hpp"
+#include "query_cache.hpp"
+#include "task_scheduler.hpp"
+#include "vector_scan.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+// Serves /query over the summaries an ingestion run wrote, from an in-memory HNSW
+// index, as a stand-in for the Weaviate-backed api/app.py
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <summaries>...\n"
+              << "  <summaries>             --output ndjson files (.gz or plain), files:<dir> shard\n"
+              << "                          directories, or Weaviate object exports, one JSON per line\n"
+              << "  --port <port>           HTTP port for /query, /health and /metrics (default: 5001)\n"
+              << "  --ef <n>                Default search candidate list size (default: 64)\n"
+              << "  --M <n>                 Graph links per node; 2*M on the base layer (default: 16)\n"
+              << "  --ef-construction <n>   Candidate list size while building (default: 200)\n"
+              << "  --threads <n>           Load/build threads (default: CPU count)\n"
+              << "  --embed-model <dir>     Model from export_minilm.py, for text queries and for\n"
+              << "                          input lines without a vector\n"
+              << "  --scan <f32|int8|pq[:m]> Storage read by the per-user scan behind user_id queries;\n"
+              << "                          int8 and pq (m-byte codes, default dimension/8) re-rank\n"
+              << "                          their candidates in f32 (default: f32)\n"
+              << "  --cache <n>             Responses kept in the /query result cache, 0 to disable\n"
+              << "                          (default: 10000)\n"
+              << "  --cache-buckets         Also key cached responses by the int8-quantised query\n"
+              << "                          vector, so near-identical embeddings share an entry\n"
+              << "  --eval <n>              Measure recall@10 and latency against exact search with\n"
+              << "                          n perturbed self-queries per ef, and of per-user queries\n"
+              << "                          by scan versus graph search and with date ranges, and the\n"
+              << "                          result cache's hit rate and latency, then exit\n";
+}
+
+// Recall@10 and single-thread latency for a range of ef, against brute force
+static void evaluate(const health_ingestion::HnswIndex& index, size_t queries) {
+    if (index.size() == 0) return;
+    constexpr size_t k = 10;
+    const size_t dimension = index.dimension();
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(index.size() - 1));
+    // Noise of about a third of the vector's length, so the query is near, not on, a summary
+    std::normal_distribution<float> noise(0.0f, 0.35f / std::sqrt(static_cast<float>(dimension)));
+
+    std::vector<std::vector<float>> sample(queries);
+    for (auto& query : sample) {
+        const float* base = index.vector(pick(rng));
+        query.assign(base, base + dimension);
+        for (float& value : query) value += noise(rng);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::vector<health_ingestion::Neighbor>> truth(queries);
+    auto exact_start = Clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+        truth[q] = index.exactSearch(sample[q].data(), k);
+    }
+    double exact_us = std::chrono::duration<double, std::micro>(Clock::now() - exact_start).count() / queries;
+
+    std::cout << "\n=== Recall@" << k << " over " << queries << " queries (" << index.size() << " vectors, "
+              << dimension << "-d) ===" << std::endl;
+    std::cout << "exact     recall 1.0000  mean " << exact_us << " us" << std::endl;
+    for (size_t ef : {10, 16, 32, 64, 128, 256}) {
+        std::vector<double> latencies(queries);
+        size_t found = 0;
+        for (size_t q = 0; q < queries; ++q) {
+            auto start = Clock::now();
+            auto hits = index.search(sample[q].data(), k, ef);
+            latencies[q] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            // Summaries with identical text share a vector, so a hit counts when it is as close
+            // as the k-th true neighbour rather than only when the ids match
+            float bound = truth[q].back().distance + 1e-6f;
+            for (const auto& hit : hits) found += hit.distance <= bound;
+        }
+        double total = 0;
+        for (double latency : latencies) total += latency;
+        std::sort(latencies.begin(), latencies.end());
+        double recall = static_cast<double>(found) / (queries * std::min(k, index.size()));
+        std::cout << "ef=" << ef << (ef < 100 ? (ef < 10 ? "     " : "    ") : "   ") << "recall " << std::fixed
+                  << std::setprecision(4) << recall << std::defaultfloat << std::setprecision(6) << "  mean "
+                  << total / queries << " us  p99 " << latencies[latencies.size() * 99 / 100] << " us  ("
+                  << exact_us / (total / queries) << "x exact)" << std::endl;
+    }
+}
+
+// Per-user top-10: the SIMD scans (f32, int8 and PQ, raw and re-ranked) against a scalar
+// loop and against graph search with the other users' hits filtered out afterwards
+static void evaluateFiltered(const health_ingestion::QueryService& service, size_t pq_subspaces,
+                             health_ingestion::TaskScheduler& scheduler, size_t queries) {
+    using health_ingestion::Neighbor;
+    using RowRange = health_ingestion::QueryService::RowRange;
+    constexpr size_t k = 10;
+    const health_ingestion::HnswIndex& index = service.index();
+    const size_t dimension = index.dimension();
+    std::vector<RowRange> users;
+    for (const auto& entry : service.userIndex().users()) users.push_back(entry.second);
+    if (users.empty()) return;
+    std::sort(users.begin(), users.end());
+
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<size_t> pick_user(0, users.size() - 1);
+    std::normal_distribution<float> noise(0.0f, 0.35f / std::sqrt(static_cast<float>(dimension)));
+    std::vector<std::vector<float>> sample(queries);
+    std::vector<RowRange> ranges(queries);
+    size_t scanned = 0;
+    for (size_t q = 0; q < queries; ++q) {
+        ranges[q] = users[pick_user(rng)];
+        scanned += ranges[q].second - ranges[q].first;
+        std::uniform_int_distribution<uint32_t> pick_row(ranges[q].first, ranges[q].second - 1);
+        const float* base = index.vector(pick_row(rng));
+        sample[q].assign(base, base + dimension);
+        for (float& value : sample[q]) value += noise(rng);
+        health_ingestion::normaliseVector(sample[q].data(), dimension);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    // Plain scalar scan; also the ground truth
+    std::vector<std::vector<Neighbor>> truth(queries);
+    auto scalar_start = Clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+        health_ingestion::TopK top(k);
+        for (uint32_t r = ranges[q].first; r < ranges[q].second; ++r) {
+            const float* row = index.vector(r);
+            float dot = 0.0f;
+            for (size_t i = 0; i < dimension; ++i) dot += sample[q][i] * row[i];
+            top.push(1.0f - dot, r);
+        }
+        truth[q] = top.take();
+    }
+    double scalar_us = std::chrono::duration<double, std::micro>(Clock::now() - scalar_start).count() / queries;
+
+    health_ingestion::Int8Matrix codes;
+    codes.assign(index.data(), index.size(), dimension);
+    if (pq_subspaces == 0) pq_subspaces = std::max<size_t>(dimension / 8, 1);
+    health_ingestion::ProductQuantizer quantizer(dimension, pq_subspaces);
+    auto train_start = Clock::now();
+    quantizer.train(index.data(), index.size(), scheduler);
+    double train_seconds = std::chrono::duration<double>(Clock::now() - train_start).count();
+    auto encode_start = Clock::now();
+    std::vector<uint8_t> pq_codes = quantizer.encodeAll(index.data(), index.size(), scheduler);
+    double encode_seconds = std::chrono::duration<double>(Clock::now() - encode_start).count();
+
+    auto measure = [&](const char* name, auto&& search) {
+        size_t found = 0;
+        size_t expected = 0;
+        auto start = Clock::now();
+        for (size_t q = 0; q < queries; ++q) {
+            std::vector<Neighbor> hits = search(sample[q].data(), ranges[q]);
+            float bound = truth[q].back().distance + 1e-5f;
+            for (const auto& hit : hits) found += hit.distance <= bound;
+            expected += truth[q].size();
+        }
+        double mean_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries;
+        std::cout << std::left << std::setw(22) << name << std::right << "recall " << std::fixed
+                  << std::setprecision(4) << static_cast<double>(found) / expected << std::defaultfloat
+                  << std::setprecision(6) << "  mean " << mean_us << " us  (" << scalar_us / mean_us
+                  << "x scalar)" << std::endl;
+    };
+
+    std::cout << "\n=== Per-user recall@" << k << " over " << queries << " queries (" << users.size()
+              << " users, " << scanned / queries << " rows scanned per query) ===" << std::endl;
+    std::cout << "bytes per vector: f32 " << dimension * sizeof(float) << ", int8 " << dimension + sizeof(float)
+              << ", pq " << quantizer.codeSize() << " (" << pq_subspaces << " subspaces, trained in " << train_seconds
+              << "s, encoded in " << encode_seconds << "s)" << std::endl;
+    std::cout << std::left << std::setw(22) << "scalar scan" << std::right << "recall 1.0000  mean " << scalar_us
+              << " us" << std::endl;
+    measure("simd f32 scan", [&](const float* query, RowRange rows) {
+        return health_ingestion::scanTopK(index.data(), dimension, rows.first, rows.second, query, k);
+    });
+    measure("simd int8 scan", [&](const float* query, RowRange rows) {
+        // Approximate distances; re-score the hits so recall compares like with like
+        std::vector<Neighbor> hits = health_ingestion::scanTopK(codes, rows.first, rows.second, query, k);
+        for (auto& hit : hits) hit.distance = 1.0f - health_ingestion::dotF32(query, index.vector(hit.id), dimension);
+        return hits;
+    });
+    measure("simd int8 + re-rank", [&](const float* query, RowRange rows) {
+        health_ingestion::TopK top(k);
+        for (const auto& hit : health_ingestion::scanTopK(codes, rows.first, rows.second, query, 4 * k)) {
+            top.push(1.0f - health_ingestion::dotF32(query, index.vector(hit.id), dimension), hit.id);
+        }
+        return top.take();
+    });
+    measure("simd pq scan", [&](const float* query, RowRange rows) {
+        std::vector<Neighbor> hits =
+            health_ingestion::scanTopK(quantizer, pq_codes.data(), rows.first, rows.second, query, k);
+        for (auto& hit : hits) hit.distance = 1.0f - health_ingestion::dotF32(query, index.vector(hit.id), dimension);
+        return hits;
+    });
+    measure("simd pq + re-rank", [&](const float* query, RowRange rows) {
+        health_ingestion::TopK top(k);
+        for (const auto& hit :
+             health_ingestion::scanTopK(quantizer, pq_codes.data(), rows.first, rows.second, query, 10 * k)) {
+            top.push(1.0f - health_ingestion::dotF32(query, index.vector(hit.id), dimension), hit.id);
+        }
+        return top.take();
+    });
+    for (size_t ef : {64, 256, 1024}) {
+        std::string name = "hnsw+filter ef=" + std::to_string(ef);
+        measure(name.c_str(), [&, ef](const float* query, RowRange rows) {
+            std::vector<Neighbor> hits;
+            for (const auto& hit : index.search(query, ef, ef)) {
+                if (hit.id >= rows.first && hit.id < rows.second && hits.size() < k) hits.push_back(hit);
+            }
+            return hits;
+        });
+    }
+}
+
+// user_id + date range queries: the date index cuts a user down to a range of days (one
+// summary per user-day) and the configured scan runs over that block. Each block is checked against a linear
+// filter of the user's rows; latency covers the lookup and the scan.
+static void evaluateDateRange(const health_ingestion::QueryService& service, size_t queries) {
+    using RowRange = health_ingestion::QueryService::RowRange;
+    constexpr size_t k = 10;
+    const health_ingestion::UserDateIndex& dates = service.userIndex();
+    const health_ingestion::HnswIndex& index = service.index();
+    const size_t dimension = index.dimension();
+    std::vector<std::pair<std::string, RowRange>> users(dates.users().begin(), dates.users().end());
+    if (users.empty()) return;
+    std::sort(users.begin(), users.end());
+
+    std::mt19937_64 rng(13);
+    std::uniform_int_distribution<size_t> pick_user(0, users.size() - 1);
+    std::normal_distribution<float> noise(0.0f, 0.35f / std::sqrt(static_cast<float>(dimension)));
+    std::cout << "\n=== Per-user date ranges, top-" << k << " over " << queries << " queries ===" << std::endl;
+    for (uint32_t window : {7, 30, 365}) {
+        std::vector<double> latencies(queries);
+        size_t matched = 0;
+        size_t mismatched = 0;
+        for (size_t q = 0; q < queries; ++q) {
+            const auto& [user, rows] = users[pick_user(rng)];
+            std::uniform_int_distribution<uint32_t> pick_row(rows.first, rows.second - 1);
+            uint32_t first = pick_row(rng);
+            int32_t from = dates.date(first);
+            int32_t to = dates.date(std::min(first + window, rows.second) - 1);
+            std::vector<float> query(index.vector(first), index.vector(first) + dimension);
+            for (float& value : query) value += noise(rng);
+            health_ingestion::normaliseVector(query.data(), dimension);
+
+            auto start = std::chrono::steady_clock::now();
+            RowRange range = dates.find(user, from, to);
+            service.searchRows(query.data(), range, k);
+            latencies[q] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            size_t expected = 0;
+            for (uint32_t r = rows.first; r < rows.second; ++r) {
+                expected += dates.date(r) >= from && dates.date(r) <= to;
+            }
+            mismatched += expected != range.second - range.first;
+            matched += range.second - range.first;
+        }
+        double total = 0;
+        for (double latency : latencies) total += latency;
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::left << std::setw(22) << (std::to_string(window) + "-day range") << std::right
+                  << matched / queries << " rows  mean " << total / queries << " us  p99 "
+                  << latencies[latencies.size() * 99 / 100] << " us"
+                  << (mismatched ? "  (" + std::to_string(mismatched) + " ranges differ from a linear filter)" : "")
+                  << std::endl;
+    }
+}
+
+// Result cache: hit rates of W-TinyLFU against plain LRU on a Zipf-distributed stream of
+// repeated questions with a long tail of one-offs, then /query latency for a miss and a hit
+static void evaluateCache(const health_ingestion::QueryService& service, size_t capacity, bool text_queries) {
+    using health_ingestion::QueryCache;
+    if (capacity == 0) return;
+    constexpr size_t kRequests = 1000000;
+    const size_t distinct = capacity * 100;
+    std::cout << "\n=== Result cache, " << capacity << " entries, " << kRequests << " requests over " << distinct
+              << " distinct queries ===" << std::endl;
+    for (double skew : {0.8, 1.0, 1.2}) {
+        // Zipf ranks by inverse CDF over precomputed cumulative weights
+        std::vector<double> cumulative(distinct);
+        double total = 0;
+        for (size_t rank = 0; rank < distinct; ++rank) {
+            total += 1.0 / std::pow(static_cast<double>(rank + 1), skew);
+            cumulative[rank] = total;
+        }
+        std::mt19937_64 rng(17);
+        std::uniform_real_distribution<double> uniform(0.0, total);
+        std::vector<uint64_t> stream(kRequests);
+        for (auto& rank : stream) {
+            rank = std::lower_bound(cumulative.begin(), cumulative.end(), uniform(rng)) - cumulative.begin();
+        }
+        std::cout << "zipf s=" << skew;
+        for (bool admission : {false, true}) {
+            QueryCache cache(capacity, admission);
+            size_t hits = 0;
+            std::string value;
+            for (uint64_t rank : stream) {
+                health_ingestion::TextHash key = health_ingestion::hashText(std::to_string(rank));
+                if (cache.get(key, value)) {
+                    ++hits;
+                } else {
+                    cache.put(key, "r");
+                }
+            }
+            std::cout << (admission ? "  w-tinylfu " : "  lru ") << std::fixed << std::setprecision(4)
+                      << static_cast<double>(hits) / kRequests << std::defaultfloat << std::setprecision(6);
+        }
+        std::cout << std::endl;
+    }
+
+    // Each request once to fill the cache (a search), then repeatedly (hits)
+    const health_ingestion::HnswIndex& index = service.index();
+    std::vector<std::pair<const char*, nlohmann::json>> requests = {
+        {"embedding", {{"embedding", std::vector<float>(index.vector(0), index.vector(0) + index.dimension())}}}};
+    if (text_queries) {
+        requests.push_back({"text", {{"text", "How did I sleep after long runs?"}}});
+        requests.push_back({"text, respelled", {{"text", "  how did I sleep after long   runs"}}});
+    }
+    using Clock = std::chrono::steady_clock;
+    for (const auto& [name, body] : requests) {
+        health_ingestion::HttpRequest request;
+        request.method = "POST";
+        request.path = "/query";
+        request.body = body.dump();
+        auto time = [&]() {
+            auto start = Clock::now();
+            service.handle(request);
+            return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        };
+        double first_us = time();
+        double hit_us = 0;
+        constexpr int kRepeats = 1000;
+        for (int i = 0; i < kRepeats; ++i) hit_us += time();
+        std::cout << "/query " << name << " request: first " << first_us << " us, repeated " << hit_us / kRepeats
+                  << " us" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> inputs;
+    int port = 5001;
+    size_t threads = 0;
+    size_t eval_queries = 0;
+    health_ingestion::QueryOptions options;
+    health_ingestion::HnswParams& params = options.hnsw;
+    std::string embed_model;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "--ef" && i + 1 < argc) {
+            options.ef = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--M" && i + 1 < argc) {
+            params.M = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--ef-construction" && i + 1 < argc) {
+            params.ef_construction = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--embed-model" && i + 1 < argc) {
+            embed_model = argv[++i];
+        } else if (arg == "--scan" && i + 1 < argc) {
+            std::string precision = argv[++i];
+            if (precision == "f32") {
+                options.scan = health_ingestion::ScanPrecision::F32;
+            } else if (precision == "int8") {
+                options.scan = health_ingestion::ScanPrecision::Int8;
+            } else if (precision == "pq" || precision.rfind("pq:", 0) == 0) {
+                options.scan = health_ingestion::ScanPrecision::PQ;
+                options.pq_subspaces = precision.size() > 3 ? std::strtoul(precision.c_str() + 3, nullptr, 10) : 0;
+            } else {
+                std::cerr << "Error: Invalid --scan value: " << precision << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cache_entries = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--cache-buckets") {
+            options.cache_buckets = true;
+        } else if (arg == "--eval" && i + 1 < argc) {
+            eval_queries = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty() || port < 0 || port > 65535 || options.ef == 0 || params.M < 2 || params.ef_construction == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::shared_ptr<const health_ingestion::SentenceEncoder> encoder;
+    if (!embed_model.empty()) {
+        encoder = health_ingestion::SentenceEncoder::load(embed_model);
+        if (!encoder) {
+            return 1;
+        }
+    }
+    // Blocked before any thread starts, so every thread inherits the mask and sigwait() sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    health_ingestion::TaskScheduler scheduler(threads);
+
+    using Clock = std::chrono::steady_clock;
+    auto load_start = Clock::now();
+    health_ingestion::QueryCorpus corpus;
+    for (const auto& input : inputs) {
+        if (!corpus.load(input, encoder.get(), scheduler)) {
+            return 1;
+        }
+    }
+    double load_seconds = std::chrono::duration<double>(Clock::now() - load_start).count();
+    std::cout << "Loaded " << corpus.size() << " summaries (" << corpus.dimension << "-d) in " << load_seconds
+              << "s";
+    if (corpus.skipped > 0) std::cout << ", skipped " << corpus.skipped << " without a usable vector";
+    std::cout << std::endl;
+    if (corpus.size() == 0) {
+        std::cerr << "Error: No summaries with vectors to index"
+                  << (encoder ? "" : " (pass --embed-model to embed text-only input)") << std::endl;
+        return 1;
+    }
+    if (options.pq_subspaces > 0 && corpus.dimension % options.pq_subspaces != 0) {
+        std::cerr << "Error: --scan pq:" << options.pq_subspaces << " does not divide the " << corpus.dimension
+                  << "-d vectors" << std::endl;
+        return 1;
+    }
+    if (encoder && corpus.dimension != encoder->dimension()) {
+        std::cerr << "Warning: Vectors are " << corpus.dimension << "-d but the model's are "
+                  << encoder->dimension() << "-d; text queries will be rejected" << std::endl;
+    }
+
+    auto build_start = Clock::now();
+    health_ingestion::QueryService service(std::move(corpus), encoder, options, scheduler);
+    double build_seconds = std::chrono::duration<double>(Clock::now() - build_start).count();
+    std::cout << "Built HNSW index (M=" << params.M << ", ef_construction=" << params.ef_construction << ", "
+              << service.index().maxLevel() + 1 << " layers) in " << build_seconds << "s on "
+              << scheduler.concurrency() << " threads" << std::endl;
+
+    if (eval_queries > 0) {
+        evaluate(service.index(), eval_queries);
+        evaluateFiltered(service, options.pq_subspaces, scheduler, eval_queries);
+        evaluateDateRange(service, eval_queries);
+        evaluateCache(service, options.cache_entries, encoder != nullptr);
+        return 0;
+    }
+
+    health_ingestion::HttpServer server(static_cast<uint16_t>(port),
+                                        [&service](const health_ingestion::HttpRequest& request) {
+                                            return service.handle(request);
+                                        });
+    if (!server.start()) {
+        return 1;
+    }
+    std::cout << "Serving /query on http://0.0.0.0:" << server.port() << " (ef=" << options.ef << ", "
+              << service.userIndex().users().size() << " users)" << std::endl;
+
+    // Serve until SIGINT/SIGTERM
+    int received = 0;
+    sigwait(&signals, &received);
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,430 @@
+#include "query_service.hpp"
+#include "embedding_model.hpp"
+#include "health_processor.hpp"
+#include "metrics.hpp"
+#include "python_repr.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <zlib.h>
+
+using json = nlohmann::json;
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr size_t kDefaultLimit = 10;   // app.py's with_limit(10)
+constexpr size_t kMaxLimit = 1000;
+constexpr size_t kRerankFactor = 4;    // int8 scan candidates per result re-scored in float32
+constexpr size_t kPqRerankFactor = 10; // PQ distances are coarser, so it needs a wider net
+
+struct QueryMetrics {
+    Counter& queries = metrics().counter("health_query_requests_total", "Queries answered by /query");
+    Counter& errors = metrics().counter("health_query_errors_total", "Rejected /query requests");
+    Histogram& latency = metrics().histogram(
+        "health_query_seconds", "Latency of one /query request including any text embedding", latencyBuckets());
+    Counter& cache_text_hits = metrics().counter(
+        "health_query_cache_hits_total", "Queries answered from the result cache", "key=\"text\"");
+    Counter& cache_vector_hits = metrics().counter(
+        "health_query_cache_hits_total", "Queries answered from the result cache", "key=\"vector\"");
+    Counter& cache_misses = metrics().counter("health_query_cache_misses_total", "Queries the result cache missed");
+    Gauge& cache_entries = metrics().gauge("health_query_cache_entries", "Responses held by the result cache");
+};
+
+QueryMetrics& queryMetrics() {
+    static QueryMetrics instance;
+    return instance;
+}
+
+HttpResponse errorResponse(int status, const std::string& message) {
+    queryMetrics().errors.inc();
+    HttpResponse response;
+    response.status = status;
+    response.body = json{{"error", message}}.dump();
+    return response;
+}
+
+// One parsed input line
+struct Parsed {
+    std::string text;
+    std::string meta;
+    std::string user_id;
+    int32_t date = 0;
+    std::vector<float> vector;
+    bool ok = false;
+};
+
+// A string value out of a meta repr such as "{'date': '2024-01-15', 'user_id': 'u1'}";
+// user ids and dates never need escaping
+std::string reprValue(const std::string& repr, const std::string& key) {
+    const std::string prefix = "'" + key + "': '";
+    size_t begin = repr.find(prefix);
+    if (begin == std::string::npos) return "";
+    begin += prefix.size();
+    size_t end = repr.find('\'', begin);
+    return end == std::string::npos ? "" : repr.substr(begin, end - begin);
+}
+
+// "date_from"/"date_to" of a request, as "YYYY-MM-DD" or a YYYYMMDD integer
+bool requestDate(const json& payload, const char* name, int32_t& date) {
+    auto field = payload.find(name);
+    if (field == payload.end() || field->is_null()) return true;
+    if (field->is_number_integer()) {
+        date = field->get<int32_t>();
+        return true;
+    }
+    date = field->is_string() ? dateKey(field->get<std::string>()) : 0;
+    return date != 0;
+}
+
+Parsed parseLine(const std::string& line, const SentenceEncoder* encoder) {
+    Parsed parsed;
+    json item = json::parse(line, nullptr, false);
+    if (!item.is_object()) return parsed;
+
+    // Weaviate export objects keep text/meta under "properties" and the vector beside it
+    const json& fields = item.contains("properties") ? item["properties"] : item;
+    auto text = fields.find("text");
+    if (text == fields.end() || !text->is_string()) return parsed;
+    parsed.text = text->get<std::string>();
+    auto meta = fields.find("meta");
+    if (meta != fields.end() && meta->is_object()) {
+        parsed.meta = pythonRepr(*meta);
+        auto user = meta->find("user_id");
+        if (user != meta->end() && user->is_string()) parsed.user_id = user->get<std::string>();
+        auto date = meta->find("date");
+        if (date != meta->end() && date->is_string()) parsed.date = dateKey(date->get<std::string>());
+    } else if (meta != fields.end() && meta->is_string()) {
+        // Exported meta is already the repr string
+        parsed.meta = meta->get<std::string>();
+        parsed.user_id = reprValue(parsed.meta, "user_id");
+        parsed.date = dateKey(reprValue(parsed.meta, "date"));
+    }
+    // Typed copies of meta's fields, from the ingester's payloads or Weaviate properties
+    auto user = fields.find("user_id");
+    if (user != fields.end() && user->is_string()) parsed.user_id = user->get<std::string>();
+    auto date = fields.find("date");
+    if (date != fields.end() && date->is_number_integer()) parsed.date = date->get<int32_t>();
+
+    auto vector = item.find(item.contains("vector") ? "vector" : "embedding");
+    if (vector != item.end() && vector->is_array() && !vector->empty()) {
+        parsed.vector.reserve(vector->size());
+        for (const auto& value : *vector) {
+            if (!value.is_number()) return parsed;
+            parsed.vector.push_back(value.get<float>());
+        }
+    } else if (encoder) {
+        parsed.vector = encoder->embed(parsed.text);
+    }
+    parsed.ok = !parsed.vector.empty();
+    return parsed;
+}
+
+// Every line of a file; gzopen reads uncompressed files transparently
+bool readLines(const std::string& path, std::vector<std::string>& lines) {
+    gzFile file = gzopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Error: Cannot open " << path << std::endl;
+        return false;
+    }
+    gzbuffer(file, 1 << 20);
+    std::vector<char> buffer(1 << 20);
+    std::string partial;
+    int read;
+    while ((read = gzread(file, buffer.data(), static_cast<unsigned>(buffer.size()))) > 0) {
+        const char* begin = buffer.data();
+        const char* end = begin + read;
+        for (const char* newline; (newline = std::find(begin, end, '\n')) != end; begin = newline + 1) {
+            partial.append(begin, newline);
+            if (!partial.empty()) lines.push_back(std::move(partial));
+            partial.clear();
+        }
+        partial.append(begin, end);
+    }
+    if (!partial.empty()) lines.push_back(std::move(partial));
+    int error = Z_OK;
+    const char* message = read < 0 ? gzerror(file, &error) : nullptr;
+    gzclose(file);
+    if (message) {
+        std::cerr << "Error: Cannot read " << path << ": " << message << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool QueryCorpus::load(const std::string& path, const SentenceEncoder* encoder, TaskScheduler& scheduler) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec)) {
+        return loadFile(path, encoder, scheduler);
+    }
+    // Sharded sink output: completed parts only (in-progress files are hidden .tmp files)
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && !name.empty() && name[0] != '.') {
+            files.push_back(entry.path().string());
+        }
+    }
+    if (ec) {
+        std::cerr << "Error: Cannot list " << path << ": " << ec.message() << std::endl;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto& file : files) {
+        if (!loadFile(file, encoder, scheduler)) return false;
+    }
+    return true;
+}
+
+bool QueryCorpus::loadFile(const std::string& path, const SentenceEncoder* encoder, TaskScheduler& scheduler) {
+    std::vector<std::string> lines;
+    if (!readLines(path, lines)) return false;
+
+    std::vector<Parsed> parsed(lines.size());
+    scheduler.parallelFor(lines.size(), [&](size_t i) { parsed[i] = parseLine(lines[i], encoder); });
+
+    for (auto& item : parsed) {
+        if (!item.ok) {
+            ++skipped;
+            continue;
+        }
+        if (dimension == 0) dimension = item.vector.size();
+        if (item.vector.size() != dimension) {
+            ++skipped;
+            continue;
+        }
+        vectors.insert(vectors.end(), item.vector.begin(), item.vector.end());
+        texts.push_back(std::move(item.text));
+        metas.push_back(std::move(item.meta));
+        user_ids.push_back(std::move(item.user_id));
+        dates.push_back(item.date);
+    }
+    return true;
+}
+
+QueryService::QueryService(QueryCorpus corpus, std::shared_ptr<const SentenceEncoder> encoder,
+                           const QueryOptions& options, TaskScheduler& scheduler)
+    : encoder_(std::move(encoder))
+    , options_(options)
+    , index_(corpus.dimension, options.hnsw) {
+    // Renumber so each user's summaries get consecutive ids in date order (load order
+    // within a day), which makes every date range of a user a contiguous block
+    const size_t count = corpus.size();
+    const size_t dimension = corpus.dimension;
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i) order[i] = static_cast<uint32_t>(i);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) {
+                         int order = corpus.user_ids[a].compare(corpus.user_ids[b]);
+                         return order != 0 ? order < 0 : corpus.dates[a] < corpus.dates[b];
+                     });
+
+    std::vector<float> vectors(count * dimension);
+    texts_.reserve(count);
+    metas_.reserve(count);
+    for (size_t row = 0; row < count; ++row) {
+        uint32_t source = order[row];
+        std::copy_n(corpus.vectors.data() + source * dimension, dimension, vectors.data() + row * dimension);
+        texts_.push_back(std::move(corpus.texts[source]));
+        metas_.push_back(std::move(corpus.metas[source]));
+        user_index_.add(corpus.user_ids[source], corpus.dates[source]);
+    }
+    corpus = QueryCorpus();
+
+    index_.build(std::move(vectors), scheduler);
+    if (options_.cache_entries > 0) {
+        cache_ = std::make_unique<QueryCache>(options_.cache_entries);
+    }
+    if (options_.scan == ScanPrecision::Int8) {
+        int8_rows_.assign(index_.data(), index_.size(), index_.dimension());
+    } else if (options_.scan == ScanPrecision::PQ) {
+        size_t subspaces = options_.pq_subspaces > 0 ? options_.pq_subspaces : std::max<size_t>(dimension / 8, 1);
+        quantizer_ = std::make_unique<ProductQuantizer>(dimension, subspaces);
+        quantizer_->train(index_.data(), index_.size(), scheduler);
+        pq_codes_ = quantizer_->encodeAll(index_.data(), index_.size(), scheduler);
+    }
+}
+
+std::vector<Neighbor> QueryService::searchRows(const float* query, RowRange rows, size_t k) const {
+    const size_t dimension = index_.dimension();
+    std::vector<Neighbor> candidates;
+    switch (options_.scan) {
+    case ScanPrecision::F32:
+        return scanTopK(index_.data(), dimension, rows.first, rows.second, query, k);
+    case ScanPrecision::Int8:
+        candidates = scanTopK(int8_rows_, rows.first, rows.second, query, k * kRerankFactor);
+        break;
+    case ScanPrecision::PQ:
+        candidates = scanTopK(*quantizer_, pq_codes_.data(), rows.first, rows.second, query, k * kPqRerankFactor);
+        break;
+    }
+    // Quantised distances are approximate, so over-fetch and order the survivors exactly
+    TopK top(k);
+    for (const Neighbor& candidate : candidates) {
+        top.push(1.0f - dotF32(query, index_.vector(candidate.id), dimension), candidate.id);
+    }
+    return top.take();
+}
+
+std::vector<Neighbor> QueryService::searchRanges(const float* query, const std::vector<RowRange>& ranges,
+                                                 size_t k) const {
+    TopK top(k);
+    for (const RowRange& rows : ranges) {
+        for (const Neighbor& hit : searchRows(query, rows, k)) top.push(hit.distance, hit.id);
+    }
+    return top.take();
+}
+
+HttpResponse QueryService::handle(const HttpRequest& request) const {
+    HttpResponse response;
+    if (request.path == "/query" && request.method == "POST") {
+        return query(request);
+    } else if (request.path == "/health") {
+        response.body = json{{"status", "healthy"}, {"objects", index_.size()}}.dump();
+    } else if (request.path == "/metrics") {
+        response.content_type = "text/plain; version=0.0.4";
+        response.body = metrics().renderPrometheus();
+    } else {
+        response.status = 404;
+        response.body = "{\"error\": \"not found\"}";
+    }
+    return response;
+}
+
+HttpResponse QueryService::query(const HttpRequest& request) const {
+    auto start = std::chrono::steady_clock::now();
+    json payload = json::parse(request.body, nullptr, false);
+    if (request.body.empty()) payload = json::object();
+    if (!payload.is_object()) {
+        return errorResponse(400, "JSON body required");
+    }
+
+    size_t limit = kDefaultLimit;
+    size_t ef = options_.ef;
+    std::string user_id;
+    try {
+        limit = std::min(payload.value("limit", kDefaultLimit), kMaxLimit);
+        ef = std::min(payload.value("ef", options_.ef), std::max<size_t>(index_.size(), 1));
+        user_id = payload.value("user_id", "");
+    } catch (const json::exception&) {
+        return errorResponse(400, "limit and ef must be non-negative integers and user_id a string");
+    }
+    int32_t date_from = UserDateIndex::kFirstDate;
+    int32_t date_to = UserDateIndex::kLastDate;
+    if (!requestDate(payload, "date_from", date_from) || !requestDate(payload, "date_to", date_to)) {
+        return errorResponse(400, "date_from and date_to must be YYYY-MM-DD or YYYYMMDD");
+    }
+    bool dated = date_from != UserDateIndex::kFirstDate || date_to != UserDateIndex::kLastDate;
+
+    HttpResponse response;
+    auto answer = [&]() {
+        queryMetrics().queries.inc();
+        queryMetrics().latency.observe(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        return response;
+    };
+    // Every request field that shapes the results, shared by all of this request's cache keys.
+    // Fields are tagged, and user_id length-prefixed, so no user_id can read as an ef or
+    // another field (ef only steers graph search, not the exact per-user scans)
+    std::string scope = "limit:" + std::to_string(limit) +
+                        (user_id.empty() ? "|ef:" + std::to_string(ef)
+                                         : "|u" + std::to_string(user_id.size()) + ':' + user_id) +
+                        "|from:" + std::to_string(date_from) + "|to:" + std::to_string(date_to) + '\n';
+
+    std::vector<float> embedding;
+    TextHash text_key;
+    bool text_query = false;
+    auto vector = payload.find("embedding");
+    if (vector != payload.end() && !vector->is_null()) {
+        if (!vector->is_array()) return errorResponse(400, "embedding must be a list of numbers");
+        for (const auto& value : *vector) {
+            if (!value.is_number()) return errorResponse(400, "embedding must be a list of numbers");
+            embedding.push_back(value.get<float>());
+        }
+    } else {
+        auto field = payload.find("text");
+        std::string text = field != payload.end() && field->is_string() ? field->get<std::string>() : "";
+        if (text.empty()) return errorResponse(400, "text or embedding required");
+        if (!encoder_) return errorResponse(400, "text queries need the service started with --embed-model");
+        text_query = true;
+        if (cache_) {
+            text_key = hashText("text|" + scope + normaliseQueryText(text));
+            if (cache_->get(text_key, response.body)) {
+                queryMetrics().cache_text_hits.inc();
+                return answer();
+            }
+        }
+        embedding = encoder_->embed(text);
+    }
+    if (embedding.size() != index_.dimension()) {
+        return errorResponse(400, "embedding has " + std::to_string(embedding.size()) + " dimensions, index has " +
+                                      std::to_string(index_.dimension()));
+    }
+
+    // Vector keys: always for embedding requests, and for missed texts when bucketing
+    const bool vector_keyed = cache_ && (!text_query || options_.cache_buckets);
+    TextHash vector_key;
+    if (vector_keyed) {
+        vector_key = vectorKey(embedding, scope);
+        if (cache_->get(vector_key, response.body)) {
+            queryMetrics().cache_vector_hits.inc();
+            if (text_query) cache_->put(text_key, response.body);
+            return answer();
+        }
+    }
+    if (cache_) queryMetrics().cache_misses.inc();
+
+    std::vector<Neighbor> hits;
+    if (!user_id.empty()) {
+        RowRange rows = user_index_.find(user_id, date_from, date_to);
+        if (rows.first < rows.second) {
+            normaliseVector(embedding.data(), embedding.size());
+            hits = searchRows(embedding.data(), rows, limit);
+        }
+    } else if (dated) {
+        // Every user's days in the range, scanned exactly; the graph cannot filter
+        std::vector<RowRange> ranges = user_index_.findAll(date_from, date_to);
+        if (!ranges.empty()) {
+            normaliseVector(embedding.data(), embedding.size());
+            hits = searchRanges(embedding.data(), ranges, limit);
+        }
+    } else {
+        hits = index_.search(embedding.data(), limit, ef);
+    }
+
+    json results = json::array();
+    for (const Neighbor& hit : hits) {
+        results.push_back({{"text", texts_[hit.id]}, {"meta", metas_[hit.id]}});
+    }
+    response.body = json{{"results", std::move(results)}}.dump();
+
+    if (cache_) {
+        if (text_query) cache_->put(text_key, response.body);
+        if (vector_keyed) cache_->put(vector_key, response.body);
+        queryMetrics().cache_entries.set(static_cast<int64_t>(cache_->size()));
+    }
+    return answer();
+}
+
+TextHash QueryService::vectorKey(const std::vector<float>& embedding, const std::string& scope) const {
+    std::string key = "vector|" + scope;
+    if (!options_.cache_buckets) {
+        key.append(reinterpret_cast<const char*>(embedding.data()), embedding.size() * sizeof(float));
+        return hashText(key);
+    }
+    // Bucket: the direction quantised to int8, so vectors differing only in low bits collide
+    std::vector<float> unit = embedding;
+    normaliseVector(unit.data(), unit.size());
+    std::vector<int8_t> codes(unit.size());
+    Int8Matrix::quantise(unit.data(), unit.size(), codes.data());
+    key.append(reinterpret_cast<const char*>(codes.data()), codes.size());
+    return hashText("bucket|" + key);
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "hnsw_index.hpp"
+#include "http_server.hpp"
+#include "product_quantizer.hpp"
+#include "query_cache.hpp"
+#include "user_date_index.hpp"
+#include "vector_scan.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace health_ingestion {
+
+class SentenceEncoder;
+class TaskScheduler;
+
+// Summaries to serve: text and meta as Weaviate holds them, plus one vector each
+struct QueryCorpus {
+    size_t dimension = 0;
+    std::vector<float> vectors;       // [size][dimension]
+    std::vector<std::string> texts;
+    std::vector<std::string> metas;   // Python repr of the meta dict, as app.py stores it
+    std::vector<std::string> user_ids;  // meta's user_id, empty if it has none
+    std::vector<int32_t> dates;       // The date as YYYYMMDD, 0 if it has none
+    size_t skipped = 0;               // Lines without a usable vector
+
+    size_t size() const { return texts.size(); }
+
+    // Appends the summaries in an NDJSON file (gzip or plain), or in every file of a
+    // directory such as a files:<dir> output. Lines are --output ndjson
+    // payloads ({"text","meta","embedding"}) or Weaviate objects ({"properties","vector"}).
+    // Lines without a vector are embedded with `encoder` when one is given.
+    bool load(const std::string& path, const SentenceEncoder* encoder, TaskScheduler& scheduler);
+
+private:
+    bool loadFile(const std::string& path, const SentenceEncoder* encoder, TaskScheduler& scheduler);
+};
+
+// Storage read by per-user scans; the quantised ones re-rank their candidates in float32
+enum class ScanPrecision { F32, Int8, PQ };
+
+struct QueryOptions {
+    HnswParams hnsw;
+    size_t ef = 64;            // Default layer-0 candidate list size
+    ScanPrecision scan = ScanPrecision::F32;
+    size_t pq_subspaces = 0;   // Bytes per PQ code; 0 picks dimension / 8
+    size_t cache_entries = 10000;  // Cached /query responses; 0 disables the cache
+    bool cache_buckets = false;    // Also key requests by their int8-quantised vector
+};
+
+// In-process replacement for api/app.py's /query: the corpus in an HNSW index, served
+// over HTTP with the same request and response shapes.
+//
+//   POST /query {"text": "..."} or {"embedding": [...]}, optional "limit" (default 10)
+//                and "ef" (layer-0 candidate list size, default from the command line)
+//   -> {"results": [{"meta": "...", "text": "..."}, ...]}, nearest first
+//   GET /health, GET /metrics
+//
+// Responses are cached (see query_cache.hpp) under the normalised text, or the exact
+// embedding, plus the other request fields. The index never changes after startup, so
+// entries stay valid. With cache_buckets, requests are also keyed by their vector
+// quantised to int8, which catches embeddings of the same text that differ in the
+// low bits (as when a client embeds it in different batches) and texts that embed
+// alike.
+//
+// A "user_id" in the request restricts results to that user, and "date_from" and
+// "date_to" ("YYYY-MM-DD" or YYYYMMDD, inclusive) to a range of days. Summaries are
+// ordered by user and date before the index is built, so one user's matches are a
+// contiguous block (see user_date_index.hpp) that is scanned exactly (see
+// vector_scan.hpp) instead of searching the graph. A date range without a user, as
+// api/app.py also accepts, scans the block of every user with days in the range, so
+// its cost grows with the number of matching summaries.
+class QueryService {
+public:
+    using RowRange = UserDateIndex::RowRange;  // [begin, end) of index ids
+
+    QueryService(QueryCorpus corpus, std::shared_ptr<const SentenceEncoder> encoder, const QueryOptions& options,
+                 TaskScheduler& scheduler);
+
+    HttpResponse handle(const HttpRequest& request) const;
+
+    // Exact top-k among a block of one user's summaries; `query` must be unit length
+    std::vector<Neighbor> searchRows(const float* query, RowRange rows, size_t k) const;
+    // Exact top-k over several blocks
+    std::vector<Neighbor> searchRanges(const float* query, const std::vector<RowRange>& ranges, size_t k) const;
+
+    const HnswIndex& index() const { return index_; }
+    const UserDateIndex& userIndex() const { return user_index_; }
+    size_t ef() const { return options_.ef; }
+
+private:
+    HttpResponse query(const HttpRequest& request) const;
+    TextHash vectorKey(const std::vector<float>& embedding, const std::string& scope) const;
+
+    std::vector<std::string> texts_;
+    std::vector<std::string> metas_;
+    std::shared_ptr<const SentenceEncoder> encoder_;  // Optional; needed for text queries
+    QueryOptions options_;
+    HnswIndex index_;
+    UserDateIndex user_index_;
+    Int8Matrix int8_rows_;                            // Only with ScanPrecision::Int8
+    std::unique_ptr<ProductQuantizer> quantizer_;     // Only with ScanPrecision::PQ
+    std::vector<uint8_t> pq_codes_;                   // [size][quantizer_->codeSize()]
+    std::unique_ptr<QueryCache> cache_;               // Null when disabled
+};
+
+} // namespace health_ingestion
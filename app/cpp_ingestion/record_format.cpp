@@ -0,0 +1,128 @@
+#include "record_format.hpp"
+#include <charconv>
+#include <limits>
+#include <ostream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace health_ingestion {
+
+FieldKind readField(const json* value, FieldSlot& slot, bool categorical) {
+    if (!value) return FieldKind::Missing;
+    switch (value->type()) {
+        case json::value_t::number_float:
+            slot.real = value->get<double>();
+            return FieldKind::Real;
+        case json::value_t::number_integer:
+            slot.integer = value->get<int64_t>();
+            return FieldKind::Integer;
+        case json::value_t::number_unsigned:
+            if (value->get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                slot.integer = value->get<int64_t>();
+                return FieldKind::Integer;
+            }
+            break;
+        case json::value_t::boolean:
+            slot.integer = value->get<bool>();
+            return FieldKind::Boolean;
+        case json::value_t::string:
+            if (!categorical) break;
+            slot.symbol = symbols().intern(value->get_ref<const std::string&>());
+            return FieldKind::Symbol;
+        default:
+            break;
+    }
+    return FieldKind::Missing;
+}
+
+std::ostream& operator<<(std::ostream& out, FieldRef field) {
+    switch (field.kind) {
+        case FieldKind::Missing:
+            return out << "null";
+        case FieldKind::Real:
+            // json's shortest round-trip form, with ".0" on whole numbers
+            return out << json(field.slot.real);
+        case FieldKind::Integer: {
+            char buffer[24];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), field.slot.integer);
+            return out.write(buffer, result.ptr - buffer);
+        }
+        case FieldKind::Boolean:
+            return out << (field.slot.integer ? "true" : "false");
+        case FieldKind::Symbol:
+            return out << symbols().quoted(field.slot.symbol);
+    }
+    return out;
+}
+
+const json* findField(const json& record, const char* name) {
+    auto it = record.find(name);
+    return it == record.end() ? nullptr : &*it;
+}
+
+void formatRecord(std::ostream& out, const ActivityRecord& record) {
+    using F = ActivityRecord;
+    const auto& f = record.fields;
+    out << "did " << f[F::ActivityType]
+        << " for " << f[F::Duration] << " minutes in "
+        << f[F::Weather] << " weather, burning "
+        << f[F::CaloriesBurned] << " calories, covering "
+        << f[F::Distance] << " km with " << f[F::Steps]
+        << " steps, avg HR " << f[F::HeartRateAvg]
+        << " bpm (max " << f[F::HeartRateMax] << ").";
+}
+
+void formatRecord(std::ostream& out, const WorkoutRecord& record) {
+    using F = WorkoutRecord;
+    const auto& f = record.fields;
+    out << "Completed a " << f[F::WorkoutType]
+        << " workout for " << f[F::Duration] << " minutes, "
+        << f[F::Sets] << " sets of " << f[F::Reps]
+        << " reps, burned " << f[F::CaloriesBurned] << " calories.";
+}
+
+void formatRecord(std::ostream& out, const NutritionRecord& record) {
+    using F = NutritionRecord;
+    const auto& f = record.fields;
+    out << "Ate " << f[F::Calories] << " calories at "
+        << f[F::MealType] << " (" << f[F::Protein]
+        << "g protein, " << f[F::Carbs] << "g carbs, "
+        << f[F::Fat] << "g fat).";
+}
+
+void formatRecord(std::ostream& out, const SleepRecord& record) {
+    using F = SleepRecord;
+    const auto& f = record.fields;
+    out << "Slept " << f[F::TotalSleep] << " hours (deep "
+        << f[F::DeepSleep] << "h, REM " << f[F::RemSleep]
+        << "h), quality " << f[F::SleepQuality]
+        << ", resting HR " << f[F::RestingHeartRate] << " bpm.";
+}
+
+void formatRecord(std::ostream& out, const MeasurementRecord& record) {
+    using F = MeasurementRecord;
+    const auto& f = record.fields;
+    const char* separator = "Measured ";
+    auto item = [&](const char* label, size_t field, const char* unit) {
+        if (!f.numeric(field)) return;
+        out << separator << label << f[field] << unit;
+        separator = ", ";
+    };
+    item("weight ", F::Weight, " kg");
+    item("body fat ", F::BodyFat, "%");
+    item("muscle mass ", F::MuscleMass, " kg");
+    // Devices report the pair together; half a reading is not worth printing
+    if (f.numeric(F::BloodPressureSystolic) && f.numeric(F::BloodPressureDiastolic)) {
+        out << separator << "blood pressure " << f[F::BloodPressureSystolic] << "/"
+            << f[F::BloodPressureDiastolic] << " mmHg";
+        separator = ", ";
+    }
+    if (*separator == ',') out << ".";
+}
+
+void formatRange(std::ostream& out, RecordTag<HeartRateRecord>, double min, double max) {
+    out << "Heart rate ranged " << min << "–" << max << " bpm during the day.";
+}
+
+} // namespace health_ingestion
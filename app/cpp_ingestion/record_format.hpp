@@ -0,0 +1,217 @@
+#pragma once
+
+#include "symbol_table.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <tuple>
+#include <nlohmann/json_fwd.hpp>
+
+namespace health_ingestion {
+
+// One field of an input record as it was written: JSON integers and floats keep their
+// own rendering (30 vs 300.0), booleans render as true/false, and a string in one of the
+// record's categorical fields is interned in symbols() and rendered quoted. Any other
+// value - null, free text in a numeric field, an object or array - is dropped and reads
+// as missing, which renders as null; only declared categories reach the bounded symbol
+// table, so unexpected input cannot fill it.
+enum class FieldKind : uint8_t { Missing, Real, Integer, Boolean, Symbol };
+
+union FieldSlot {
+    double real;
+    int64_t integer;
+    Symbol symbol;
+};
+
+// value may be null for a missing field; strings are kept only if categorical
+FieldKind readField(const nlohmann::json* value, FieldSlot& slot, bool categorical);
+
+// A stored field, streamable as its text
+struct FieldRef {
+    FieldKind kind;
+    const FieldSlot& slot;
+};
+
+std::ostream& operator<<(std::ostream& out, FieldRef field);
+
+// Fixed-size, trivially copyable field storage: 8 bytes per field plus a kind byte.
+// Fields start out missing.
+template <size_t N>
+class RecordFields {
+public:
+    void set(size_t field, const nlohmann::json* value, bool categorical) {
+        kinds_[field] = readField(value, slots_[field], categorical);
+    }
+    FieldRef operator[](size_t field) const { return {kinds_[field], slots_[field]}; }
+
+    FieldKind kind(size_t field) const { return kinds_[field]; }
+    bool has(size_t field) const { return kinds_[field] != FieldKind::Missing; }
+    bool numeric(size_t field) const { return kinds_[field] == FieldKind::Real || kinds_[field] == FieldKind::Integer; }
+    bool any() const {
+        for (size_t i = 0; i < N; ++i) {
+            if (has(i)) return true;
+        }
+        return false;
+    }
+    // Takes every numeric field of `later`, keeping ours where it has none; a null or
+    // string value does not replace a reading
+    void overlayNumbers(const RecordFields& later) {
+        for (size_t i = 0; i < N; ++i) {
+            if (!later.numeric(i)) continue;
+            kinds_[i] = later.kinds_[i];
+            slots_[i] = later.slots_[i];
+        }
+    }
+    // The field as a number; values that were not JSON numbers (or are missing) count as 0
+    double number(size_t field) const {
+        switch (kinds_[field]) {
+            case FieldKind::Real: return slots_[field].real;
+            case FieldKind::Integer: return static_cast<double>(slots_[field].integer);
+            default: return 0.0;
+        }
+    }
+    Symbol symbol(size_t field) const { return slots_[field].symbol; }
+    // Symbol ids are per process; spill runs re-intern them when read back
+    void setSymbol(size_t field, Symbol id) { slots_[field].symbol = id; }
+
+private:
+    FieldSlot slots_[N];
+    FieldKind kinds_[N] = {};
+};
+
+// Per-day stores, defined in record_store.hpp
+template <class Record> struct RecordList;
+template <class Record> struct LatestRecord;
+template <class Record, size_t Field> struct NumericSeries;
+
+// The aggregated record types. Each declares its data type (read from <data type>.json),
+// its place in the processing order (smaller files first), the store a user-day keeps
+// it in, its input fields, named in Field order, and which of them are categorical
+// (bit i set for field i); parseRecord() below parses it,
+// formatRecord() or formatRange() renders it and DailyTotals::add() counts it.
+struct ActivityRecord {
+    static constexpr const char* kDataType = "activities";
+    static constexpr int kFileOrder = 1;
+    using Store = RecordList<ActivityRecord>;
+    enum Field { ActivityType, Duration, Weather, CaloriesBurned, Distance, Steps, HeartRateAvg, HeartRateMax,
+                 kFieldCount };
+    static constexpr const char* kFieldNames[kFieldCount] = {
+        "activity_type", "duration", "weather", "calories_burned", "distance", "steps", "heart_rate_avg",
+        "heart_rate_max"};
+    static constexpr uint32_t kCategorical = 1u << ActivityType | 1u << Weather;
+    RecordFields<kFieldCount> fields;
+};
+
+struct WorkoutRecord {
+    static constexpr const char* kDataType = "workouts";
+    static constexpr int kFileOrder = 2;
+    using Store = RecordList<WorkoutRecord>;
+    enum Field { WorkoutType, Duration, Sets, Reps, CaloriesBurned, kFieldCount };
+    static constexpr const char* kFieldNames[kFieldCount] = {
+        "workout_type", "duration", "sets", "reps", "calories_burned"};
+    static constexpr uint32_t kCategorical = 1u << WorkoutType;
+    RecordFields<kFieldCount> fields;
+};
+
+struct NutritionRecord {
+    static constexpr const char* kDataType = "nutrition";
+    static constexpr int kFileOrder = 4;
+    using Store = RecordList<NutritionRecord>;
+    enum Field { Calories, MealType, Protein, Carbs, Fat, kFieldCount };
+    static constexpr const char* kFieldNames[kFieldCount] = {"calories", "meal_type", "protein", "carbs", "fat"};
+    static constexpr uint32_t kCategorical = 1u << MealType;
+    RecordFields<kFieldCount> fields;
+};
+
+struct SleepRecord {
+    static constexpr const char* kDataType = "sleep";
+    static constexpr int kFileOrder = 3;
+    using Store = RecordList<SleepRecord>;
+    enum Field { TotalSleep, DeepSleep, RemSleep, SleepQuality, RestingHeartRate, kFieldCount };
+    static constexpr const char* kFieldNames[kFieldCount] = {
+        "total_sleep", "deep_sleep", "rem_sleep", "sleep_quality", "resting_heart_rate"};
+    static constexpr uint32_t kCategorical = 1u << SleepQuality;
+    RecordFields<kFieldCount> fields;
+};
+
+// Scale and blood-pressure readings; only weight is always present. A day keeps one,
+// the latest value of each field
+struct MeasurementRecord {
+    static constexpr const char* kDataType = "measurements";
+    static constexpr int kFileOrder = 0;
+    using Store = LatestRecord<MeasurementRecord>;
+    enum Field { Weight, BodyFat, MuscleMass, BloodPressureSystolic, BloodPressureDiastolic, kFieldCount };
+    static constexpr const char* kFieldNames[kFieldCount] = {
+        "weight", "body_fat", "muscle_mass", "blood_pressure_systolic", "blood_pressure_diastolic"};
+    static constexpr uint32_t kCategorical = 0;
+    RecordFields<kFieldCount> fields;
+};
+
+// One reading of a day's heart-rate series; summarised as its range, not a sentence
+struct HeartRateRecord {
+    static constexpr const char* kDataType = "heart_rate";
+    static constexpr int kFileOrder = 5;
+    enum Field { Value, kFieldCount };
+    using Store = NumericSeries<HeartRateRecord, Value>;
+    static constexpr const char* kFieldNames[kFieldCount] = {"value"};
+    static constexpr uint32_t kCategorical = 0;
+    RecordFields<kFieldCount> fields;
+};
+
+// The record's member named `name`, or null
+const nlohmann::json* findField(const nlohmann::json& record, const char* name);
+
+template <class Record>
+Record parseRecord(const nlohmann::json& record) {
+    Record parsed;
+    for (size_t i = 0; i < Record::kFieldCount; ++i) {
+        parsed.fields.set(i, findField(record, Record::kFieldNames[i]), (Record::kCategorical >> i) & 1u);
+    }
+    return parsed;
+}
+
+// Sentence renderers for one record of each aggregated type, run when the day's
+// summary is created
+void formatRecord(std::ostream& out, const ActivityRecord& record);
+void formatRecord(std::ostream& out, const WorkoutRecord& record);
+void formatRecord(std::ostream& out, const NutritionRecord& record);
+void formatRecord(std::ostream& out, const SleepRecord& record);
+// Only the numeric fields, as DailyTotals counts them; nothing when there are none
+void formatRecord(std::ostream& out, const MeasurementRecord& record);
+
+template <class Record>
+struct RecordTag {
+    using type = Record;
+};
+
+// The day's range of a series, for types stored as a NumericSeries
+void formatRange(std::ostream& out, RecordTag<HeartRateRecord>, double min, double max);
+
+// A compile-time list of record types. Callers pass a generic lambda taking a
+// RecordTag, so the code it runs per record is instantiated for each type and the
+// string comparison happens once per file rather than once per record.
+template <class... Records>
+struct RecordRegistry {
+    // One store of each type, in list order; std::get<Record::Store> finds a type's store
+    using Storage = std::tuple<typename Records::Store...>;
+
+    // visit(RecordTag<R>{}) for each type, in list order
+    template <class Visitor>
+    static void forEach(Visitor&& visit) {
+        (visit(RecordTag<Records>{}), ...);
+    }
+
+    // visit(RecordTag<R>{}) for the type whose kDataType is data_type; false if none is
+    template <class Visitor>
+    static bool dispatch(const std::string& data_type, Visitor&& visit) {
+        return ((data_type == Records::kDataType && (visit(RecordTag<Records>{}), true)) || ...);
+    }
+};
+
+// Every aggregated input, in the order its sentences appear in a summary. A new data
+// source is a record struct above, its renderer, a DailyTotals::add() overload, and an
+// entry here; DayData storage, merging and spilling follow from its Store.
+using RecordTypes = RecordRegistry<ActivityRecord, WorkoutRecord, NutritionRecord, SleepRecord,
+                                   MeasurementRecord, HeartRateRecord>;
+
+} // namespace health_ingestion
@@ -0,0 +1,152 @@
+#include "record_scanner.hpp"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr size_t kReadChunkSize = 4 << 20;  // 4 MiB reads
+
+size_t skipSpace(std::string_view text, size_t i) {
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\t' || text[i] == '\n' || text[i] == '\r')) ++i;
+    return i;
+}
+
+// Index of the quote closing the string whose opening quote is at `open`, or npos
+size_t stringEnd(std::string_view text, size_t open, bool& escaped) {
+    escaped = false;
+    for (size_t i = open + 1; i < text.size(); ++i) {
+        if (text[i] == '"') return i;
+        if (text[i] == '\\') {
+            escaped = true;
+            ++i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+} // namespace
+
+bool scanRecords(const std::string& path, uint64_t begin, uint64_t end, const RecordVisitor& visit,
+                 uint64_t* read_nanos) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(begin));
+
+    std::vector<char> chunk(kReadChunkSize);
+    std::string carry;        // Record text spanning a chunk boundary
+    int depth = 0;            // Nesting depth inside the current record (0 = between records)
+    bool in_string = false;
+    bool escaped = false;
+    uint64_t offset = begin;
+
+    while (offset < end) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(chunk.size(), end - offset));
+        auto read_start = std::chrono::steady_clock::now();
+        file.read(chunk.data(), want);
+        size_t got = static_cast<size_t>(file.gcount());
+        if (read_nanos) {
+            *read_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - read_start).count();
+        }
+        if (got == 0) break;
+
+        size_t record_start = depth > 0 ? 0 : got;
+        for (size_t i = 0; i < got; ++i) {
+            char c = chunk[i];
+            if (depth == 0) {
+                // Between records only '{' matters; '[', ',', ']' and whitespace are skipped
+                if (c == '{') {
+                    depth = 1;
+                    record_start = i;
+                }
+                continue;
+            }
+            if (in_string) {
+                if (escaped) escaped = false;
+                else if (c == '\\') escaped = true;
+                else if (c == '"') in_string = false;
+                continue;
+            }
+            if (c == '"') {
+                in_string = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                uint64_t record_end = offset + i + 1;
+                if (carry.empty()) {
+                    visit(std::string_view(chunk.data() + record_start, i + 1 - record_start), record_end);
+                } else {
+                    carry.append(chunk.data(), i + 1);
+                    visit(carry, record_end);
+                    carry.clear();
+                }
+            }
+        }
+        if (depth > 0) {
+            carry.append(chunk.data() + record_start, got - record_start);
+        }
+        offset += got;
+    }
+    return true;
+}
+
+std::vector<ByteRange> splitIntoRanges(const std::string& path, uint64_t target_bytes) {
+    std::vector<ByteRange> ranges;
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return ranges;
+    }
+
+    uint64_t range_begin = 0;
+    scanRecords(path, 0, file_size, [&](std::string_view, uint64_t end_offset) {
+        if (end_offset - range_begin >= target_bytes) {
+            ranges.push_back({range_begin, end_offset});
+            range_begin = end_offset;
+        }
+    });
+    if (range_begin < file_size) {
+        ranges.push_back({range_begin, file_size});
+    }
+    return ranges;
+}
+
+bool findTopLevelString(std::string_view record, std::string_view key, std::string_view& value) {
+    bool found = false;
+    int depth = 0;
+    for (size_t i = 0; i < record.size(); ++i) {
+        char c = record[i];
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        } else if (c == '"') {
+            bool escaped;
+            size_t end = stringEnd(record, i, escaped);
+            if (end == std::string_view::npos) return false;
+            std::string_view token = record.substr(i + 1, end - i - 1);
+            i = end;
+            // Only a top-level key is followed by ':'
+            size_t colon = skipSpace(record, end + 1);
+            if (depth != 1 || colon >= record.size() || record[colon] != ':') continue;
+            if (escaped) return false;  // Might spell the key
+            if (token != key) continue;
+            size_t open = skipSpace(record, colon + 1);
+            if (open >= record.size() || record[open] != '"') return false;
+            size_t close = stringEnd(record, open, escaped);
+            if (close == std::string_view::npos || escaped) return false;
+            value = record.substr(open + 1, close - open - 1);
+            found = true;
+            i = close;
+        }
+    }
+    return found;
+}
+
+} // namespace health_ingestion
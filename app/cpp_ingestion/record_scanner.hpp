@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace health_ingestion {
+
+// Half-open byte range [begin, end) of an input file
+struct ByteRange {
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Called with the raw text of each top-level record object and the offset just past it
+using RecordVisitor = std::function<void(std::string_view record, uint64_t end_offset)>;
+
+// Streams the top-level objects of a JSON array file that start inside [begin, end).
+// Ranges must start and end between records, as produced by splitIntoRanges().
+// If read_nanos is given, time spent in file reads is added to it.
+bool scanRecords(const std::string& path, uint64_t begin, uint64_t end, const RecordVisitor& visit,
+                 uint64_t* read_nanos = nullptr);
+
+// Cuts a JSON array file into ranges of roughly target_bytes, each ending on a record boundary
+std::vector<ByteRange> splitIntoRanges(const std::string& path, uint64_t target_bytes);
+
+// The value of the top-level member `key` of one record's raw text, without parsing it,
+// when that value is a string with no escapes. False if the member is missing, is not
+// such a string, or the record is not simple enough to tell (an escaped key), in which
+// case the caller should parse the record. The last occurrence wins, as in json::parse.
+bool findTopLevelString(std::string_view record, std::string_view key, std::string_view& value);
+
+} // namespace health_ingestion
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "record_format.hpp"
+#include <algorithm>
+#include <iterator>
+#include <ostream>
+#include <vector>
+
+namespace health_ingestion {
+
+// How a user-day keeps the records of one type. Each record struct names its store as
+// `Store`; DayData holds one of each, and the spill format has a reader and writer per
+// store kind, so a new record type only picks one of these. A store supports:
+//   add(record)    stores one record, returning the bytes it adds
+//   append(later)  folds in a later partial of the same day
+//   empty()        nothing to render
+//   render(out)    the summary text, each sentence preceded by a space
+
+// Every record in arrival order, each rendered as its own sentence
+template <class Record>
+struct RecordList {
+    std::vector<Record> records;
+
+    size_t add(const Record& record) {
+        records.push_back(record);
+        return sizeof(Record);
+    }
+    void append(RecordList&& later) {
+        records.insert(records.end(), std::make_move_iterator(later.records.begin()),
+                       std::make_move_iterator(later.records.end()));
+    }
+    bool empty() const { return records.empty(); }
+    void render(std::ostream& out) const {
+        for (const auto& record : records) {
+            out << " ";
+            formatRecord(out, record);
+        }
+    }
+};
+
+// One record holding the latest numeric value of each field: later records overwrite
+// earlier ones, and a null or string value does not replace a reading
+template <class Record>
+struct LatestRecord {
+    Record latest;
+
+    size_t add(const Record& record) {
+        latest.fields.overlayNumbers(record.fields);
+        return 0;
+    }
+    void append(LatestRecord&& later) { latest.fields.overlayNumbers(later.latest.fields); }
+    bool empty() const { return !latest.fields.any(); }
+    void render(std::ostream& out) const {
+        if (empty()) return;
+        out << " ";
+        formatRecord(out, latest);
+    }
+};
+
+// The numeric readings of one field, rendered as the day's range by formatRange();
+// non-numeric readings are dropped
+template <class Record, size_t Field>
+struct NumericSeries {
+    std::vector<double> values;
+
+    size_t add(const Record& record) {
+        if (!record.fields.numeric(Field)) return 0;
+        values.push_back(record.fields.number(Field));
+        return sizeof(double);
+    }
+    void append(NumericSeries&& later) { values.insert(values.end(), later.values.begin(), later.values.end()); }
+    bool empty() const { return values.empty(); }
+    void render(std::ostream& out) const {
+        if (empty()) return;
+        auto minmax = std::minmax_element(values.begin(), values.end());
+        out << " ";
+        formatRange(out, RecordTag<Record>{}, *minmax.first, *minmax.second);
+    }
+};
+
+} // namespace health_ingestion
@@ -29,7 +29,7 @@ echo "Data directory: /data"
 echo "API URL: ${API_URL:-http://api:5000/ingest}"
 
 # Run the ingestion
-/usr/local/bin/health_ingestion /data
+/usr/local/bin/health_ingestion /data --metrics-port 9090
 
 echo "🎉 Ingestion completed successfully!"
 echo "📊 Final vector database status:"
@@ -0,0 +1,321 @@
+#include "spill_store.hpp"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <queue>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr size_t kIoBufferSize = 1 << 20;     // 1 MiB for each run being written
+constexpr size_t kMergeBufferSize = 1 << 18;  // 256 KiB for each run being merged
+
+// Runs open at once in one merge pass; more runs than this are merged in several
+// passes through intermediate runs, so merge memory and fds stay bounded
+constexpr size_t kMaxMergeFanIn = 64;
+
+// Node, bucket and DayData overhead of one unordered_map entry
+constexpr size_t kEntryOverhead = sizeof(DayData) + sizeof(std::string) + 4 * sizeof(void*);
+
+void writeU32(std::ostream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool readU32(std::istream& in, uint32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+void writeString(std::ostream& out, const std::string& value) {
+    writeU32(out, static_cast<uint32_t>(value.size()));
+    out.write(value.data(), value.size());
+}
+
+bool readString(std::istream& in, std::string& value) {
+    uint32_t size = 0;
+    if (!readU32(in, size)) return false;
+    value.resize(size);
+    return static_cast<bool>(in.read(value.data(), size));
+}
+
+// Symbol ids are local to the process that interned them (runs from forked workers
+// are merged elsewhere), so symbols travel as their text and are interned again
+void writeSymbol(std::ostream& out, Symbol id) {
+    writeString(out, symbols().name(id));
+}
+
+bool readSymbol(std::istream& in, Symbol& id) {
+    std::string text;
+    if (!readString(in, text)) return false;
+    id = symbols().intern(text);
+    return true;
+}
+
+// A record is written as its bytes followed by the text of its symbol fields
+template <class Record>
+void writeRecord(std::ostream& out, const Record& record) {
+    static_assert(std::is_trivially_copyable_v<Record>, "records are written as bytes");
+    out.write(reinterpret_cast<const char*>(&record), sizeof(Record));
+    for (size_t i = 0; i < Record::kFieldCount; ++i) {
+        if (record.fields.kind(i) == FieldKind::Symbol) writeSymbol(out, record.fields.symbol(i));
+    }
+}
+
+template <class Record>
+bool readRecord(std::istream& in, Record& record) {
+    if (!in.read(reinterpret_cast<char*>(&record), sizeof(Record))) return false;
+    for (size_t i = 0; i < Record::kFieldCount; ++i) {
+        if (record.fields.kind(i) != FieldKind::Symbol) continue;
+        Symbol id;
+        if (!readSymbol(in, id)) return false;
+        record.fields.setSymbol(i, id);
+    }
+    return true;
+}
+
+// One writer and reader per store kind. Readers fold what they read into the store
+// with append(), so partials from several runs combine in place.
+template <class Record>
+void writeStore(std::ostream& out, const RecordList<Record>& store) {
+    writeU32(out, static_cast<uint32_t>(store.records.size()));
+    for (const auto& record : store.records) {
+        writeRecord(out, record);
+    }
+}
+
+template <class Record>
+bool readStore(std::istream& in, RecordList<Record>& store) {
+    uint32_t count = 0;
+    if (!readU32(in, count)) return false;
+    for (uint32_t r = 0; r < count; ++r) {
+        Record record;
+        if (!readRecord(in, record)) return false;
+        store.records.push_back(record);
+    }
+    return true;
+}
+
+template <class Record>
+void writeStore(std::ostream& out, const LatestRecord<Record>& store) {
+    writeRecord(out, store.latest);
+}
+
+template <class Record>
+bool readStore(std::istream& in, LatestRecord<Record>& store) {
+    LatestRecord<Record> later;
+    if (!readRecord(in, later.latest)) return false;
+    store.append(std::move(later));
+    return true;
+}
+
+template <class Record, size_t Field>
+void writeStore(std::ostream& out, const NumericSeries<Record, Field>& store) {
+    writeU32(out, static_cast<uint32_t>(store.values.size()));
+    out.write(reinterpret_cast<const char*>(store.values.data()), store.values.size() * sizeof(double));
+}
+
+template <class Record, size_t Field>
+bool readStore(std::istream& in, NumericSeries<Record, Field>& store) {
+    uint32_t count = 0;
+    if (!readU32(in, count)) return false;
+    size_t offset = store.values.size();
+    store.values.resize(offset + count);
+    return static_cast<bool>(
+        in.read(reinterpret_cast<char*>(store.values.data() + offset), count * sizeof(double)));
+}
+
+// The stores in registry order, then the totals
+void writeDayData(std::ostream& out, const DayData& data) {
+    RecordTypes::forEach([&](auto tag) {
+        using Record = typename decltype(tag)::type;
+        writeStore(out, data.store<Record>());
+    });
+    out.write(reinterpret_cast<const char*>(&data.totals), sizeof(DailyTotals));
+}
+
+bool readDayData(std::istream& in, DayData& data) {
+    bool ok = true;
+    RecordTypes::forEach([&](auto tag) {
+        using Record = typename decltype(tag)::type;
+        ok = ok && readStore(in, data.store<Record>());
+    });
+    DailyTotals totals;
+    if (!ok || !in.read(reinterpret_cast<char*>(&totals), sizeof(DailyTotals))) {
+        return false;
+    }
+    data.totals.merge(totals);
+    return true;
+}
+
+// Sequential cursor over one sorted run file
+struct RunReader {
+    std::vector<char> buffer;
+    std::ifstream in;
+    std::string key;
+    size_t index;
+
+    RunReader(const std::string& path, size_t run_index)
+        : buffer(kMergeBufferSize), index(run_index) {
+        in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        in.open(path, std::ios::binary);
+    }
+
+    bool nextKey() { return readString(in, key); }
+};
+
+// Appends (key, day) entries to a new run file; keys must arrive sorted
+class RunWriter {
+public:
+    explicit RunWriter(const std::string& path) : path_(path), buffer_(kIoBufferSize) {
+        out_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+        out_.open(path, std::ios::binary | std::ios::trunc);
+        if (!out_.is_open()) {
+            throw std::runtime_error("Could not create run file " + path);
+        }
+    }
+
+    void add(const std::string& key, const DayData& data) {
+        writeString(out_, key);
+        writeDayData(out_, data);
+    }
+
+    void close() {
+        out_.close();
+        if (!out_) {
+            throw std::runtime_error("Failed writing run file " + path_);
+        }
+    }
+
+private:
+    std::string path_;
+    std::vector<char> buffer_;
+    std::ofstream out_;
+};
+
+// One k-way pass over runs[first, last)
+void mergePass(const std::vector<std::string>& runs, size_t first, size_t last, const DayVisitor& visit) {
+    std::vector<std::unique_ptr<RunReader>> readers;
+    readers.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+        readers.push_back(std::make_unique<RunReader>(runs[i], i));
+        if (!readers.back()->in.is_open()) {
+            throw std::runtime_error("Could not open run file " + runs[i]);
+        }
+    }
+
+    // Min-heap on (key, run index): equal keys pop in run order
+    auto greater = [](const RunReader* a, const RunReader* b) {
+        int cmp = a->key.compare(b->key);
+        return cmp != 0 ? cmp > 0 : a->index > b->index;
+    };
+    std::priority_queue<RunReader*, std::vector<RunReader*>, decltype(greater)> heap(greater);
+    for (auto& reader : readers) {
+        if (reader->nextKey()) heap.push(reader.get());
+    }
+
+    std::string key;
+    DayData merged;
+    while (!heap.empty()) {
+        key = heap.top()->key;
+        merged = DayData();
+        while (!heap.empty() && heap.top()->key == key) {
+            RunReader* reader = heap.top();
+            heap.pop();
+            if (!readDayData(reader->in, merged)) {
+                throw std::runtime_error("Truncated run file " + runs[reader->index]);
+            }
+            if (reader->nextKey()) heap.push(reader);
+        }
+        visit(key, merged);
+    }
+}
+
+// Removes intermediate runs however the merge ends
+struct TemporaryRuns {
+    std::vector<std::string> paths;
+
+    ~TemporaryRuns() {
+        for (const auto& path : paths) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+};
+
+} // namespace
+
+size_t approxEntryBytes(const std::string& key) {
+    return kEntryOverhead + key.capacity();
+}
+
+size_t writeSortedRun(const std::string& path, const DayMap& day_map) {
+    std::vector<DayMap::const_iterator> entries;
+    entries.reserve(day_map.size());
+    for (auto it = day_map.begin(); it != day_map.end(); ++it) {
+        entries.push_back(it);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return a->first < b->first; });
+
+    RunWriter writer(path);
+    for (const auto& it : entries) {
+        writer.add(it->first, it->second);
+    }
+    writer.close();
+    return entries.size();
+}
+
+void mergeRuns(const std::vector<std::string>& runs, const DayVisitor& visit) {
+    // Merging consecutive groups keeps every key's partials in run order
+    std::vector<std::string> level = runs;
+    TemporaryRuns temporaries;
+    while (level.size() > kMaxMergeFanIn) {
+        std::vector<std::string> next;
+        for (size_t first = 0; first < level.size(); first += kMaxMergeFanIn) {
+            size_t last = std::min(first + kMaxMergeFanIn, level.size());
+            if (last - first == 1) {
+                next.push_back(level[first]);
+                continue;
+            }
+            std::string path = level[first] + ".merged";
+            temporaries.paths.push_back(path);
+            RunWriter writer(path);
+            mergePass(level, first, last, [&](const std::string& key, DayData& data) {
+                writer.add(key, data);
+            });
+            writer.close();
+            next.push_back(path);
+        }
+        level.swap(next);
+    }
+    mergePass(level, 0, level.size(), visit);
+}
+
+SpillStore::SpillStore(const std::string& spill_dir)
+    : spill_dir_(spill_dir.empty() ? std::filesystem::temp_directory_path().string() : spill_dir) {
+    std::filesystem::create_directories(spill_dir_);
+}
+
+SpillStore::~SpillStore() {
+    for (const auto& run : runs_) {
+        std::error_code ec;
+        std::filesystem::remove(run, ec);
+    }
+}
+
+void SpillStore::spill(DayMap& day_map) {
+    std::string path = spill_dir_ + "/health_spill_" + std::to_string(getpid()) + "_" +
+                       std::to_string(runs_.size()) + ".run";
+    size_t written = writeSortedRun(path, day_map);
+    std::cout << "Spilled " << written << " user-days to " << path << std::endl;
+    runs_.push_back(path);
+    day_map.clear();
+}
+
+} // namespace health_ingestion
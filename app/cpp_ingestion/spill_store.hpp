@@ -0,0 +1,47 @@
+#pragma once
+
+#include "health_processor.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace health_ingestion {
+
+// Approximate heap footprint of accumulator entries, used to enforce --memory-budget
+size_t approxEntryBytes(const std::string& key);
+
+// The visited DayData may be moved from; it is reset before the next key
+using DayVisitor = std::function<void(const std::string& key, DayData& data)>;
+
+// Writes day_map to path as a run sorted by key; returns the number of entries written
+size_t writeSortedRun(const std::string& path, const DayMap& day_map);
+
+// K-way merges sorted runs, visiting each key once with the concatenation of its partials.
+// Partials are combined in `runs` order so record order within a day is kept. At most 64
+// runs are open at once; beyond that, groups are first merged into intermediate runs
+// written next to them and removed afterwards.
+void mergeRuns(const std::vector<std::string>& runs, const DayVisitor& visit);
+
+// External-memory store for the user-day accumulator.
+// Each spill() writes the map as a run sorted by (user_id, date) and clears it;
+// merge() k-way merges all runs so every user-day is emitted exactly once.
+class SpillStore {
+public:
+    explicit SpillStore(const std::string& spill_dir);
+    ~SpillStore();
+
+    SpillStore(const SpillStore&) = delete;
+    SpillStore& operator=(const SpillStore&) = delete;
+
+    void spill(DayMap& day_map);
+    size_t runCount() const { return runs_.size(); }
+
+    // Visits every key in sorted order with its partials merged in spill order
+    void merge(const DayVisitor& visit) { mergeRuns(runs_, visit); }
+
+private:
+    std::string spill_dir_;
+    std::vector<std::string> runs_;
+};
+
+} // namespace health_ingestion
@@ -0,0 +1,106 @@
+#include "stage_profile.hpp"
+#include <fstream>
+#include <filesystem>
+#include <ctime>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace health_ingestion {
+
+namespace {
+
+json stageJson(const StageTimes& times) {
+    json stages = json::object();
+    for (size_t i = 0; i < static_cast<size_t>(Stage::Count); ++i) {
+        if (times.items[i] == 0) continue;
+        stages[stageName(static_cast<Stage>(i))] = {
+            {"seconds", static_cast<double>(times.nanos[i]) / 1e9},
+            {"count", times.items[i]},
+            {"avg_us", static_cast<double>(times.nanos[i]) / 1e3 / static_cast<double>(times.items[i])}
+        };
+    }
+    return stages;
+}
+
+} // namespace
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Read: return "read";
+        case Stage::Parse: return "parse";
+        case Stage::DateExtract: return "date_extraction";
+        case Stage::Aggregate: return "aggregation";
+        case Stage::Summarise: return "summary_formatting";
+        case Stage::EmbedCache: return "embedding_cache";
+        case Stage::Embed: return "embedding";
+        case Stage::Serialise: return "json_serialisation";
+        case Stage::Send: return "http_send";
+        case Stage::Count: break;
+    }
+    return "unknown";
+}
+
+void StageTimes::merge(const StageTimes& other) {
+    for (size_t i = 0; i < nanos.size(); ++i) {
+        nanos[i] += other.nanos[i];
+        items[i] += other.items[i];
+    }
+}
+
+void StageProfile::add(const std::string& file, const StageTimes& times) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_[file].merge(times);
+}
+
+StageTimes StageProfile::totals() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StageTimes total;
+    for (const auto& [file, times] : files_) {
+        total.merge(times);
+    }
+    return total;
+}
+
+std::string StageProfile::toJson(double wall_seconds, size_t records, size_t threads) const {
+    std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    json report = {
+        {"finished_at", timestamp},
+        {"wall_seconds", wall_seconds},
+        {"records", records},
+        {"threads", threads},
+        {"records_per_second", wall_seconds > 0 ? static_cast<double>(records) / wall_seconds : 0.0},
+        {"stages", stageJson(totals())},
+        {"files", json::object()}
+    };
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [file, times] : files_) {
+        report["files"][file] = stageJson(times);
+    }
+    return report.dump(2);
+}
+
+bool StageProfile::appendCsv(const std::string& path, const std::string& prefix, double wall_seconds) const {
+    bool exists = std::filesystem::exists(path);
+    std::ofstream out(path, std::ios::app);
+    if (!out.is_open()) {
+        return false;
+    }
+    if (!exists) {
+        out << "Test,Duration(seconds)\n";  // Same header as benchmark.sh
+    }
+
+    StageTimes total = totals();
+    for (size_t i = 0; i < static_cast<size_t>(Stage::Count); ++i) {
+        if (total.items[i] == 0) continue;
+        out << prefix << "_" << stageName(static_cast<Stage>(i)) << ","
+            << static_cast<double>(total.nanos[i]) / 1e9 << "\n";
+    }
+    out << prefix << "_total," << wall_seconds << "\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace health_ingestion {
+
+enum class Stage {
+    Read,          // File I/O inside the record scanner
+    Parse,         // json::parse of each record
+    DateExtract,   // extractDate()
+    Aggregate,     // Typed field read (parseRecord) and accumulator insert; no text yet
+    Summarise,     // createSummary()
+    EmbedCache,    // Embedding cache lookups (--embed-cache)
+    Embed,         // In-process sentence embedding (--embed-model)
+    Serialise,     // /ingest payload construction
+    Send,          // Output sink delivery (HTTP round trips, file writes)
+    Count
+};
+
+const char* stageName(Stage stage);
+
+// Time and item count per stage, summed over every thread that did the work
+struct StageTimes {
+    std::array<uint64_t, static_cast<size_t>(Stage::Count)> nanos{};
+    std::array<uint64_t, static_cast<size_t>(Stage::Count)> items{};
+
+    void add(Stage stage, uint64_t elapsed_nanos, uint64_t count = 1) {
+        nanos[static_cast<size_t>(stage)] += elapsed_nanos;
+        items[static_cast<size_t>(stage)] += count;
+    }
+    void merge(const StageTimes& other);
+};
+
+// Adds the lifetime of the scope to one stage of a thread-local StageTimes
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(StageTimes& times, Stage stage)
+        : times_(times), stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        times_.add(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+private:
+    StageTimes& times_;
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Per-file and per-stage breakdown of one run.
+// Input stages are attributed to their file; output stages to the pseudo-file "(output)".
+class StageProfile {
+public:
+    void add(const std::string& file, const StageTimes& times);
+
+    StageTimes totals() const;
+
+    // JSON document with run totals, per-stage totals and the per-file breakdown
+    std::string toJson(double wall_seconds, size_t records, size_t threads) const;
+
+    // Appends "<prefix>_<stage>,<seconds>" rows (plus "<prefix>_total") to a benchmark CSV
+    bool appendCsv(const std::string& path, const std::string& prefix, double wall_seconds) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, StageTimes> files_;
+};
+
+} // namespace health_ingestion
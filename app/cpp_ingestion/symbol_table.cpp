@@ -0,0 +1,77 @@
+#include "symbol_table.hpp"
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+namespace health_ingestion {
+
+namespace {
+
+std::atomic<uint64_t> next_serial{1};
+
+// Per-thread front of one table's map
+struct LocalCache {
+    uint64_t serial = 0;
+    std::unordered_map<std::string, Symbol> ids;
+    std::string key;   // Reused lookup buffer
+};
+
+thread_local LocalCache local_cache;
+
+} // namespace
+
+SymbolTable::SymbolTable() : serial_(next_serial.fetch_add(1, std::memory_order_relaxed)) {
+    for (auto& chunk : chunks_) chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+SymbolTable::~SymbolTable() {
+    for (auto& chunk : chunks_) delete[] chunk.load(std::memory_order_relaxed);
+}
+
+Symbol SymbolTable::add(std::string name, std::string quoted) {
+    size_t id = size_.load(std::memory_order_relaxed);
+    if (id >= kChunks * kChunkSize) {
+        throw std::length_error("symbol table is full (" + std::to_string(id) + " values)");
+    }
+    Entry* chunk = chunks_[id / kChunkSize].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Entry[kChunkSize];
+        chunks_[id / kChunkSize].store(chunk, std::memory_order_release);
+    }
+    chunk[id % kChunkSize] = {std::move(name), std::move(quoted)};
+    size_.store(id + 1, std::memory_order_release);
+    return static_cast<Symbol>(id);
+}
+
+Symbol SymbolTable::intern(std::string_view text) {
+    LocalCache& cache = local_cache;
+    if (cache.serial != serial_) {
+        cache.ids.clear();
+        cache.serial = serial_;
+    }
+    cache.key.assign(text);
+    auto hit = cache.ids.find(cache.key);
+    if (hit != cache.ids.end()) return hit->second;
+
+    Symbol id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string name(text);
+        auto it = strings_.find(name);
+        if (it != strings_.end()) {
+            id = it->second;
+        } else {
+            std::string quoted = nlohmann::json(name).dump();
+            id = add(name, std::move(quoted));
+            strings_.emplace(std::move(name), id);
+        }
+    }
+    cache.ids.emplace(cache.key, id);
+    return id;
+}
+
+SymbolTable& symbols() {
+    static SymbolTable table;
+    return table;
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace health_ingestion {
+
+// Small integer id of an interned categorical value (activity type, meal type, ...)
+using Symbol = uint32_t;
+
+// Process-wide dictionary for the low-cardinality string fields of the input records.
+// Each distinct value is stored once, with its raw text and its JSON rendering (quoted
+// and escaped, as nlohmann streams it), so records can carry a 4-byte id, compare
+// categories as integers and render them without re-escaping.
+//
+// Ids are dense and never reused. Lookups by id are lock-free; interning checks a
+// per-thread cache first and only takes the table's mutex for values the thread has
+// not seen, so parallel parse threads do not contend once the vocabulary is warm.
+class SymbolTable {
+public:
+    SymbolTable();
+    ~SymbolTable();
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    Symbol intern(std::string_view text);
+
+    const std::string& name(Symbol id) const { return entry(id).name; }
+    const std::string& quoted(Symbol id) const { return entry(id).quoted; }
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+
+    static constexpr size_t kChunkSize = 4096;
+    static constexpr size_t kChunks = 256;   // At most 1M distinct values
+
+private:
+    struct Entry {
+        std::string name;
+        std::string quoted;
+    };
+
+    const Entry& entry(Symbol id) const {
+        return chunks_[id / kChunkSize].load(std::memory_order_acquire)[id % kChunkSize];
+    }
+    // Appends a new entry; caller holds mutex_
+    Symbol add(std::string name, std::string quoted);
+
+    const uint64_t serial_;   // Tells this table's thread-local cache entries from another's
+    std::mutex mutex_;
+    std::unordered_map<std::string, Symbol> strings_;
+    std::array<std::atomic<Entry*>, kChunks> chunks_;
+    std::atomic<size_t> size_{0};
+};
+
+// The table shared by the whole process
+SymbolTable& symbols();
+
+} // namespace health_ingestion
@@ -0,0 +1,155 @@
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr size_t kNoWorker = static_cast<size_t>(-1);
+
+// Identifies the scheduler worker (if any) running on this thread
+thread_local const TaskScheduler* tls_scheduler = nullptr;
+thread_local size_t tls_worker = kNoWorker;
+
+} // namespace
+
+TaskScheduler::TaskScheduler(size_t threads)
+    : queued_(0)
+    , next_queue_(0)
+    , stopping_(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // The thread calling parallelFor() is the last participant
+    for (size_t i = 0; i + 1 < threads; ++i) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        workers_.emplace_back(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void TaskScheduler::submit(Task task) {
+    if (queues_.empty()) {
+        task();
+        return;
+    }
+
+    // Workers keep their own subtasks local; outside callers spread round-robin
+    size_t index = (tls_scheduler == this) ? tls_worker
+                                           : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        // Pairs with the predicate check in workerLoop so a wakeup cannot be lost
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool TaskScheduler::popLocal(size_t index, Task& task) {
+    WorkerQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool TaskScheduler::steal(size_t thief, Task& task) {
+    size_t count = queues_.size();
+    size_t start = (thief == kNoWorker) ? next_queue_.load(std::memory_order_relaxed) : thief + 1;
+    for (size_t i = 0; i < count; ++i) {
+        size_t victim = (start + i) % count;
+        if (victim == thief) continue;
+        WorkerQueue& queue = *queues_[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool TaskScheduler::runOne(size_t home) {
+    Task task;
+    bool found = (home != kNoWorker && popLocal(home, task)) || steal(home, task);
+    if (!found) return false;
+    queued_.fetch_sub(1, std::memory_order_acq_rel);
+    task();
+    return true;
+}
+
+void TaskScheduler::workerLoop(size_t index) {
+    tls_scheduler = this;
+    tls_worker = index;
+    while (true) {
+        if (runOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load(std::memory_order_acquire) > 0; });
+        if (stopping_ && queued_.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+void TaskScheduler::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+    if (queues_.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    // This state lives on our stack: a task's last touch of it is the decrement and
+    // notify, made under done_mutex, and we only return after seeing the count reach
+    // zero under the same lock
+    std::atomic<size_t> remaining(count);
+    std::mutex done_mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+
+    for (size_t i = 0; i < count; ++i) {
+        submit([&, i] {
+            std::exception_ptr failure;
+            try {
+                body(i);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (failure && !error) error = failure;
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) done.notify_all();
+        });
+    }
+
+    // Help out instead of blocking; fall back to a short wait when nothing is left to steal
+    size_t home = (tls_scheduler == this) ? tls_worker : kNoWorker;
+    while (true) {
+        if (remaining.load(std::memory_order_acquire) > 0 && runOne(home)) continue;
+        std::unique_lock<std::mutex> lock(done_mutex);
+        if (done.wait_for(lock, std::chrono::milliseconds(1),
+                          [&] { return remaining.load(std::memory_order_relaxed) == 0; })) {
+            break;
+        }
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
+} // namespace health_ingestion
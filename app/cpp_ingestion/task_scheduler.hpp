@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace health_ingestion {
+
+// Work-stealing task scheduler shared by the parse, summarise and serialise stages.
+//
+// Each worker owns a deque: it pushes and pops its own tasks at the back (LIFO, so
+// freshly split work stays in cache) and idle workers steal from the front of other
+// deques (FIFO, taking the oldest and usually largest work). A scheduler of size 1
+// has no threads and runs everything inline on the caller.
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    // threads == 0 uses std::thread::hardware_concurrency()
+    explicit TaskScheduler(size_t threads = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Total parallelism, counting the calling thread that helps in parallelFor()
+    size_t concurrency() const { return workers_.size() + 1; }
+
+    void submit(Task task);
+
+    template <typename Fn>
+    auto async(Fn&& fn) -> std::future<decltype(fn())> {
+        using Result = decltype(fn());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> result = task->get_future();
+        submit([task] { (*task)(); });
+        return result;
+    }
+
+    // Runs body(i) for every i in [0, count) and returns when all have finished.
+    // The caller executes tasks while waiting; the first exception is rethrown.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+    bool runOne(size_t home);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> next_queue_;
+    bool stopping_;
+};
+
+} // namespace health_ingestion
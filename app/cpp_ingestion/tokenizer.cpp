@@ -0,0 +1,366 @@
+#include "tokenizer.hpp"
+#include "task_scheduler.hpp"
+#include "unicode_tables.hpp"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+
+namespace health_ingestion {
+
+namespace {
+
+// BERT gives up on words longer than this and emits [UNK]
+constexpr size_t kMaxWordChars = 100;
+
+// Precomposed Hangul syllables
+constexpr uint32_t kHangulFirst = 0xAC00;
+constexpr uint32_t kHangulLast = 0xD7A3;
+
+bool decodeUtf8(const std::string& text, size_t& pos, uint32_t& cp) {
+    unsigned char c = static_cast<unsigned char>(text[pos]);
+    int extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : -1;
+    if (extra < 0 || pos + extra >= text.size() + (extra == 0 ? 1 : 0)) {
+        ++pos;
+        return false;
+    }
+    cp = extra == 0 ? c : c & (0x3F >> extra);
+    for (int i = 1; i <= extra; ++i) {
+        unsigned char next = static_cast<unsigned char>(text[pos + i]);
+        if ((next & 0xC0) != 0x80) {
+            ++pos;
+            return false;
+        }
+        cp = (cp << 6) | (next & 0x3F);
+    }
+    pos += extra + 1;
+    return true;
+}
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+// White_Space characters; the other C0 controls are dropped as control characters
+bool isWhitespace(uint32_t cp) {
+    return cp == ' ' || cp == '\t' || cp == '\n' || cp == '\r' || cp == 0x00A0 || cp == 0x1680 ||
+           (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 || cp == 0x2029 || cp == 0x202F || cp == 0x205F ||
+           cp == 0x3000;
+}
+
+bool isControl(uint32_t cp) {
+    return cp < 0x80 ? (cp < 0x20 || cp == 0x7F) && !isWhitespace(cp) : unicode::isControl(cp);
+}
+
+bool isPunctuation(uint32_t cp) {
+    // All non-alphanumeric ASCII counts, as in BERT, plus Unicode category P*
+    if (cp < 0x80) {
+        return (cp >= 33 && cp <= 47) || (cp >= 58 && cp <= 64) || (cp >= 91 && cp <= 96) || (cp >= 123 && cp <= 126);
+    }
+    return unicode::isPunctuation(cp);
+}
+
+bool isCjk(uint32_t cp) {
+    return (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF) || (cp >= 0x20000 && cp <= 0x2A6DF) ||
+           (cp >= 0x2A700 && cp <= 0x2B73F) || (cp >= 0x2B740 && cp <= 0x2B81F) || (cp >= 0x2B820 && cp <= 0x2CEAF) ||
+           (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0x2F800 && cp <= 0x2FA1F);
+}
+
+// Fast path for ASCII bytes: how basic tokenisation treats each one
+enum class AsciiClass : uint8_t { Drop, Space, Punct, Word };
+
+struct AsciiTable {
+    std::array<AsciiClass, 128> kind{};
+    std::array<char, 128> lower{};
+
+    AsciiTable() {
+        for (uint32_t c = 0; c < 128; ++c) {
+            lower[c] = static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+            if (isWhitespace(c)) kind[c] = AsciiClass::Space;
+            else if (c == 0 || isControl(c)) kind[c] = AsciiClass::Drop;
+            else if (isPunctuation(c)) kind[c] = AsciiClass::Punct;
+            else kind[c] = AsciiClass::Word;
+        }
+    }
+};
+
+const AsciiTable kAscii;
+
+// Basic tokenisation: calls on_word(word) for each word in order until it returns false.
+// `word` is a scratch buffer reused between words.
+template <typename OnWord>
+void splitWords(const std::string& text, std::string& word, OnWord&& on_word) {
+    word.clear();
+    auto endWord = [&] {
+        if (word.empty()) return true;
+        bool more = on_word(word);
+        word.clear();
+        return more;
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[pos]);
+        if (c < 0x80) {
+            ++pos;
+            switch (kAscii.kind[c]) {
+                case AsciiClass::Drop:
+                    break;
+                case AsciiClass::Space:
+                    if (!endWord()) return;
+                    break;
+                case AsciiClass::Punct:
+                    if (!endWord()) return;
+                    word.push_back(static_cast<char>(c));
+                    if (!endWord()) return;
+                    break;
+                case AsciiClass::Word:
+                    word.push_back(kAscii.lower[c]);
+                    break;
+            }
+            continue;
+        }
+
+        uint32_t cp;
+        if (!decodeUtf8(text, pos, cp) || cp == 0xFFFD || isControl(cp)) continue;
+        if (isWhitespace(cp)) {
+            if (!endWord()) return;
+            continue;
+        }
+        if (unicode::isMark(cp)) continue;  // Accents left after NFD
+        if (cp >= kHangulFirst && cp <= kHangulLast) {
+            // NFD splits precomposed Hangul into its leading, vowel and trailing jamo
+            uint32_t index = cp - kHangulFirst;
+            appendUtf8(word, 0x1100 + index / 588);
+            appendUtf8(word, 0x1161 + (index % 588) / 28);
+            if (index % 28 != 0) appendUtf8(word, 0x11A7 + index % 28);
+            continue;
+        }
+        cp = unicode::fold(cp);
+        if (isPunctuation(cp) || isCjk(cp)) {
+            if (!endWord()) return;
+            appendUtf8(word, cp);
+            if (!endWord()) return;
+            continue;
+        }
+        appendUtf8(word, cp);
+    }
+    endWord();
+}
+
+} // namespace
+
+void DoubleArrayTrie::build(std::vector<std::pair<std::string, int32_t>> keys) {
+    // Sorted, without empty keys; for duplicates the last id wins, as in the reference
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<std::pair<std::string, int32_t>> unique;
+    unique.reserve(keys.size());
+    for (auto& key : keys) {
+        if (key.first.empty()) continue;
+        if (!unique.empty() && unique.back().first == key.first) {
+            unique.back().second = key.second;
+        } else {
+            unique.push_back(std::move(key));
+        }
+    }
+
+    units_.assign(256, Unit());
+    units_[0].check = -2;  // Root; never free
+    size_t search_from = 1;
+    insert(unique, 0, unique.size(), 0, 0, search_from);
+
+    // Padding so base + byte never runs off the end and lookups need no bounds check
+    int32_t max_base = 0;
+    for (const Unit& unit : units_) max_base = std::max(max_base, unit.base);
+    units_.resize(std::max(units_.size(), static_cast<size_t>(max_base) + 256));
+}
+
+void DoubleArrayTrie::insert(const std::vector<std::pair<std::string, int32_t>>& keys, size_t begin,
+                             size_t end, size_t depth, int32_t node, size_t& search_from) {
+    // Keys in [begin, end) share their first `depth` bytes; a key of exactly that
+    // length sorts first and ends at this node
+    if (begin < end && keys[begin].first.size() == depth) {
+        units_[node].value = keys[begin].second;
+        ++begin;
+    }
+    if (begin == end) return;
+
+    // Child bytes with their key ranges
+    std::vector<std::pair<unsigned char, size_t>> children;  // (byte, range start)
+    for (size_t i = begin; i < end; ++i) {
+        unsigned char c = static_cast<unsigned char>(keys[i].first[depth]);
+        if (children.empty() || children.back().first != c) children.emplace_back(c, i);
+    }
+
+    // First base at which every child slot is free. Candidates only come from free
+    // slots for the first child; once the scanned region is nearly full, later
+    // searches start past it (the darts heuristic) instead of rescanning it each time
+    while (search_from < units_.size() && units_[search_from].check != -1) ++search_from;
+    size_t slot = std::max(search_from, static_cast<size_t>(children.front().first) + 1);
+    size_t occupied = 0;
+    size_t base = 0;
+    while (true) {
+        base = slot - children.front().first;
+        if (base + 256 > units_.size()) units_.resize(std::max(units_.size() * 2, base + 256));
+        if (units_[slot].check != -1) {
+            ++occupied;
+            ++slot;
+            continue;
+        }
+        bool fits = true;
+        for (const auto& child : children) {
+            if (units_[base + child.first].check != -1) {
+                fits = false;
+                break;
+            }
+        }
+        if (fits) break;
+        ++slot;
+    }
+    if (occupied * 20 >= (slot - search_from + 1) * 19) search_from = slot;
+
+    units_[node].base = static_cast<int32_t>(base);
+    for (const auto& child : children) {
+        units_[base + child.first].check = node;
+    }
+    for (size_t i = 0; i < children.size(); ++i) {
+        size_t child_end = i + 1 < children.size() ? children[i + 1].second : end;
+        insert(keys, children[i].second, child_end, depth + 1,
+               static_cast<int32_t>(base + children[i].first), search_from);
+    }
+}
+
+int32_t DoubleArrayTrie::longestPrefix(const char* text, size_t len, size_t& match_len) const {
+    int32_t best = -1;
+    int32_t node = 0;
+    const Unit* units = units_.data();
+    for (size_t i = 0; i < len; ++i) {
+        int32_t next = units[node].base + static_cast<unsigned char>(text[i]);
+        if (units[next].check != node) break;
+        node = next;
+        if (units[node].value >= 0) {
+            best = units[node].value;
+            match_len = i + 1;
+        }
+    }
+    return best;
+}
+
+bool WordPieceTokenizer::load(const std::string& vocab_path) {
+    std::ifstream file(vocab_path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open vocabulary " << vocab_path << std::endl;
+        return false;
+    }
+    tokens_.clear();
+    std::string token;
+    while (std::getline(file, token)) {
+        if (!token.empty() && token.back() == '\r') token.pop_back();
+        tokens_.push_back(token);
+    }
+
+    std::vector<std::pair<std::string, int32_t>> initial;
+    std::vector<std::pair<std::string, int32_t>> continuation;
+    bool found_cls = false, found_sep = false, found_unk = false;
+    for (size_t i = 0; i < tokens_.size(); ++i) {
+        const std::string& piece = tokens_[i];
+        int32_t id = static_cast<int32_t>(i);
+        if (piece.compare(0, 2, "##") == 0) {
+            continuation.emplace_back(piece.substr(2), id);
+        } else {
+            initial.emplace_back(piece, id);
+        }
+        if (piece == "[CLS]") { cls_id_ = id; found_cls = true; }
+        if (piece == "[SEP]") { sep_id_ = id; found_sep = true; }
+        if (piece == "[UNK]") { unk_id_ = id; found_unk = true; }
+    }
+    if (!found_cls || !found_sep || !found_unk) {
+        std::cerr << "Vocabulary " << vocab_path << " lacks [CLS], [SEP] or [UNK]" << std::endl;
+        return false;
+    }
+    initial_.build(std::move(initial));
+    continuation_.build(std::move(continuation));
+    return true;
+}
+
+std::vector<std::string> WordPieceTokenizer::basicTokenize(const std::string& text) const {
+    std::vector<std::string> words;
+    std::string word;
+    splitWords(text, word, [&](const std::string& w) {
+        words.push_back(w);
+        return true;
+    });
+    return words;
+}
+
+void WordPieceTokenizer::wordPiece(const std::string& word, std::vector<int32_t>& ids) const {
+    // Character count for the length limit
+    size_t chars = 0;
+    for (unsigned char c : word) chars += (c & 0xC0) != 0x80;
+    if (chars > kMaxWordChars) {
+        ids.push_back(unk_id_);
+        return;
+    }
+
+    // Greedy longest match from the left; a word with any unmatched remainder is [UNK]
+    size_t mark = ids.size();
+    size_t start = 0;
+    while (start < word.size()) {
+        const DoubleArrayTrie& trie = start == 0 ? initial_ : continuation_;
+        size_t length = 0;
+        int32_t id = trie.longestPrefix(word.data() + start, word.size() - start, length);
+        if (id < 0) {
+            ids.resize(mark);
+            ids.push_back(unk_id_);
+            return;
+        }
+        ids.push_back(id);
+        start += length;
+    }
+}
+
+std::vector<int32_t> WordPieceTokenizer::encode(const std::string& text, size_t max_tokens) const {
+    std::vector<int32_t> ids;
+    ids.reserve(std::min<size_t>(max_tokens, text.size() / 3 + 2));
+    ids.push_back(cls_id_);
+    std::string word;
+    splitWords(text, word, [&](const std::string& w) {
+        wordPiece(w, ids);
+        return ids.size() < max_tokens - 1;
+    });
+    if (ids.size() > max_tokens - 1) ids.resize(max_tokens - 1);
+    ids.push_back(sep_id_);
+    return ids;
+}
+
+std::vector<std::vector<int32_t>> WordPieceTokenizer::encodeBatch(const std::vector<std::string>& texts,
+                                                                  size_t max_tokens,
+                                                                  TaskScheduler& scheduler) const {
+    // Chunks of texts per task keep scheduling overhead small next to a few microseconds per text
+    constexpr size_t kChunk = 64;
+    std::vector<std::vector<int32_t>> result(texts.size());
+    scheduler.parallelFor((texts.size() + kChunk - 1) / kChunk, [&](size_t chunk) {
+        size_t end = std::min(texts.size(), (chunk + 1) * kChunk);
+        for (size_t i = chunk * kChunk; i < end; ++i) {
+            result[i] = encode(texts[i], max_tokens);
+        }
+    });
+    return result;
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace health_ingestion {
+
+class TaskScheduler;
+
+// Byte-wise double-array trie mapping vocabulary strings to ids. Each step of a lookup
+// is one array access (child = base[node] + byte, valid when check[child] == node),
+// so the longest vocabulary prefix of a word is found in a single left-to-right walk.
+class DoubleArrayTrie {
+public:
+    void build(std::vector<std::pair<std::string, int32_t>> keys);
+
+    // Id of the longest key that is a prefix of [text, text + len), with its length
+    // in match_len; -1 if no key matches
+    int32_t longestPrefix(const char* text, size_t len, size_t& match_len) const;
+
+    size_t units() const { return units_.size(); }
+
+private:
+    // base, check and value side by side, so one cache line serves a whole step
+    struct Unit {
+        int32_t base = 0;
+        int32_t check = -1;   // Parent unit; -1 = free
+        int32_t value = -1;   // Token id if a key ends here
+    };
+
+    void insert(const std::vector<std::pair<std::string, int32_t>>& keys, size_t begin, size_t end,
+                size_t depth, int32_t node, size_t& search_from);
+
+    std::vector<Unit> units_;
+};
+
+// BERT uncased WordPiece tokenizer (BertTokenizer with do_lower_case=True) for the
+// all-MiniLM-L6-v2 vocabulary.
+//
+// Basic tokenisation follows the Hugging Face BertNormalizer/BertPreTokenizer: control
+// characters are dropped, text is lower-cased with accents stripped, CJK ideographs and
+// punctuation become words of their own, and the rest is split on whitespace. The
+// character classes come from unicode_tables.cpp; lower-casing and accent stripping
+// cover Latin, Greek, Cyrillic, Armenian, fullwidth letters and Hangul, and other
+// scripts pass through unchanged.
+//
+// WordPiece matching walks two double-array tries, one for word-initial pieces and
+// one for "##" continuations. ASCII text, which is nearly all of a summary, is
+// classified through a lookup table without UTF-8 decoding.
+class WordPieceTokenizer {
+public:
+    // Reads a vocab.txt with one token per line, ids by line number
+    bool load(const std::string& vocab_path);
+
+    // [CLS] word pieces [SEP], truncated to at most max_tokens ids
+    std::vector<int32_t> encode(const std::string& text, size_t max_tokens) const;
+
+    // encode() for many texts, split across the scheduler's threads
+    std::vector<std::vector<int32_t>> encodeBatch(const std::vector<std::string>& texts, size_t max_tokens,
+                                                  TaskScheduler& scheduler) const;
+
+    // Lower-cased, accent-stripped words before WordPiece
+    std::vector<std::string> basicTokenize(const std::string& text) const;
+
+    // Appends the WordPiece ids of one basic-tokenised word
+    void wordPiece(const std::string& word, std::vector<int32_t>& ids) const;
+
+    size_t vocabSize() const { return tokens_.size(); }
+    const std::string& token(int32_t id) const { return tokens_[static_cast<size_t>(id)]; }
+    int32_t clsId() const { return cls_id_; }
+    int32_t sepId() const { return sep_id_; }
+    int32_t unkId() const { return unk_id_; }
+
+private:
+    std::vector<std::string> tokens_;
+    DoubleArrayTrie initial_;        // Pieces that start a word
+    DoubleArrayTrie continuation_;   // "##" pieces, stored without the prefix
+    int32_t cls_id_ = 101;
+    int32_t sep_id_ = 102;
+    int32_t unk_id_ = 100;
+};
+
+} // namespace health_ingestion
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Compare health_tokenize with the Python WordPiece tokenizers.
+
+Tokenises a corpus (one text per line, or NDJSON with a "text" field) with the
+Hugging Face tokenizers used by sentence-transformers and with health_tokenize,
+checks that every text gets identical ids, and reports throughput for each:
+
+    python tokenizer_check.py --vocab models/minilm/vocab.txt summaries.ndjson
+    python tokenizer_check.py --vocab vocab.txt --binary build/health_tokenize --threads 8 corpus.txt
+
+Needs the `tokenizers` package (`pip install tokenizers`); `transformers` is
+optional and adds the pure-Python BertTokenizer to the timings (on at most
+--slow-limit texts).
+
+testdata/tokenizer holds a small vocabulary, a corpus of generated summaries and
+a Unicode stress set; ctest runs this script on both when `tokenizers` is installed.
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def read_corpus(path):
+    texts = []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("{"):
+                line = json.loads(line).get("text", "")
+            texts.append(line)
+    return texts
+
+
+def run_native(args, corpus):
+    with tempfile.NamedTemporaryFile(suffix=".ids", delete=False) as tmp:
+        ids_path = tmp.name
+    try:
+        cmd = [args.binary, "--vocab", args.vocab, "--repeat", str(args.repeat), "--ids", ids_path, corpus]
+        if args.threads:
+            cmd += ["--threads", str(args.threads)]
+        out = subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+        with open(ids_path) as f:
+            ids = [[int(x) for x in line.split()] for line in f]
+    finally:
+        os.unlink(ids_path)
+    seconds = float(re.search(r"seconds per pass: ([0-9.e+-]+)", out).group(1))
+    return ids, seconds
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("corpus")
+    parser.add_argument("--vocab", required=True)
+    parser.add_argument("--binary", default=os.path.join(os.path.dirname(__file__), "build", "health_tokenize"))
+    parser.add_argument("--threads", type=int, default=0, help="health_tokenize threads (default: CPU count)")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--slow-limit", type=int, default=2000)
+    args = parser.parse_args()
+
+    from tokenizers import BertWordPieceTokenizer
+
+    texts = read_corpus(args.corpus)
+    mb = sum(len(t.encode("utf-8")) for t in texts) / 1e6
+    print(f"Corpus: {len(texts)} texts, {mb:.2f} MB")
+
+    fast = BertWordPieceTokenizer(args.vocab, lowercase=True, clean_text=True, handle_chinese_chars=True)
+    start = time.perf_counter()
+    for _ in range(args.repeat):
+        reference = [e.ids for e in fast.encode_batch(texts)]
+    fast_seconds = (time.perf_counter() - start) / args.repeat
+
+    native, native_seconds = run_native(args, args.corpus)
+
+    rows = [("tokenizers (Rust, encode_batch)", fast_seconds, len(texts))]
+    try:
+        from transformers import BertTokenizer
+        slow = BertTokenizer(args.vocab, do_lower_case=True)
+        subset = texts[:args.slow_limit]
+        start = time.perf_counter()
+        for text in subset:
+            slow.encode(text)
+        rows.append(("transformers BertTokenizer (Python)", time.perf_counter() - start, len(subset)))
+    except ImportError:
+        pass
+    rows.append(("health_tokenize (C++)", native_seconds, len(texts)))
+
+    print(f"{'Tokenizer':<38} {'texts/s':>12} {'MB/s':>9}")
+    for name, seconds, count in rows:
+        print(f"{name:<38} {count / seconds:>12.0f} {mb * count / len(texts) / seconds:>9.2f}")
+    print(f"Speed-up over tokenizers: {fast_seconds / native_seconds:.1f}x")
+
+    mismatches = [i for i, (a, b) in enumerate(zip(reference, native)) if a != b]
+    if len(native) != len(reference):
+        print(f"FAIL: {len(native)} id lines for {len(reference)} texts")
+        return 1
+    if mismatches:
+        print(f"FAIL: {len(mismatches)} of {len(texts)} texts differ")
+        for i in mismatches[:5]:
+            print(f"  line {i + 1}: {texts[i][:80]!r}\n    python: {reference[i][:20]}\n    native: {native[i][:20]}")
+        return 1
+    print(f"OK: identical ids for all {len(texts)} texts")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,124 @@
+#include "tokenizer.hpp"
+#include "task_scheduler.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Batch WordPiece tokenisation of a corpus, for throughput measurements and for
+// checking ids against the Python tokenizer (see tokenizer_check.py)
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " --vocab <vocab.txt> [options] <corpus>\n"
+              << "  --vocab <path>       WordPiece vocabulary, one token per line\n"
+              << "  --threads <n>        Tokenizer threads (default: CPU count)\n"
+              << "  --max-tokens <n>     Truncate like the encoder (default: no limit)\n"
+              << "  --repeat <n>         Tokenise the corpus n times for timing (default: 1)\n"
+              << "  --ids <path>         Write space-separated ids, one line per text\n"
+              << "The corpus has one text per line; NDJSON lines use their \"text\" field,\n"
+              << "so --output ndjson files can be tokenised directly.\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string vocab_path;
+    std::string corpus_path;
+    std::string ids_path;
+    size_t threads = 0;
+    size_t max_tokens = std::numeric_limits<size_t>::max();
+    int repeat = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--vocab" && i + 1 < argc) {
+            vocab_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--max-tokens" && i + 1 < argc) {
+            max_tokens = std::strtoul(argv[++i], nullptr, 10);
+            if (max_tokens < 2) {
+                std::cerr << "Error: --max-tokens must be at least 2" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--ids" && i + 1 < argc) {
+            ids_path = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            corpus_path = arg;
+        }
+    }
+    if (vocab_path.empty() || corpus_path.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    health_ingestion::WordPieceTokenizer tokenizer;
+    auto load_start = std::chrono::steady_clock::now();
+    if (!tokenizer.load(vocab_path)) {
+        return 1;
+    }
+    double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+
+    std::ifstream corpus(corpus_path);
+    if (!corpus.is_open()) {
+        std::cerr << "Error: Cannot open corpus " << corpus_path << std::endl;
+        return 1;
+    }
+    std::vector<std::string> texts;
+    size_t bytes = 0;
+    std::string line;
+    while (std::getline(corpus, line)) {
+        if (!line.empty() && line.front() == '{') {
+            try {
+                line = nlohmann::json::parse(line).value("text", "");
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Bad NDJSON line " << texts.size() + 1 << ": " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        bytes += line.size();
+        texts.push_back(std::move(line));
+    }
+
+    health_ingestion::TaskScheduler scheduler(threads);
+    std::vector<std::vector<int32_t>> ids;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) {
+        ids = tokenizer.encodeBatch(texts, max_tokens, scheduler);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat;
+
+    size_t tokens = 0;
+    for (const auto& text_ids : ids) tokens += text_ids.size();
+    std::cout << "Vocabulary: " << tokenizer.vocabSize() << " tokens, loaded in " << load_seconds * 1000 << " ms\n"
+              << "Texts: " << texts.size() << " (" << bytes / 1e6 << " MB), tokens: " << tokens << "\n"
+              << "Threads: " << scheduler.concurrency() << ", seconds per pass: " << seconds << "\n"
+              << "Throughput: " << texts.size() / seconds << " texts/s, " << bytes / 1e6 / seconds << " MB/s, "
+              << tokens / seconds << " tokens/s" << std::endl;
+
+    if (!ids_path.empty()) {
+        std::ofstream out(ids_path);
+        for (const auto& text_ids : ids) {
+            for (size_t i = 0; i < text_ids.size(); ++i) {
+                if (i > 0) out << ' ';
+                out << text_ids[i];
+            }
+            out << '\n';
+        }
+        if (!out) {
+            std::cerr << "Error: Cannot write " << ids_path << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
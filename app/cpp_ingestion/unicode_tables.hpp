@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace health_ingestion {
+
+// Character classes for BERT basic tokenisation, from the tables in unicode_tables.cpp
+// (regenerate with gen_unicode_tables.py)
+namespace unicode {
+
+bool isPunctuation(uint32_t cp);  // General category P*
+bool isControl(uint32_t cp);      // Cc, Cf and Co other than tab, newline and carriage return
+bool isMark(uint32_t cp);         // Mn: combining marks, dropped when stripping accents
+
+// Base character (NFD without marks) of a precomposed character, lower-cased in every
+// script; otherwise unchanged
+uint32_t fold(uint32_t cp);
+
+} // namespace unicode
+
+} // namespace health_ingestion
@@ -0,0 +1,39 @@
+#include "user_date_index.hpp"
+#include <algorithm>
+
+namespace health_ingestion {
+
+void UserDateIndex::add(const std::string& user_id, int32_t date) {
+    const uint32_t row = static_cast<uint32_t>(dates_.size());
+    dates_.push_back(date);
+    if (user_id.empty()) return;
+    auto [range, inserted] = users_.try_emplace(user_id, row, row);
+    range->second.second = row + 1;
+}
+
+UserDateIndex::RowRange UserDateIndex::find(const std::string& user_id, int32_t from, int32_t to) const {
+    auto user = users_.find(user_id);
+    if (user == users_.end() || from > to) return {0, 0};
+    auto begin = dates_.begin() + user->second.first;
+    auto end = dates_.begin() + user->second.second;
+    auto first = std::lower_bound(begin, end, from);
+    auto last = std::upper_bound(first, end, to);
+    return {static_cast<uint32_t>(first - dates_.begin()), static_cast<uint32_t>(last - dates_.begin())};
+}
+
+std::vector<UserDateIndex::RowRange> UserDateIndex::findAll(int32_t from, int32_t to) const {
+    std::vector<RowRange> ranges;
+    if (from > to) return ranges;
+    for (const auto& user : users_) {
+        auto begin = dates_.begin() + user.second.first;
+        auto end = dates_.begin() + user.second.second;
+        auto first = std::lower_bound(begin, end, from);
+        auto last = std::upper_bound(first, end, to);
+        if (first == last) continue;
+        ranges.emplace_back(static_cast<uint32_t>(first - dates_.begin()),
+                            static_cast<uint32_t>(last - dates_.begin()));
+    }
+    return ranges;
+}
+
+} // namespace health_ingestion
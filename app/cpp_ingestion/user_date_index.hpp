@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace health_ingestion {
+
+// user -> date -> row lookup for filtered queries. Rows are numbered by (user, date)
+// before they are indexed, so any date range of one user is a contiguous block of
+// rows: one hash lookup for the user, then two binary searches over that user's dates.
+class UserDateIndex {
+public:
+    using RowRange = std::pair<uint32_t, uint32_t>;  // [begin, end) of row ids
+
+    static constexpr int32_t kFirstDate = std::numeric_limits<int32_t>::min();
+    static constexpr int32_t kLastDate = std::numeric_limits<int32_t>::max();
+
+    // Appends the next row. Rows must arrive sorted by user, then date (YYYYMMDD, see
+    // dateKey()); an empty user_id records the row without making it findable.
+    void add(const std::string& user_id, int32_t date);
+
+    // Rows of `user_id` dated from `from` to `to` inclusive; empty for an unknown user
+    RowRange find(const std::string& user_id, int32_t from = kFirstDate, int32_t to = kLastDate) const;
+    // Rows of every user dated from `from` to `to`: one block per user that has any,
+    // found with the same two binary searches per user
+    std::vector<RowRange> findAll(int32_t from, int32_t to) const;
+
+    int32_t date(uint32_t row) const { return dates_[row]; }
+    size_t size() const { return dates_.size(); }
+    const std::unordered_map<std::string, RowRange>& users() const { return users_; }
+
+private:
+    std::unordered_map<std::string, RowRange> users_;
+    std::vector<int32_t> dates_;  // Per row, ascending within each user's block
+};
+
+} // namespace health_ingestion
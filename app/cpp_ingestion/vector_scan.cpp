@@ -0,0 +1,172 @@
+#include "vector_scan.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace health_ingestion {
+
+namespace {
+
+bool closer(const Neighbor& a, const Neighbor& b) {
+    return a.distance < b.distance;
+}
+
+// AVX2 horizontal sums; AVX-512 has _mm512_reduce_add_*
+#if defined(__AVX2__) && defined(__FMA__) && !defined(__AVX512F__)
+float horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+#if defined(__AVX2__) && !defined(__AVX512BW__)
+int32_t horizontalSum(__m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+} // namespace
+
+float dotF32(const float* a, const float* b, size_t n) {
+    size_t i = 0;
+#if defined(__AVX512F__)
+    // Two accumulators hide the FMA latency; the tail is a masked load, not a scalar loop
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    if (i + 16 <= n) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        i += 16;
+    }
+    if (i < n) {
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    float sum = horizontalSum(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+#else
+    float sum = 0.0f;
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+#endif
+}
+
+int32_t dotI8(const int8_t* a, const int8_t* b, size_t n) {
+    size_t i = 0;
+    int32_t sum = 0;
+#if defined(__AVX512BW__)
+    // Sign-extend 32 codes to int16, then madd multiplies and sums adjacent pairs into int32
+    __m512i acc = _mm512_setzero_si512();
+    for (; i + 32 <= n; i += 32) {
+        __m512i va = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+        __m512i vb = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(va, vb));
+    }
+    sum = _mm512_reduce_add_epi32(acc);
+#elif defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    sum = horizontalSum(acc);
+#endif
+    for (; i < n; ++i) sum += static_cast<int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+void normaliseVector(float* vector, size_t n) {
+    float norm = dotF32(vector, vector, n);
+    if (norm <= 0.0f) return;
+    float scale = 1.0f / std::sqrt(norm);
+    for (size_t i = 0; i < n; ++i) vector[i] *= scale;
+}
+
+float TopK::bound() const {
+    return heap_.size() < k_ ? std::numeric_limits<float>::infinity() : heap_.front().distance;
+}
+
+void TopK::push(float distance, uint32_t id) {
+    if (heap_.size() < k_) {
+        heap_.push_back({distance, id});
+        std::push_heap(heap_.begin(), heap_.end(), closer);
+    } else if (k_ > 0 && distance < heap_.front().distance) {
+        std::pop_heap(heap_.begin(), heap_.end(), closer);
+        heap_.back() = {distance, id};
+        std::push_heap(heap_.begin(), heap_.end(), closer);
+    }
+}
+
+std::vector<Neighbor> TopK::take() {
+    std::sort_heap(heap_.begin(), heap_.end(), closer);
+    return std::move(heap_);
+}
+
+float Int8Matrix::quantise(const float* vector, size_t dimension, int8_t* codes) {
+    float max_abs = 0.0f;
+    for (size_t i = 0; i < dimension; ++i) max_abs = std::max(max_abs, std::fabs(vector[i]));
+    if (max_abs == 0.0f) {
+        std::fill(codes, codes + dimension, 0);
+        return 0.0f;
+    }
+    float scale = max_abs / 127.0f;
+    float inverse = 127.0f / max_abs;
+    for (size_t i = 0; i < dimension; ++i) {
+        codes[i] = static_cast<int8_t>(std::lrint(std::clamp(vector[i] * inverse, -127.0f, 127.0f)));
+    }
+    return scale;
+}
+
+void Int8Matrix::assign(const float* rows, size_t count, size_t dimension) {
+    dimension_ = dimension;
+    codes_.resize(count * dimension);
+    scales_.resize(count);
+    for (size_t r = 0; r < count; ++r) {
+        scales_[r] = quantise(rows + r * dimension, dimension, codes_.data() + r * dimension);
+    }
+}
+
+std::vector<Neighbor> scanTopK(const float* rows, size_t dimension, uint32_t begin, uint32_t end,
+                               const float* query, size_t k) {
+    TopK top(k);
+    for (uint32_t r = begin; r < end; ++r) {
+        float distance = 1.0f - dotF32(query, rows + static_cast<size_t>(r) * dimension, dimension);
+        if (distance < top.bound()) top.push(distance, r);
+    }
+    return top.take();
+}
+
+std::vector<Neighbor> scanTopK(const Int8Matrix& rows, uint32_t begin, uint32_t end, const float* query, size_t k) {
+    std::vector<int8_t> codes(rows.dimension());
+    float query_scale = Int8Matrix::quantise(query, rows.dimension(), codes.data());
+    TopK top(k);
+    for (uint32_t r = begin; r < end; ++r) {
+        float dot = static_cast<float>(dotI8(codes.data(), rows.row(r), rows.dimension()));
+        float distance = 1.0f - dot * query_scale * rows.scale(r);
+        if (distance < top.bound()) top.push(distance, r);
+    }
+    return top.take();
+}
+
+} // namespace health_ingestion
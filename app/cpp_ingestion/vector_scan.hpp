@@ -0,0 +1,66 @@
+#pragma once
+
+#include "hnsw_index.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace health_ingestion {
+
+// Exact top-k over a contiguous block of rows, for filtered queries (one user's days)
+// where the candidate set is a few thousand vectors and a linear scan is both cheaper
+// and exact compared with walking the HNSW graph and discarding other users' hits.
+//
+// The kernels use AVX-512 or AVX2 when the build targets them (-march=native) and
+// fall back to scalar loops otherwise.
+
+// Dot products; n need not be a multiple of the vector width
+float dotF32(const float* a, const float* b, size_t n);
+int32_t dotI8(const int8_t* a, const int8_t* b, size_t n);
+
+// Scales to unit length in place (zero vectors are left alone)
+void normaliseVector(float* vector, size_t n);
+
+// Keeps the k smallest distances seen, as a bounded max-heap
+class TopK {
+public:
+    explicit TopK(size_t k) : k_(k) { heap_.reserve(k + 1); }
+
+    // Distance a new entry must beat once the heap is full
+    float bound() const;
+    void push(float distance, uint32_t id);
+    // Closest first; empties the heap
+    std::vector<Neighbor> take();
+
+private:
+    size_t k_;
+    std::vector<Neighbor> heap_;
+};
+
+// Rows quantised to int8 with one symmetric scale each (row ~= codes * scale), for a
+// quarter of the float32 memory traffic per scan
+class Int8Matrix {
+public:
+    void assign(const float* rows, size_t count, size_t dimension);
+
+    size_t size() const { return scales_.size(); }
+    size_t dimension() const { return dimension_; }
+    const int8_t* row(uint32_t id) const { return codes_.data() + static_cast<size_t>(id) * dimension_; }
+    float scale(uint32_t id) const { return scales_[id]; }
+
+    // Quantises one vector with its own scale; returns the scale
+    static float quantise(const float* vector, size_t dimension, int8_t* codes);
+
+private:
+    size_t dimension_ = 0;
+    std::vector<int8_t> codes_;
+    std::vector<float> scales_;
+};
+
+// The k rows in [begin, end) closest to `query` by cosine distance. Rows and query
+// must be unit length; ids are row numbers.
+std::vector<Neighbor> scanTopK(const float* rows, size_t dimension, uint32_t begin, uint32_t end,
+                               const float* query, size_t k);
+// Same over int8 codes; distances are approximate
+std::vector<Neighbor> scanTopK(const Int8Matrix& rows, uint32_t begin, uint32_t end, const float* query, size_t k);
+
+} // namespace health_ingestion
@@ -0,0 +1,321 @@
+#include "weaviate_sink.hpp"
+#include "embedding_cache.hpp"
+#include "health_processor.hpp"
+#include "task_scheduler.hpp"
+#include "metrics.hpp"
+#include "python_repr.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+using namespace std::chrono;
+
+namespace health_ingestion {
+
+namespace {
+
+constexpr int kMaxAttempts = 3;
+
+struct WeaviateMetrics {
+    Counter& objects = metrics().counter(
+        "health_ingest_weaviate_objects_total", "Objects accepted by Weaviate batch requests");
+    Counter& failures = metrics().counter(
+        "health_ingest_weaviate_failures_total", "Objects rejected by Weaviate or lost to failed requests");
+    Histogram& batch_latency = metrics().histogram(
+        "health_ingest_weaviate_batch_seconds", "Latency of one /v1/batch/objects request including retries",
+        latencyBuckets());
+};
+
+WeaviateMetrics& weaviateMetrics() {
+    static WeaviateMetrics instance;
+    return instance;
+}
+
+size_t appendResponse(void* contents, size_t size, size_t nmemb, std::string* out) {
+    out->append(static_cast<char*>(contents), size * nmemb);
+    return size * nmemb;
+}
+
+// Name-based UUID for a user-day, so a re-ingested summary overwrites the old object
+std::string objectId(const Summary& summary) {
+    TextHash hash = hashText(summary.user_id + "|" + summary.date);
+    hash.lo = (hash.lo & ~0xF000ULL) | 0x8000ULL;                        // Version 8 (custom)
+    hash.hi = (hash.hi & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL;  // RFC 4122 variant
+    char id[37];
+    std::snprintf(id, sizeof(id), "%08x-%04x-%04x-%04x-%012llx", static_cast<unsigned>(hash.lo >> 32),
+                  static_cast<unsigned>((hash.lo >> 16) & 0xFFFF), static_cast<unsigned>(hash.lo & 0xFFFF),
+                  static_cast<unsigned>(hash.hi >> 48),
+                  static_cast<unsigned long long>(hash.hi & 0xFFFFFFFFFFFFULL));
+    return id;
+}
+
+} // namespace
+
+WeaviateSink::WeaviateSink(const WeaviateSinkOptions& options, TaskScheduler& scheduler, EmbeddingCache* cache)
+    : options_(options)
+    , scheduler_(scheduler)
+    , cache_(cache)
+    , curl_(curl_easy_init()) {
+    while (!options_.url.empty() && options_.url.back() == '/') options_.url.pop_back();
+    pending_.reserve(options_.batch);
+}
+
+WeaviateSink::~WeaviateSink() {
+    if (curl_) curl_easy_cleanup(static_cast<CURL*>(curl_));
+}
+
+std::string WeaviateSink::buildObject(const Summary& summary, const std::string& class_name) {
+    // Same meta dict as HealthDataProcessor::buildPayload, so objects match those made via /ingest
+    json meta = HealthDataProcessor::summaryMeta(summary);
+    std::string object = "{\"class\":" + json(class_name).dump() + ",\"id\":\"" + objectId(summary) +
+                         "\",\"properties\":{\"text\":" + json(summary.text).dump() +
+                         ",\"meta\":" + json(pythonRepr(meta)).dump() + ",\"user_id\":" +
+                         json(summary.user_id).dump() + ",\"date\":" + std::to_string(dateKey(summary.date)) +
+                         ",\"type\":\"daily_summary\"}";
+    if (!summary.embedding.empty()) {
+        object += ",\"vector\":[";
+        char buffer[32];
+        for (size_t i = 0; i < summary.embedding.size(); ++i) {
+            if (i > 0) object += ',';
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), summary.embedding[i]);
+            object.append(buffer, result.ptr);
+        }
+        object += ']';
+    }
+    object += '}';
+    return object;
+}
+
+size_t WeaviateSink::write(const SummaryBatch& batch, StageTimes& times) {
+    size_t lost = 0;
+    for (const Summary& summary : batch) {
+        pending_.push_back(summary);
+        if (pending_.size() >= options_.batch) {
+            size_t count = pending_.size();
+            lost += count - flush(times);
+        }
+    }
+    return batch.size() - std::min(lost, batch.size());
+}
+
+bool WeaviateSink::finish() {
+    StageTimes times;
+    if (!pending_.empty()) {
+        flush(times);
+    }
+    if (failed_ > 0) {
+        std::cerr << "Weaviate sink: " << failed_ << " objects were not stored" << std::endl;
+    }
+    return failed_ == 0;
+}
+
+size_t WeaviateSink::flush(StageTimes& times) {
+    WeaviateMetrics& stats = weaviateMetrics();
+    SummaryBatch batch;
+    batch.swap(pending_);
+    pending_.reserve(options_.batch);
+
+    if (!class_checked_) {
+        class_checked_ = ensureClass();
+    }
+
+    // Vectors for summaries the embedding stage and cache did not cover
+    if (!options_.embed_url.empty()) {
+        std::vector<Summary*> missing;
+        for (Summary& summary : batch) {
+            if (summary.embedding.empty()) missing.push_back(&summary);
+        }
+        if (!missing.empty()) {
+            ScopedStageTimer timer(times, Stage::Embed);
+            if (!fetchEmbeddings(missing)) {
+                std::cerr << "Weaviate sink: no vectors for " << missing.size() << " summaries from "
+                          << options_.embed_url << "; batch dropped" << std::endl;
+                stats.failures.inc(batch.size());
+                failed_ += batch.size();
+                return 0;
+            }
+        }
+    }
+
+    // One request body, serialised object by object in parallel
+    std::vector<std::string> objects(batch.size());
+    std::vector<StageTimes> task_times(batch.size());
+    scheduler_.parallelFor(batch.size(), [&](size_t i) {
+        ScopedStageTimer timer(task_times[i], Stage::Serialise);
+        objects[i] = buildObject(batch[i], options_.class_name);
+    });
+    for (const auto& item_times : task_times) times.merge(item_times);
+    std::string body;
+    {
+        auto join_start = steady_clock::now();
+        size_t bytes = 16;
+        for (const auto& object : objects) bytes += object.size() + 1;
+        body.reserve(bytes);
+        body = "{\"objects\":[";
+        for (size_t i = 0; i < objects.size(); ++i) {
+            if (i > 0) body += ',';
+            body += objects[i];
+        }
+        body += "]}";
+        times.add(Stage::Serialise, duration_cast<nanoseconds>(steady_clock::now() - join_start).count(), 0);
+    }
+
+    // Counted per object, like the per-summary HTTP sink
+    auto send_start = steady_clock::now();
+    std::string response;
+    long status = 0;
+    bool sent = requestWithRetries(options_.url + "/v1/batch/objects", body, response, status,
+                                   "Weaviate batch of " + std::to_string(batch.size()));
+    auto send_elapsed = steady_clock::now() - send_start;
+    stats.batch_latency.observe(duration<double>(send_elapsed).count());
+    times.add(Stage::Send, duration_cast<nanoseconds>(send_elapsed).count(), batch.size());
+    if (!sent) {
+        stats.failures.inc(batch.size());
+        failed_ += batch.size();
+        return 0;
+    }
+
+    // 200 covers the request; each object reports its own errors
+    size_t accepted = 0;
+    try {
+        json results = json::parse(response);
+        std::string first_error;
+        for (const auto& result : results) {
+            const json* errors = nullptr;
+            if (result.contains("result") && result["result"].contains("errors")) {
+                errors = &result["result"]["errors"];
+            }
+            if (!errors || errors->is_null()) {
+                accepted++;
+            } else if (first_error.empty()) {
+                first_error = errors->dump();
+            }
+        }
+        if (!first_error.empty()) {
+            std::cerr << "Weaviate rejected " << batch.size() - accepted << " objects, e.g. " << first_error
+                      << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid Weaviate batch response: " << e.what() << std::endl;
+    }
+    stats.objects.inc(accepted);
+    stats.failures.inc(batch.size() - accepted);
+    failed_ += batch.size() - accepted;
+    return accepted;
+}
+
+bool WeaviateSink::ensureClass() {
+    std::string response;
+    long status = 0;
+    if (!request(options_.url + "/v1/schema/" + options_.class_name, nullptr, response, status)) {
+        return false;
+    }
+    if (status == 200) return true;
+    if (status != 404) {
+        std::cerr << "Weaviate schema check for " << options_.class_name << " returned HTTP " << status << std::endl;
+        return false;
+    }
+
+    json definition = {
+        {"class", options_.class_name},
+        {"description", "Sentences and their vectors"},
+        {"vectorizer", "none"},
+        {"properties", {
+            {{"name", "text"}, {"dataType", {"text"}}},
+            {{"name", "meta"}, {"dataType", {"text"}}},
+            {{"name", "user_id"}, {"dataType", {"text"}}, {"tokenization", "field"}},
+            {{"name", "date"}, {"dataType", {"int"}}},
+            {{"name", "type"}, {"dataType", {"text"}}, {"tokenization", "field"}}
+        }}
+    };
+    std::string body = definition.dump();
+    if (!request(options_.url + "/v1/schema", &body, response, status) || status != 200) {
+        // Another writer may have created it in the meantime; the batch will tell
+        std::cerr << "Could not create Weaviate class " << options_.class_name << " (HTTP " << status << "): "
+                  << response << std::endl;
+        return false;
+    }
+    std::cout << "Created Weaviate class " << options_.class_name << std::endl;
+    return true;
+}
+
+bool WeaviateSink::fetchEmbeddings(std::vector<Summary*>& missing) {
+    json texts = json::array();
+    for (const Summary* summary : missing) texts.push_back(summary->text);
+    std::string response;
+    long status = 0;
+    std::string body = json{{"texts", texts}}.dump();
+    if (!requestWithRetries(options_.embed_url, body, response, status,
+                            "/embed of " + std::to_string(missing.size()) + " texts")) {
+        return false;
+    }
+    try {
+        json vectors = json::parse(response).at("embeddings");
+        if (vectors.size() != missing.size()) return false;
+        for (size_t i = 0; i < missing.size(); ++i) {
+            missing[i]->embedding = vectors[i].get<std::vector<float>>();
+            if (cache_) cache_->insert(hashText(missing[i]->text), missing[i]->embedding);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid /embed response: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// POSTs body until it gets a 200, with the HTTP sink's attempts and backoff
+bool WeaviateSink::requestWithRetries(const std::string& url, const std::string& body, std::string& response,
+                                      long& status, const std::string& what) {
+    for (int attempt = 1; attempt <= kMaxAttempts; ++attempt) {
+        if (request(url, &body, response, status) && status == 200) return true;
+        if (attempt < kMaxAttempts) {
+            std::cout << "Retry " << attempt << "/" << kMaxAttempts << " for " << what << " (HTTP " << status
+                      << ")" << std::endl;
+            std::this_thread::sleep_for(milliseconds(500 * attempt));
+        }
+    }
+    std::cerr << what << " failed after " << kMaxAttempts << " attempts (HTTP " << status << ")" << std::endl;
+    return false;
+}
+
+// POSTs body, or GETs when there is none
+bool WeaviateSink::request(const std::string& url, const std::string* body, std::string& response, long& status) {
+    CURL* curl = static_cast<CURL*>(curl_);
+    if (!curl) return false;
+    response.clear();
+    status = 0;
+
+    struct curl_slist* headers = nullptr;
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = curl_slist_append(headers, "Accept: application/json");
+    headers = curl_slist_append(headers, "Expect:");  // Large batches; skip the 100-continue wait
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    if (body) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body->c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(body->size()));
+    } else {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, appendResponse);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 120L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_slist_free_all(headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, nullptr);
+    if (res != CURLE_OK) {
+        std::cerr << "Request to " << url << " failed: " << curl_easy_strerror(res) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "output_sink.hpp"
+#include <string>
+#include <vector>
+
+namespace health_ingestion {
+
+class EmbeddingCache;
+
+struct WeaviateSinkOptions {
+    std::string url;                       // Weaviate base URL, e.g. http://weaviate:8080
+    std::string class_name = "Sentence";   // Same class as api/app.py
+    size_t batch = 500;                    // Objects per /v1/batch/objects request
+    std::string embed_url;                 // API /embed endpoint for summaries without a vector
+};
+
+// Writes summaries straight to Weaviate's /v1/batch/objects endpoint, skipping the
+// per-summary Flask /ingest hop. Objects have the same shape as those app.py creates
+// (text, meta as the Python repr of the meta dict, and typed user_id, date and type
+// properties for filters), so /query results look the same.
+// Object ids are derived from user and date, so re-ingesting a day replaces it.
+//
+// Summaries are buffered across write() calls and sent `batch` at a time. Vectors come
+// from the embedding stage or --embed-cache. The rest are embedded in one request to
+// the API's /embed endpoint when embed_url is set; otherwise they are sent without a
+// vector, for a class with a vectorizer module. The class is created (vectorizer
+// "none") if it does not exist yet.
+class WeaviateSink : public OutputSink {
+public:
+    WeaviateSink(const WeaviateSinkOptions& options, TaskScheduler& scheduler, EmbeddingCache* cache);
+    ~WeaviateSink() override;
+
+    size_t write(const SummaryBatch& batch, StageTimes& times) override;
+    bool finish() override;
+
+    // Weaviate batch object for one summary
+    static std::string buildObject(const Summary& summary, const std::string& class_name);
+
+private:
+    // Sends pending_ and returns how many objects Weaviate accepted
+    size_t flush(StageTimes& times);
+    bool ensureClass();
+    bool fetchEmbeddings(std::vector<Summary*>& missing);
+    bool requestWithRetries(const std::string& url, const std::string& body, std::string& response, long& status,
+                            const std::string& what);
+    bool request(const std::string& url, const std::string* body, std::string& response, long& status);
+
+    WeaviateSinkOptions options_;
+    TaskScheduler& scheduler_;
+    EmbeddingCache* cache_;  // Optional
+    void* curl_ = nullptr;   // One keep-alive handle for every request
+    bool class_checked_ = false;
+    SummaryBatch pending_;
+    size_t failed_ = 0;      // Objects lost in flushes, reported by finish()
+};
+
+} // namespace health_ingestion
@@ -0,0 +1,169 @@
+#include "work_manifest.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace health_ingestion {
+
+WorkManifest::WorkManifest(const std::string& work_dir)
+    : work_dir_(work_dir)
+    , partitions_(1) {
+}
+
+bool WorkManifest::create(const std::vector<WorkUnit>& units, size_t partitions) {
+    // Claims and done markers of an earlier run would make every unit look taken
+    std::error_code ec;
+    bool stale = std::filesystem::exists(work_dir_ + "/manifest.tsv", ec);
+    for (const char* sub : {"claims", "done"}) {
+        std::filesystem::path dir = work_dir_ + "/" + sub;
+        if (std::filesystem::is_directory(dir, ec) && !std::filesystem::is_empty(dir, ec)) stale = true;
+    }
+    if (stale) {
+        std::cerr << work_dir_ << " already holds a run; use a fresh work directory" << std::endl;
+        return false;
+    }
+    for (const char* sub : {"claims", "done", "runs", "metrics"}) {
+        std::filesystem::create_directories(work_dir_ + "/" + sub, ec);
+        if (ec) {
+            std::cerr << "Failed to create " << work_dir_ << "/" << sub << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+
+    std::string tmp_path = work_dir_ + "/manifest.tsv.tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Failed to write " << tmp_path << std::endl;
+            return false;
+        }
+        out << "partitions\t" << partitions << "\n";
+        for (const auto& unit : units) {
+            out << unit.id << "\t" << unit.filename << "\t" << unit.data_type << "\t"
+                << unit.range.begin << "\t" << unit.range.end << "\n";
+        }
+        if (!out) return false;
+    }
+    std::filesystem::rename(tmp_path, work_dir_ + "/manifest.tsv", ec);
+    if (ec) {
+        std::cerr << "Failed to publish manifest: " << ec.message() << std::endl;
+        return false;
+    }
+
+    units_ = units;
+    partitions_ = partitions;
+    return true;
+}
+
+bool WorkManifest::load() {
+    std::ifstream in(work_dir_ + "/manifest.tsv");
+    if (!in.is_open()) {
+        return false;
+    }
+
+    std::string label;
+    if (!(in >> label >> partitions_) || label != "partitions" || partitions_ == 0) {
+        std::cerr << "Malformed manifest in " << work_dir_ << std::endl;
+        return false;
+    }
+
+    units_.clear();
+    std::string line;
+    std::getline(in, line);  // Rest of header line
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        WorkUnit unit;
+        if (fields >> unit.id >> unit.filename >> unit.data_type >> unit.range.begin >> unit.range.end) {
+            units_.push_back(unit);
+        }
+    }
+    return true;
+}
+
+bool WorkManifest::claim(const std::string& task) {
+    // O_EXCL creation is atomic: exactly one process wins each task
+    std::string path = work_dir_ + "/claims/" + task;
+    int fd = ::open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::string owner = std::to_string(getpid()) + "\n";
+    ssize_t written = ::write(fd, owner.data(), owner.size());
+    (void)written;
+    ::close(fd);
+    return true;
+}
+
+void WorkManifest::markDone(const std::string& task) {
+    std::string path = work_dir_ + "/done/" + task;
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << getpid() << "\n";
+    }
+    std::error_code ec;
+    std::filesystem::rename(path + ".tmp", path, ec);
+    if (ec) {
+        std::cerr << "Failed to mark " << task << " done: " << ec.message() << std::endl;
+    }
+}
+
+void WorkManifest::markFailed(const std::string& task, const std::string& error) {
+    std::string path = work_dir_ + "/done/" + task + ".failed";
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << getpid() << "\t" << error << "\n";
+    }
+    std::error_code ec;
+    std::filesystem::rename(path + ".tmp", path, ec);
+    if (ec) {
+        std::cerr << "Failed to mark " << task << " failed: " << ec.message() << std::endl;
+    }
+}
+
+bool WorkManifest::isDone(const std::string& task) const {
+    std::error_code ec;
+    return std::filesystem::exists(work_dir_ + "/done/" + task, ec);
+}
+
+bool WorkManifest::isFailed(const std::string& task) const {
+    std::error_code ec;
+    if (std::filesystem::exists(work_dir_ + "/done/" + task + ".failed", ec)) {
+        return true;
+    }
+    // A killed worker leaves its claim behind; workers are local, so probe its pid.
+    // An empty claim is still being written by its owner.
+    std::ifstream in(work_dir_ + "/claims/" + task);
+    pid_t owner = 0;
+    if (!(in >> owner) || owner <= 0) {
+        return false;
+    }
+    if (::kill(owner, 0) == 0 || errno != ESRCH) {
+        return false;
+    }
+    // The owner may have finished just before exiting
+    return !isDone(task);
+}
+
+void WorkManifest::removeRuns(size_t partition) const {
+    for (const auto& unit : units_) {
+        std::error_code ec;
+        std::filesystem::remove(runPath(unit.id, partition), ec);
+    }
+}
+
+void WorkManifest::removeScratch() const {
+    std::error_code ec;
+    std::filesystem::remove_all(work_dir_ + "/claims", ec);
+    std::filesystem::remove_all(work_dir_ + "/runs", ec);
+}
+
+std::string WorkManifest::runPath(size_t unit_id, size_t partition) const {
+    return work_dir_ + "/runs/unit-" + std::to_string(unit_id) + ".p" + std::to_string(partition) + ".run";
+}
+
+} // namespace health_ingestion
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "record_scanner.hpp"
+#include <string>
+#include <vector>
+
+namespace health_ingestion {
+
+struct WorkUnit {
+    size_t id;
+    std::string filename;
+    std::string data_type;
+    ByteRange range;
+};
+
+// Shared on-disk state of a coordinated run, usable by any number of local worker processes.
+//
+//   <work_dir>/manifest.tsv             "partitions\tP", then "id\tfile\ttype\tbegin\tend" per unit
+//   <work_dir>/claims/<task>            created with O_EXCL; the creator owns the task
+//   <work_dir>/done/<task>              published by rename once the task's output is complete
+//   <work_dir>/done/<task>.failed       published instead when the task failed; holds the error
+//   <work_dir>/runs/unit-<id>.p<k>.run  unit <id>'s user-days for merge partition <k>
+//   <work_dir>/metrics/<pid>.metrics    each worker's metrics snapshot, summed by /metrics
+//
+// Phase 1 tasks ("unit-<id>") parse one byte range into partitioned sorted runs.
+// Phase 2 tasks ("part-<k>") merge partition k across all units and emit summaries.
+// A failed task is not retried: the run stops and the work dir is left for inspection.
+// Each work dir holds one run; create() refuses a dir that already has a manifest, claims
+// or done markers.
+class WorkManifest {
+public:
+    explicit WorkManifest(const std::string& work_dir);
+
+    // Writes a fresh manifest (atomically via rename); fails if work_dir holds an earlier run
+    bool create(const std::vector<WorkUnit>& units, size_t partitions);
+    bool load();
+
+    bool claim(const std::string& task);
+    void markDone(const std::string& task);
+    void markFailed(const std::string& task, const std::string& error);
+    bool isDone(const std::string& task) const;
+    // Failed, or claimed by a process that has since exited without finishing it
+    bool isFailed(const std::string& task) const;
+
+    const std::vector<WorkUnit>& units() const { return units_; }
+    size_t partitions() const { return partitions_; }
+    std::string runPath(size_t unit_id, size_t partition) const;
+    // Every unit's run for a partition, once the partition is merged
+    void removeRuns(size_t partition) const;
+    // Claims and runs, after a successful run; the manifest and done markers stay as its record
+    void removeScratch() const;
+    std::string metricsDir() const { return work_dir_ + "/metrics"; }
+    std::string metricsPath(int pid) const { return metricsDir() + "/" + std::to_string(pid) + ".metrics"; }
+
+    static std::string unitTask(size_t unit_id) { return "unit-" + std::to_string(unit_id); }
+    static std::string partitionTask(size_t partition) { return "part-" + std::to_string(partition); }
+
+private:
+    std::string work_dir_;
+    std::vector<WorkUnit> units_;
+    size_t partitions_;
+};
+
+} // namespace health_ingestion
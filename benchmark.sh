@@ -8,9 +8,11 @@ set -e
 echo "=== Health Data Ingestion Performance Comparison ==="
 echo
 
-# Configuration
-DATA_DIR="/home/gl1tch/Repos/Project/app/data"
-CPP_DIR="/home/gl1tch/Repos/Project/app/cpp_ingestion"
+# Configuration (override via environment)
+DATA_DIR="${DATA_DIR:-/home/gl1tch/Repos/Project/app/data}"
+CPP_DIR="${CPP_DIR:-/home/gl1tch/Repos/Project/app/cpp_ingestion}"
+DATASET_SIZE="${DATASET_SIZE:-}"   # e.g. 1G: generate a synthetic dataset if DATA_DIR has none
+DATASET_SEED="${DATASET_SEED:-42}"
 API_URL="http://localhost:5000"
 
 # Colors for output
@@ -75,6 +77,20 @@ build_cpp() {
     fi
 }
 
+# Generate a reproducible synthetic dataset when DATASET_SIZE is set and DATA_DIR is empty
+generate_data() {
+    if [ -z "$DATASET_SIZE" ] || [ -f "$DATA_DIR/users.json" ]; then
+        return 0
+    fi
+    if [ ! -x "$CPP_DIR/build/health_datagen" ]; then
+        print_error "health_datagen not found. Use --build-cpp to build it."
+        return 1
+    fi
+    
+    print_status "Generating $DATASET_SIZE synthetic dataset in $DATA_DIR (seed $DATASET_SEED)..."
+    "$CPP_DIR/build/health_datagen" "$DATA_DIR" --size "$DATASET_SIZE" --seed "$DATASET_SEED"
+}
+
 # Install Python dependencies 
 setup_python() {
     print_status "Setting up Python dependencies..."
@@ -138,7 +154,10 @@ main() {
         api_available=true
     fi
     
-    # Setup Python environment
+    # Setup Python environment (a dataset to be generated still needs its directory)
+    if [ -n "$DATASET_SIZE" ]; then
+        mkdir -p "$DATA_DIR"
+    fi
     setup_python
     
     # Build C++ if requested
@@ -158,6 +177,8 @@ main() {
         fi
     fi
     
+    generate_data || exit 1
+    
     echo
     print_status "Starting performance comparison..."
     
@@ -173,13 +194,11 @@ main() {
         "python3 main.py --mode=optimized --no-api | head -20" \
         "Optimized Python implementation without API calls"
     
-    # Test 3: C++ Implementation (dry run if no API)
+    # Test 3: C++ Implementation (dry run - print mode, per-stage rows appended to the CSV)
     if [ "$cpp_available" = true ]; then
-        # TODO: Add --dry-run flag to C++ implementation
-        print_warning "C++ dry-run mode not implemented yet"
-        # run_test "CPP_DryRun" \
-        #     "$CPP_DIR/build/health_ingestion --dry-run" \
-        #     "C++ implementation without API calls"
+        run_test "CPP_DryRun" \
+            "$CPP_DIR/build/health_ingestion $DATA_DIR --output stdout --bench-csv $DATA_DIR/benchmark_results.csv --report $DATA_DIR/cpp_report.json > /dev/null" \
+            "C++ implementation without API calls"
     fi
     
     # API-based tests (if API is available)
@@ -235,6 +254,12 @@ show_help() {
     echo "  -c, --build-cpp    Build C++ implementation before testing"
     echo "  -h, --help         Show this help message"
     echo
+    echo "Environment:"
+    echo "  DATA_DIR, CPP_DIR  Dataset and C++ source directories"
+    echo "  DATASET_SIZE       Generate a synthetic dataset of this size (e.g. 1G, 100G)"
+    echo "                     into DATA_DIR when it has no users.json"
+    echo "  DATASET_SEED       Seed for the generated dataset (default: 42)"
+    echo
     echo "Prerequisites:"
     echo "1. Install dependencies:"
     echo "   sudo apt install cmake libcurl4-openssl-dev nlohmann-json3-dev python3-venv"